@@ -0,0 +1,10 @@
+#pragma once
+
+#include <avr/io.h>
+
+// Handlers become plain functions that pin_latency.c calls when their
+// interrupt is due.
+#define ISR(vector) void sim_##vector(void)
+
+#define sei() do {} while (0)
+#define cli() do {} while (0)
@@ -0,0 +1,83 @@
+#pragma once
+
+// Just enough of the ATtiny412's registers for pin_latency to run
+// main.c, ticks.c, tone.c and hal_key.c unchanged. The registers are
+// plain variables, and pin_latency.c plays the part of the hardware
+// behind them between wakeups.
+
+#include <stdint.h>
+
+typedef struct {
+  volatile uint8_t DIR, DIRSET, DIRCLR, DIRTGL;
+  volatile uint8_t OUT, OUTSET, OUTCLR, OUTTGL;
+  volatile uint8_t IN, INTFLAGS;
+  volatile uint8_t PIN0CTRL, PIN1CTRL, PIN2CTRL, PIN3CTRL;
+  volatile uint8_t PIN4CTRL, PIN5CTRL, PIN6CTRL, PIN7CTRL;
+} PORT_t;
+
+typedef struct {
+  volatile uint8_t CTRLA, CTRLB, INTCTRL, INTFLAGS;
+  volatile uint16_t CNT, PER, CMP0, CMP0BUF;
+} TCA_SINGLE_t;
+
+typedef union {
+  TCA_SINGLE_t SINGLE;
+} TCA_t;
+
+typedef struct {
+  volatile uint8_t CTRLA;
+  volatile uint16_t CNT, CCMP;
+} TCB_t;
+
+typedef struct {
+  volatile uint8_t CTRLA;
+  volatile uint16_t CNT;
+  volatile uint8_t STATUS, CLKSEL, PITCTRLA, PITSTATUS;
+  volatile uint8_t PITINTCTRL, PITINTFLAGS;
+} RTC_t;
+
+typedef struct {
+  volatile uint8_t MCLKCTRLB, OSC32KCTRLA;
+} CLKCTRL_t;
+
+typedef struct {
+  volatile int8_t OSC16ERR3V, OSC16ERR5V;
+} SIGROW_t;
+
+extern PORT_t PORTA;
+extern TCA_t TCA0;
+extern TCB_t TCB0;
+extern RTC_t RTC;
+extern CLKCTRL_t CLKCTRL;
+extern SIGROW_t SIGROW;
+
+#define _PROTECTED_WRITE(reg, value) ((reg) = (value))
+
+#define PIN3_bm 0x08
+#define PIN6_bm 0x40
+#define PIN7_bm 0x80
+#define PORT_PULLUPEN_bm 0x08
+#define PORT_ISC_gm 0x07
+#define PORT_ISC_BOTHEDGES_gc 0x01
+#define PORT_ISC_RISING_gc 0x02
+#define PORT_ISC_FALLING_gc 0x03
+#define PORT_ISC_INPUT_DISABLE_gc 0x04
+#define PORT_ISC_LEVEL_gc 0x05
+
+#define TCA_SINGLE_ENABLE_bm 0x01
+#define TCA_SINGLE_CLKSEL_DIV2_gc 0x02
+#define TCA_SINGLE_CMP0EN_bm 0x10
+#define TCA_SINGLE_WGMODE_SINGLESLOPE_gc 0x03
+#define TCA_SINGLE_OVF_bm 0x01
+
+#define TCB_ENABLE_bm 0x01
+#define TCB_CLKSEL_CLKDIV2_gc 0x02
+
+#define CLKCTRL_RUNSTDBY_bm 0x02
+#define RTC_CLKSEL_INT32K_gc 0x00
+#define RTC_PRESCALER_DIV32_gc 0x28
+#define RTC_RTCEN_bm 0x01
+#define RTC_RUNSTDBY_bm 0x80
+#define RTC_PERIOD_CYC32_gc 0x20
+#define RTC_PITEN_bm 0x01
+#define RTC_PI_bm 0x01
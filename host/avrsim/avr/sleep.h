@@ -0,0 +1,17 @@
+#pragma once
+
+// sleep_mode() is where pin_latency.c lets time pass, until the next
+// interrupt that would wake the device.
+
+#include <stdint.h>
+
+#define SLEEP_MODE_IDLE 0
+#define SLEEP_MODE_STANDBY 1
+#define SLEEP_MODE_PWR_DOWN 2
+
+void set_sleep_mode(uint8_t mode);
+void sleep_mode(void);
+
+#define sleep_enable() do {} while (0)
+#define sleep_disable() do {} while (0)
+#define sleep_cpu() sleep_mode()
@@ -0,0 +1,6 @@
+#pragma once
+
+// Nothing interrupts the simulated firmware part way through, so the
+// block only has to run once.
+#define ATOMIC_RESTORESTATE 0
+#define ATOMIC_BLOCK(type) for (int atomic_once = 1; atomic_once; atomic_once = 0)
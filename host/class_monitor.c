@@ -0,0 +1,409 @@
+// Shows a classroom's trainers at once, from the trace records each
+// sends over its serial port when built with -DTRACE:
+//
+//   ./class_monitor [-r refresh_ms] [-w window] /dev/ttyUSB0 ...
+//
+// Each device gets a line, redrawn every -r ms (default 1000, and 0
+// for only when done), with tab separated:
+//
+//   port attempts passed first recent retries lost state
+//
+// from the TRACE_GRADE record state.c sends after grading each
+// attempt: how many were graded, how many passed, and how many of
+// those at the first try. recent is the passes in the last -w
+// (default 20, at most 64) of them, and retries the mean number of
+// retries before a pass. lost counts the events the device had to
+// drop, and state is the last state it went into, or "gone" once
+// its port has hung up. The last line has the longest any one read
+// took to handle, in microseconds.
+//
+// Everything runs in one thread, around epoll. Ports are read as they
+// have data, no more than READ_BYTES from each at a time, so a busy
+// one can't hold up the rest, and records split between reads are
+// picked up where they left off. Writes to the screen never wait
+// either: if it hasn't taken the last table yet, the next is skipped.
+// It runs until every port has hung up, or it's interrupted, and then
+// prints the table one last time.
+//
+// test/class_monitor_test.c runs it against pseudo-terminals standing
+// in for the devices.
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "trace.h"
+#include "uart.h"
+
+// The ports are set to the speed uart.c runs at.
+#if UART_BAUD != 38400
+#error "class_monitor's B38400 doesn't match UART_BAUD"
+#endif
+
+#define READ_BYTES 512
+#define EVENTS_MAX 64
+#define WINDOW_MAX 64
+#define LINE_BYTES 128
+
+// epoll data for the ones that aren't ports.
+#define TIMER_ID -1
+#define SIGNAL_ID -2
+#define OUT_ID -3
+
+static const char* MODES[] = {"straight key", "practice", "receiving"};
+static const char* STRAIGHT_KEY_STATES[] = {"announcing", "ready"};
+static const char* PRACTICE_STATES[] = {
+  "announcing", "sending", "waiting", "?",
+  "receive announcing", "receive listening", "receive waiting",
+  "receive replaying",
+};
+
+#define NAME(names, v) \
+  (((v) < sizeof(names) / sizeof(names[0])) ? names[v] : "?")
+
+typedef struct {
+  const char* path;
+  int fd;
+
+  // The record being read, or -1 until one starts.
+  int event;
+
+  uint32_t attempts;
+  uint32_t passed;
+  uint32_t first;
+  uint32_t retries;
+  uint32_t lost;
+  // The last grades, newest in bit 0, and how many of them there are.
+  uint64_t recent;
+  uint8_t recent_len;
+  const char* state;
+} device_t;
+
+static device_t* devices;
+static int ndevices;
+static int open_devices;
+static unsigned window = 20;
+static long slowest_ns = 0;
+
+// The table being written to stdout.
+static char* out;
+static size_t out_size;
+static size_t out_len = 0;
+static size_t out_done = 0;
+static bool out_polled = false;
+static int out_flags;
+
+static void grade(device_t* d, uint8_t v) {
+  bool passed = v & 1;
+  d->attempts++;
+  d->recent = (d->recent << 1) | passed;
+  if (d->recent_len < window) {
+    d->recent_len++;
+  }
+  if (passed) {
+    d->passed++;
+    d->retries += v >> 1;
+    if (!(v >> 1)) {
+      d->first++;
+    }
+  }
+}
+
+static void event(device_t* d, uint8_t type, uint8_t v) {
+  switch (type) {
+    case TRACE_MODE:
+      d->state = NAME(MODES, v);
+      break;
+    case TRACE_STRAIGHT_KEY:
+      d->state = NAME(STRAIGHT_KEY_STATES, v);
+      break;
+    case TRACE_PRACTICE:
+      d->state = NAME(PRACTICE_STATES, v);
+      break;
+    case TRACE_GRADE:
+      grade(d, v);
+      break;
+    case TRACE_OVERFLOW:
+      d->lost += v;
+      break;
+  }
+}
+
+// Records are a byte with the top bit set and then one without, as in
+// trace.h. Bytes before the first record are skipped.
+static void parse(device_t* d, const uint8_t* buf, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    uint8_t c = buf[i];
+    if (c & 0x80) {
+      d->event = c;
+      continue;
+    }
+    if (d->event < 0) {
+      continue;
+    }
+    event(d, (d->event >> 4) & 0x07, d->event & 0x0f);
+    d->event = -1;
+  }
+}
+
+static int count_bits(uint64_t v, uint8_t len) {
+  int n = 0;
+  for (uint8_t i = 0; i < len; i++) {
+    n += (v >> i) & 1;
+  }
+  return n;
+}
+
+static void append(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+
+static void append(const char* fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(out + out_len, out_size - out_len, fmt, ap);
+  va_end(ap);
+  if (n > 0) {
+    out_len += ((size_t)n < out_size - out_len) ? (size_t)n :
+      out_size - out_len - 1;
+  }
+}
+
+static void table(bool clear) {
+  out_len = out_done = 0;
+  if (clear) {
+    append("\033[H\033[2J");
+  }
+  append("port\tattempts\tpassed\tfirst\trecent\tretries\tlost\tstate\n");
+  for (int i = 0; i < ndevices; i++) {
+    device_t* d = &devices[i];
+    append("%s\t%u\t%u\t%u\t%d/%u\t%.2f\t%u\t%s\n", d->path, d->attempts,
+           d->passed, d->first, count_bits(d->recent, d->recent_len),
+           d->recent_len, d->passed ? (double)d->retries / d->passed : 0,
+           d->lost, (d->fd < 0) ? "gone" : d->state);
+  }
+  append("slowest read: %ld us\n", slowest_ns / 1000);
+}
+
+// Writes what it can of the table without waiting. Returns false if
+// some is left.
+static bool flush_out(void) {
+  while (out_done < out_len) {
+    ssize_t n = write(STDOUT_FILENO, out + out_done, out_len - out_done);
+    if (n < 0) {
+      if ((errno == EAGAIN) || (errno == EINTR)) {
+        return false;
+      }
+      perror("stdout");
+      exit(1);
+    }
+    out_done += n;
+  }
+  out_len = out_done = 0;
+  return true;
+}
+
+static void watch_out(int ep, bool pending) {
+  struct epoll_event ev = {.events = pending ? EPOLLOUT : 0};
+  ev.data.u64 = (uint64_t)(int64_t)OUT_ID;
+  epoll_ctl(ep, EPOLL_CTL_MOD, STDOUT_FILENO, &ev);
+}
+
+static void refresh(int ep) {
+  if (out_done < out_len) {
+    // Still writing the last one.
+    return;
+  }
+  table(isatty(STDOUT_FILENO));
+  if (out_polled && !flush_out()) {
+    watch_out(ep, true);
+  } else if (!out_polled) {
+    flush_out();
+  }
+}
+
+// Raw, at the uart's speed. Anything that isn't a terminal, like a
+// FIFO, is read as it is.
+static int open_port(const char* path) {
+  int fd = open(path, O_RDONLY | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) {
+    perror(path);
+    exit(1);
+  }
+  struct termios t;
+  if (tcgetattr(fd, &t) == 0) {
+    cfmakeraw(&t);
+    cfsetispeed(&t, B38400);
+    cfsetospeed(&t, B38400);
+    t.c_cflag |= CLOCAL | CREAD;
+    if (tcsetattr(fd, TCSANOW, &t) < 0) {
+      perror(path);
+      exit(1);
+    }
+  }
+  return fd;
+}
+
+static void hang_up(int ep, device_t* d) {
+  epoll_ctl(ep, EPOLL_CTL_DEL, d->fd, NULL);
+  close(d->fd);
+  d->fd = -1;
+  open_devices--;
+}
+
+static void port_ready(int ep, device_t* d, uint32_t events) {
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  uint8_t buf[READ_BYTES];
+  ssize_t n = read(d->fd, buf, sizeof(buf));
+  if (n > 0) {
+    parse(d, buf, n);
+  } else if ((n == 0) || ((errno != EAGAIN) && (errno != EINTR))) {
+    // A pseudo-terminal whose other end has closed reads as EIO.
+    hang_up(ep, d);
+  } else if (events & (EPOLLHUP | EPOLLERR)) {
+    hang_up(ep, d);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  long ns = (end.tv_sec - start.tv_sec) * 1000000000L +
+    (end.tv_nsec - start.tv_nsec);
+  if (ns > slowest_ns) {
+    slowest_ns = ns;
+  }
+}
+
+static void add(int ep, int fd, int64_t id, uint32_t events) {
+  struct epoll_event ev = {.events = events};
+  ev.data.u64 = (uint64_t)id;
+  if (epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev) < 0) {
+    perror("epoll_ctl");
+    exit(1);
+  }
+}
+
+static void usage(void) {
+  fprintf(stderr,
+          "usage: class_monitor [-r refresh_ms] [-w window] port ...\n");
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  long refresh_ms = 1000;
+  int opt;
+  while ((opt = getopt(argc, argv, "r:w:")) != -1) {
+    switch (opt) {
+      case 'r':
+        refresh_ms = atol(optarg);
+        break;
+      case 'w':
+        window = atoi(optarg);
+        break;
+      default:
+        usage();
+    }
+  }
+  ndevices = argc - optind;
+  if ((ndevices <= 0) || (window < 1) || (window > WINDOW_MAX)) {
+    usage();
+  }
+
+  int ep = epoll_create1(EPOLL_CLOEXEC);
+  if (ep < 0) {
+    perror("epoll_create1");
+    return 1;
+  }
+  devices = calloc(ndevices, sizeof(device_t));
+  for (int i = 0; i < ndevices; i++) {
+    device_t* d = &devices[i];
+    d->path = argv[optind + i];
+    d->fd = open_port(d->path);
+    d->event = -1;
+    d->state = "?";
+    add(ep, d->fd, i, EPOLLIN);
+  }
+  open_devices = ndevices;
+  out_size = (ndevices + 3) * LINE_BYTES;
+  out = malloc(out_size);
+
+  // Signals come in as events, so the last table is printed.
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGTERM);
+  sigprocmask(SIG_BLOCK, &mask, NULL);
+  int sig = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  add(ep, sig, SIGNAL_ID, EPOLLIN);
+
+  int timer = -1;
+  if (refresh_ms > 0) {
+    timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    struct itimerspec its = {
+      .it_interval = {refresh_ms / 1000, (refresh_ms % 1000) * 1000000},
+      .it_value = {refresh_ms / 1000, (refresh_ms % 1000) * 1000000},
+    };
+    timerfd_settime(timer, 0, &its, NULL);
+    add(ep, timer, TIMER_ID, EPOLLIN);
+  }
+
+  // Regular files can't be polled, and never keep a write waiting.
+  out_flags = fcntl(STDOUT_FILENO, F_GETFL);
+  struct epoll_event out_ev = {.events = 0};
+  out_ev.data.u64 = (uint64_t)(int64_t)OUT_ID;
+  if (epoll_ctl(ep, EPOLL_CTL_ADD, STDOUT_FILENO, &out_ev) == 0) {
+    out_polled = true;
+    fcntl(STDOUT_FILENO, F_SETFL, out_flags | O_NONBLOCK);
+  }
+
+  bool done = false;
+  while (!done && open_devices) {
+    struct epoll_event events[EVENTS_MAX];
+    int n = epoll_wait(ep, events, EVENTS_MAX, -1);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("epoll_wait");
+      return 1;
+    }
+    for (int i = 0; i < n; i++) {
+      int64_t id = (int64_t)events[i].data.u64;
+      if (id >= 0) {
+        if (devices[id].fd >= 0) {
+          port_ready(ep, &devices[id], events[i].events);
+        }
+      } else if (id == TIMER_ID) {
+        uint64_t expirations;
+        if (read(timer, &expirations, sizeof(expirations)) > 0) {
+          refresh(ep);
+        }
+      } else if (id == SIGNAL_ID) {
+        done = true;
+      } else if (id == OUT_ID) {
+        if (flush_out()) {
+          watch_out(ep, false);
+        }
+      }
+    }
+  }
+
+  // The last table waits for the screen to take it.
+  if (out_polled) {
+    fcntl(STDOUT_FILENO, F_SETFL, out_flags);
+  }
+  out_len = out_done = 0;
+  table(false);
+  flush_out();
+  return 0;
+}
@@ -0,0 +1,396 @@
+// Renders practice clips to WAV files, with the device's timing, for
+// handouts and the like.
+//
+//   ./clip_render [-j threads] [-o dir] [-n clips] [-g groups]
+//                 [-c nchars] [-f farnsworth] [-r rate] [-p pitch]
+//                 [-s seed]
+//
+// Each clip is -g (default 10) groups of random letters, played just
+// as the device plays a drill: a word space, then the letters with
+// the Farnsworth spacing between them. -c and -f take a number or a
+// range like 2-5, and -n clips (default 10) are made for each
+// combination, named like c3_f2_0007.wav. dir/answers.txt lists each
+// clip with its groups.
+//
+// The schedule comes from cw::Player, whose ticks match the firmware's
+// (test/sdk_test.cc checks they do), at the device's tick of 1/1024s.
+// Marks and spaces are placed on the nearest sample, so the timing
+// doesn't drift over a clip at any rate. The tone is shaped like the
+// device's, with a 5ms raised cosine fade in and out.
+//
+// Rather than synthesizing the tone tick by tick, each mark is copied
+// from a cache of ready made marks of each length in samples, of
+// which there are only a handful, and the silence between is zeros.
+// Clips are written out in chunks as they're rendered. Every thread
+// renders its own clips, with its own cache and generator, and the
+// letters come from a generator seeded from -s and the clip's number,
+// so the output doesn't depend on -j.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "cw.hpp"
+
+extern "C" {
+#include "state.h"
+}
+
+#define TICK_HZ 1024
+#define AMPLITUDE 12000
+#define ENVELOPE_MS 5
+
+// Samples rendered before they're written out.
+#define CHUNK_SAMPLES 65536
+
+#define GROUP_CHARS_MAX 5
+
+struct Settings {
+  unsigned rate = 48000;
+  unsigned pitch = 600;
+  unsigned groups = 10;
+  uint64_t seed = 1;
+  std::string dir = ".";
+};
+
+struct Clip {
+  uint8_t nchars;
+  uint8_t farnsworth;
+  uint32_t number;
+  std::string name;
+  std::string answers;
+  uint64_t samples = 0;
+  bool ok = false;
+};
+
+// Ready made marks, by length in samples, each followed by the fade
+// out.
+class Marks {
+ public:
+  explicit Marks(const Settings& s) : settings_(s) {
+    release_ = s.rate * ENVELOPE_MS / 1000;
+  }
+
+  uint32_t release() const {
+    return release_;
+  }
+
+  const std::vector<int16_t>& get(uint32_t len) {
+    auto it = cache_.find(len);
+    if (it != cache_.end()) {
+      return it->second;
+    }
+    std::vector<int16_t>& mark = cache_[len];
+    mark.resize(len + release_);
+    double step = 2 * M_PI * settings_.pitch / settings_.rate;
+    for (uint32_t i = 0; i < len + release_; i++) {
+      // A straight ramp through the raised cosine, as term_tone.c
+      // does.
+      double envelope = 1;
+      if (i < release_) {
+        envelope = (double)i / release_;
+      }
+      if (i >= len) {
+        double from = (len < release_) ? (double)len / release_ : 1;
+        envelope = from * (1 - (double)(i - len) / release_);
+      }
+      double gain = (1 - cos(M_PI * envelope)) / 2;
+      mark[i] = (int16_t)(AMPLITUDE * gain * sin(step * i));
+    }
+    return mark;
+  }
+
+ private:
+  const Settings& settings_;
+  uint32_t release_;
+  std::unordered_map<uint32_t, std::vector<int16_t>> cache_;
+};
+
+static void put_le(uint8_t* p, uint32_t v, int n) {
+  while (n--) {
+    *p++ = v;
+    v >>= 8;
+  }
+}
+
+static void write_wav_header(FILE* f, unsigned rate, uint32_t data_bytes) {
+  uint8_t hdr[44] = "RIFF\0\0\0\0WAVEfmt ";
+  put_le(hdr + 4, 36 + data_bytes, 4);
+  put_le(hdr + 16, 16, 4);
+  put_le(hdr + 20, 1, 2);
+  put_le(hdr + 22, 1, 2);
+  put_le(hdr + 24, rate, 4);
+  put_le(hdr + 28, rate * 2, 4);
+  put_le(hdr + 32, 2, 2);
+  put_le(hdr + 34, 16, 2);
+  put_le(hdr + 36, 0x61746164, 4);
+  put_le(hdr + 40, data_bytes, 4);
+  fwrite(hdr, 1, sizeof(hdr), f);
+}
+
+static uint64_t splitmix(uint64_t* x) {
+  uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+// The samples from base on, written out as the clip goes along.
+class Writer {
+ public:
+  Writer(FILE* f, unsigned rate) : f_(f), rate_(rate), buf_(CHUNK_SAMPLES) {
+    write_wav_header(f_, rate_, 0);
+  }
+
+  // Everything before at is final.
+  void flush_to(uint64_t at) {
+    while (base_ < at) {
+      uint64_t n = at - base_;
+      if (n > buf_.size()) {
+        n = buf_.size();
+      }
+      fwrite(buf_.data(), sizeof(int16_t), n, f_);
+      written_ += n;
+      // Keep what's past the part written, the tail of a fade out.
+      memmove(buf_.data(), buf_.data() + n, (buf_.size() - n) * sizeof(int16_t));
+      memset(buf_.data() + buf_.size() - n, 0, n * sizeof(int16_t));
+      base_ += n;
+    }
+  }
+
+  void mark(uint64_t at, const std::vector<int16_t>& samples) {
+    if (at + samples.size() > base_ + buf_.size()) {
+      flush_to(at);
+      if (samples.size() > buf_.size()) {
+        buf_.resize(samples.size());
+      }
+    }
+    memcpy(buf_.data() + (at - base_), samples.data(),
+           samples.size() * sizeof(int16_t));
+  }
+
+  bool close(uint64_t end) {
+    flush_to(end);
+    fflush(f_);
+    if (fseek(f_, 0, SEEK_SET)) {
+      return false;
+    }
+    write_wav_header(f_, rate_, written_ * sizeof(int16_t));
+    return !ferror(f_);
+  }
+
+ private:
+  FILE* f_;
+  unsigned rate_;
+  std::vector<int16_t> buf_;
+  uint64_t base_ = 0;
+  uint64_t written_ = 0;
+};
+
+template <uint8_t Farnsworth>
+static void render(const Settings& s, Marks* marks, Clip* clip, FILE* f) {
+  cw::Player<WPM, Farnsworth> player;
+  Writer out(f, s.rate);
+  uint64_t rng = s.seed;
+  rng = splitmix(&rng) ^ ((uint64_t)clip->nchars << 40) ^
+    ((uint64_t)Farnsworth << 32) ^ clip->number;
+
+  uint64_t ticks = 0;
+  for (unsigned g = 0; g < s.groups; g++) {
+    player.reset();
+    for (uint8_t i = 0; i < clip->nchars; i++) {
+      uint8_t c = splitmix(&rng) % cw::Letters::count;
+      player.buf[i] = cw::ENCODING[cw::Letters::first + c];
+      clip->answers += (char)('A' + c);
+    }
+    clip->answers += (g + 1 < s.groups) ? ' ' : '\n';
+    player.buf_len = clip->nchars;
+    player.rewind();
+
+    uint32_t at = 0;
+    uint32_t mark_at = 0;
+    cw::Action action;
+    while ((action = player.next(&at)) != cw::Action::None) {
+      if (action == cw::Action::StartMark) {
+        mark_at = at;
+      } else if (action == cw::Action::StartSpace) {
+        // Both ends on the nearest sample to their tick.
+        uint64_t from = ((ticks + mark_at) * s.rate + TICK_HZ / 2) / TICK_HZ;
+        uint64_t to = ((ticks + at) * s.rate + TICK_HZ / 2) / TICK_HZ;
+        out.mark(from, marks->get(to - from));
+      }
+    }
+    ticks += at;
+  }
+  clip->samples = (ticks * s.rate + TICK_HZ / 2) / TICK_HZ;
+  clip->ok = out.close(clip->samples);
+}
+
+typedef void (*render_t)(const Settings&, Marks*, Clip*, FILE*);
+
+static const render_t RENDERERS[] = {
+  render<0>, render<1>, render<2>, render<3>, render<4>, render<5>,
+};
+static_assert(sizeof(RENDERERS) / sizeof(RENDERERS[0]) ==
+              MAX_FARNSWORTH_DITS + 1, "a renderer for each spacing");
+
+static void render_clip(const Settings& s, Marks* marks, Clip* clip) {
+  std::string path = s.dir + "/" + clip->name;
+  FILE* f = fopen(path.c_str(), "wb");
+  if (!f) {
+    perror(path.c_str());
+    return;
+  }
+  static thread_local char buf[1 << 16];
+  setvbuf(f, buf, _IOFBF, sizeof(buf));
+  RENDERERS[clip->farnsworth](s, marks, clip, f);
+  if (fclose(f) || !clip->ok) {
+    perror(path.c_str());
+    clip->ok = false;
+  }
+}
+
+// Parses "3" or "2-5" into lo and hi.
+static bool parse_range(const char* arg, unsigned max, unsigned* lo,
+                        unsigned* hi) {
+  char* end;
+  *lo = *hi = strtoul(arg, &end, 10);
+  if (*end == '-') {
+    *hi = strtoul(end + 1, &end, 10);
+  }
+  return (end != arg) && !*end && (*lo <= *hi) && (*hi <= max);
+}
+
+static void usage(void) {
+  fprintf(stderr,
+          "usage: clip_render [-j threads] [-o dir] [-n clips] [-g groups] "
+          "[-c nchars] [-f farnsworth] [-r rate] [-p pitch] [-s seed]\n");
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  Settings settings;
+  unsigned threads = std::thread::hardware_concurrency();
+  unsigned clips = 10;
+  unsigned nchars_lo = 2, nchars_hi = GROUP_CHARS_MAX;
+  unsigned farnsworth_lo = 0, farnsworth_hi = MAX_FARNSWORTH_DITS;
+  int opt;
+  while ((opt = getopt(argc, argv, "j:o:n:g:c:f:r:p:s:")) != -1) {
+    switch (opt) {
+      case 'j':
+        threads = atoi(optarg);
+        break;
+      case 'o':
+        settings.dir = optarg;
+        break;
+      case 'n':
+        clips = atoi(optarg);
+        break;
+      case 'g':
+        settings.groups = atoi(optarg);
+        break;
+      case 'c':
+        if (!parse_range(optarg, GROUP_CHARS_MAX, &nchars_lo, &nchars_hi) ||
+            !nchars_lo) {
+          usage();
+        }
+        break;
+      case 'f':
+        if (!parse_range(optarg, MAX_FARNSWORTH_DITS, &farnsworth_lo,
+                         &farnsworth_hi)) {
+          usage();
+        }
+        break;
+      case 'r':
+        settings.rate = atoi(optarg);
+        break;
+      case 'p':
+        settings.pitch = atoi(optarg);
+        break;
+      case 's':
+        settings.seed = strtoull(optarg, NULL, 0);
+        break;
+      default:
+        usage();
+    }
+  }
+  if ((optind != argc) || (settings.rate < 8000) || !settings.pitch ||
+      (settings.pitch >= settings.rate / 2) || !settings.groups) {
+    usage();
+  }
+
+  std::vector<Clip> all;
+  for (unsigned c = nchars_lo; c <= nchars_hi; c++) {
+    for (unsigned f = farnsworth_lo; f <= farnsworth_hi; f++) {
+      for (unsigned n = 0; n < clips; n++) {
+        Clip clip;
+        clip.nchars = c;
+        clip.farnsworth = f;
+        clip.number = n;
+        char name[32];
+        snprintf(name, sizeof(name), "c%u_f%u_%04u.wav", c, f, n);
+        clip.name = name;
+        all.push_back(clip);
+      }
+    }
+  }
+  if (threads < 1) {
+    threads = 1;
+  }
+  if (threads > all.size()) {
+    threads = all.size() ? all.size() : 1;
+  }
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    Marks marks(settings);
+    size_t i;
+    while ((i = next++) < all.size()) {
+      render_clip(settings, &marks, &all[i]);
+    }
+  };
+  std::vector<std::thread> pool;
+  for (unsigned t = 0; t < threads; t++) {
+    pool.emplace_back(worker);
+  }
+  for (auto& t : pool) {
+    t.join();
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  std::string path = settings.dir + "/answers.txt";
+  FILE* answers = fopen(path.c_str(), "w");
+  if (!answers) {
+    perror(path.c_str());
+    return 1;
+  }
+  int status = 0;
+  uint64_t samples = 0;
+  for (const Clip& clip : all) {
+    if (!clip.ok) {
+      status = 1;
+    }
+    samples += clip.samples;
+    fprintf(answers, "%s\t%s", clip.name.c_str(), clip.answers.c_str());
+  }
+  fclose(answers);
+
+  double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+  double audio = (double)samples / settings.rate;
+  printf("clip_render: %zu clips, %.0fs of audio in %.2fs, %.0fx real time "
+         "per thread\n", all.size(), audio, secs,
+         (secs > 0) ? audio / secs / threads : 0);
+  return status;
+}
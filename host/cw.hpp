@@ -0,0 +1,537 @@
+#pragma once
+
+// Header-only C++ versions of the morse player (morse.c) and the
+// capture grader (capture.c), for host tools that simulate or grade a
+// lot of sessions.
+//
+// Speed, Farnsworth spacing and the character set are template
+// parameters rather than the WPM macro and runtime arguments, and the
+// tables the code steps through are built at compile time from
+// MORSE_ENCODING. So each instantiation is its own copy of the code,
+// with its timings folded in as constants.
+//
+// Unlike the C versions, there are no globals: each Player owns its
+// buffer and each Grader its timings, so any number can run side by
+// side. With the defaults (WPM, no Farnsworth spacing, letters only)
+// they produce the same ticks and grades as the firmware, and
+// test/sdk_test.cc checks that they do. Characters in a Player's
+// buffer have to come from ENCODING[]. This needs C++17.
+//
+//   cw::Player<25, 2> player;
+//   player.generate(3);
+//   while (player.tick() != cw::Action::None) { ... }
+//
+//   uint32_t at = 0;
+//   while (player.next(&at) != cw::Action::None) { ... }
+//
+//   cw::Grader<25> grader;
+//   ... grader.push_space(); grader.increment(); ...
+//   bool ok = grader.match(player.buf, player.buf_len);
+//
+//   cw::BatchGrader<25> batch;
+//   batch.grade(attempts, &verdicts);
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <vector>
+
+#include "encoding.h"
+extern "C" {
+#include "morse.h"
+}
+
+namespace cw {
+
+constexpr uint8_t ENCODING[] = {MORSE_ENCODING};
+constexpr uint8_t NUM_CHARS = sizeof(ENCODING);
+
+// Same values as morse_action_t.
+enum class Action : uint8_t {
+  None = MORSE_NONE,
+  Hold = MORSE_HOLD,
+  StartMark = MORSE_START_MARK,
+  StartSpace = MORSE_START_SPACE,
+};
+
+constexpr bool is_dah(uint8_t encoded, uint8_t pos) {
+  return encoded & (1 << pos);
+}
+
+constexpr uint8_t num_elements(uint8_t encoded) {
+  uint8_t pos = 7;
+  while (pos && !(encoded & (1 << pos))) {
+    pos--;
+  }
+  return pos;
+}
+
+// A contiguous run of ENCODING[] to draw random characters from.
+template <uint8_t First, uint8_t Count>
+struct Charset {
+  static_assert(Count && (First + Count <= NUM_CHARS), "bad charset");
+  static constexpr uint8_t first = First;
+  static constexpr uint8_t count = Count;
+};
+
+using Letters = Charset<0, 26>;
+using Digits = Charset<26, 10>;
+using Alphanumeric = Charset<0, NUM_CHARS>;
+
+// Mark lengths in ticks for each element of each character, in the
+// order they're sent, plus a reverse lookup from encodings.
+template <uint16_t DitTicks>
+struct Schedule {
+  uint8_t index[256];
+  uint8_t len[NUM_CHARS];
+  uint16_t marks[NUM_CHARS][7];
+
+  constexpr Schedule() : index(), len(), marks() {
+    for (int e = 0; e < 256; e++) {
+      index[e] = NUM_CHARS;
+    }
+    for (uint8_t c = 0; c < NUM_CHARS; c++) {
+      uint8_t encoded = ENCODING[c];
+      index[encoded] = c;
+      len[c] = num_elements(encoded);
+      for (uint8_t i = 0; i < len[c]; i++) {
+        marks[c][i] = is_dah(encoded, len[c] - 1 - i) ?
+          3 * DitTicks : DitTicks;
+      }
+    }
+  }
+};
+
+template <unsigned Wpm = WPM, uint8_t Farnsworth = 0,
+          typename Chars = Letters>
+class Player {
+ public:
+  static constexpr uint16_t DIT = 1200 / Wpm;
+  static constexpr uint16_t LETTER_SPACE = DIT * (3 + Farnsworth);
+
+  uint8_t buf[5] = {0, 0, 0, 0, 0};
+  uint8_t buf_len = 0;
+
+  void reset() {
+    buf_len = 0;
+    rewind();
+    countdown_ = 0;
+  }
+
+  // Plays the buffer again after a word space.
+  void rewind() {
+    buf_sent_ = 0;
+    letter_ = 0;
+    letter_len_ = 0;
+    letter_sent_ = 0;
+    in_mark_ = false;
+    countdown_ = 5 * DIT;
+  }
+
+  void flush() {
+    buf_sent_ = buf_len;
+    letter_sent_ = letter_len_;
+    countdown_ = 0;
+    in_mark_ = false;
+  }
+
+  void set(uint8_t char_idx) {
+    reset();
+    buf[0] = ENCODING[(char_idx < NUM_CHARS) ? char_idx : 0];
+    buf_len = 1;
+    countdown_ = 5 * DIT;
+  }
+
+  // Starts the generator from state, like morse_random_seed().
+  void seed(uint32_t state) {
+    random_ = state;
+  }
+
+  // Draws letters just like morse_random_generate().
+  void generate(uint8_t nchars) {
+    reset();
+    if (nchars > sizeof(buf)) {
+      nchars = sizeof(buf);
+    }
+    for (uint8_t i = 0; i < nchars; i++) {
+      buf[i] = ENCODING[Chars::first + next_random() % Chars::count];
+    }
+    buf_len = nchars;
+    countdown_ = 5 * DIT;
+  }
+
+  Action tick() {
+    if (!countdown_) {
+      return Action::None;
+    }
+    if (--countdown_) {
+      return Action::Hold;
+    }
+    if (in_mark_) {
+      countdown_ = DIT;
+      in_mark_ = false;
+      return Action::StartSpace;
+    }
+
+    if (letter_sent_ >= letter_len_) {
+      if (buf_sent_ >= buf_len) {
+        return Action::None;
+      }
+      letter_ = SCHEDULE.index[buf[buf_sent_++]];
+      letter_len_ = (letter_ < NUM_CHARS) ? SCHEDULE.len[letter_] : 0;
+      letter_sent_ = 0;
+      countdown_ = LETTER_SPACE;
+      return Action::Hold;
+    }
+    countdown_ = SCHEDULE.marks[letter_][letter_sent_++];
+    in_mark_ = true;
+    return Action::StartMark;
+  }
+
+  // Skips over the holds: returns what tick() would next return other
+  // than Hold, and adds the number of tick()s that would take to
+  // *ticks. For renderers that work in whole elements.
+  Action next(uint32_t* ticks) {
+    for (;;) {
+      if (!countdown_) {
+        return Action::None;
+      }
+      *ticks += countdown_;
+      countdown_ = 1;
+      Action action = tick();
+      if (action != Action::Hold) {
+        return action;
+      }
+    }
+  }
+
+ private:
+  static constexpr Schedule<DIT> SCHEDULE{};
+
+  // The same steps as morse_random().
+  uint16_t next_random() {
+    int32_t x = random_ ? random_ : 123459876L;
+    int32_t hi = x / 127773L;
+    int32_t lo = x % 127773L;
+    x = 16807L * lo - 2836L * hi;
+    if (x < 0) {
+      x += 0x7fffffffL;
+    }
+    random_ = x;
+    return x % 0x8000U;
+  }
+
+  uint8_t buf_sent_ = 0;
+  // Index of the current letter in ENCODING[].
+  uint8_t letter_ = 0;
+  uint8_t letter_len_ = 0;
+  uint8_t letter_sent_ = 0;
+  uint16_t countdown_ = 0;
+  bool in_mark_ = false;
+  uint32_t random_ = 1;
+};
+
+template <unsigned Wpm = WPM>
+class Grader {
+ public:
+  static constexpr uint16_t DIT = 1200 / Wpm;
+  static constexpr uint8_t TIMING_MAX = 50;
+  static constexpr int16_t TICKS_MAX = 2000;
+  static constexpr uint16_t SLOP_TICKS = 50;
+  static constexpr uint8_t MISS_EMPTY = 0xff;
+
+  void reset() {
+    for (uint8_t i = 0; i <= TIMING_MAX; i++) {
+      timing_[i] = 0;
+    }
+    len_ = 0;
+    in_mark_ = false;
+  }
+
+  void increment() {
+    if (timing_[len_] < TICKS_MAX) {
+      timing_[len_]++;
+    }
+  }
+
+  void push_mark() {
+    if (len_ < TIMING_MAX) {
+      len_++;
+    }
+    in_mark_ = false;
+  }
+
+  void push_space() {
+    if (len_ == 0) {
+      timing_[0] = 0;
+    } else if (len_ < TIMING_MAX) {
+      timing_[len_] = -timing_[len_];
+      len_++;
+    }
+    in_mark_ = true;
+  }
+
+  // Records a whole mark (positive) or space (negative) at once, just
+  // as a push and a run of increment()s would.
+  void push(int16_t t) {
+    if (t > 0) {
+      push_space();
+    }
+    uint16_t n = (t > 0) ? t : -t;
+    int16_t v = timing_[len_];
+    if (v < TICKS_MAX) {
+      timing_[len_] = (n >= TICKS_MAX - v) ? TICKS_MAX : v + n;
+    }
+    if (t > 0) {
+      push_mark();
+    }
+  }
+
+  bool timeout() const {
+    return !in_mark_ && (timing_[len_] >= TICKS_MAX);
+  }
+
+  uint8_t missed_char() const {
+    return missed_;
+  }
+
+  // The timings recorded so far, for grade_batch().
+  const int16_t* timings() const {
+    return timing_;
+  }
+
+  uint8_t len() const {
+    return len_;
+  }
+
+  bool match(const uint8_t* buf, uint8_t buf_len) {
+    uint8_t idx = 0;
+    if ((len_ == 0) && (buf_len > 0)) {
+      missed_ = MISS_EMPTY;
+      return false;
+    }
+
+    for (uint8_t i = 0; i < buf_len; i++) {
+      missed_ = i;
+      uint8_t encoded = buf[i];
+      for (int8_t pos = num_elements(encoded) - 1; pos >= 0; pos--) {
+        if (idx >= len_) {
+          return false;
+        }
+        if (!is_close(timing_[idx], is_dah(encoded, pos))) {
+          return false;
+        }
+
+        bool last_element = (pos == 0);
+        if (last_element && (i == buf_len - 1)) {
+          // The final space isn't recorded.
+          idx++;
+          continue;
+        }
+
+        idx++;
+        if (idx >= len_) {
+          return false;
+        }
+        uint16_t actual = -timing_[idx];
+        if (last_element) {
+          if (actual < 4 * DIT - SLOP_TICKS) {
+            return false;
+          }
+        } else if (!is_close(actual, false)) {
+          return false;
+        }
+        idx++;
+      }
+    }
+
+    missed_ = buf_len;
+    return idx == len_;
+  }
+
+ private:
+  static constexpr bool is_close(uint16_t actual, bool dah) {
+    return dah ? ((actual >= 2 * DIT) && (actual <= 4 * DIT)) :
+      ((actual >= DIT / 2) && (actual <= (DIT * 3) / 2));
+  }
+
+  // One more than can be pushed, as timings keep counting after the
+  // last push.
+  int16_t timing_[TIMING_MAX + 1] = {};
+  uint8_t len_ = 0;
+  bool in_mark_ = false;
+  uint8_t missed_ = 0;
+};
+
+// Many attempts at once, as a structure of arrays. Attempt i's timings
+// are timings[timing_offsets[i]] up to timings[timing_offsets[i + 1]],
+// as a Grader records them: alternating marks and spaces, starting
+// with a mark. What it was graded against is likewise in expected[],
+// as encodings from ENCODING[].
+struct Attempts {
+  size_t count;
+  const int16_t* timings;
+  const uint32_t* timing_offsets;
+  const uint8_t* expected;
+  const uint32_t* expected_offsets;
+};
+
+// What's wrong with each timing.
+enum class Error : uint8_t {
+  Ok,
+  Short,
+  Long,
+  // Past the last element expected.
+  Extra,
+};
+
+// Results from BatchGrader::grade(). passed and missed have an entry
+// for each attempt, just as Grader::match() and missed_char() would
+// give. errors has one for each timing in the batch, starting from
+// the one at timing_offsets[0].
+struct Verdicts {
+  uint8_t* passed;
+  uint8_t* missed;
+  Error* errors;
+};
+
+// Grades Attempts by the same rules as Grader::match().
+//
+// First the expected elements are laid out beside the timings, as the
+// range each timing has to be in. Then every timing in the batch is
+// checked against its range in one branch free pass, which the
+// compiler vectorizes across attempts. That leaves each attempt's
+// verdict to come from its first error, if any. A grader keeps its
+// buffers from one batch to the next, so one per thread is best.
+template <unsigned Wpm = WPM>
+class BatchGrader {
+ public:
+  static constexpr uint16_t DIT = Grader<Wpm>::DIT;
+
+  void grade(const Attempts& a, Verdicts* v) {
+    size_t total = a.timing_offsets[a.count] - a.timing_offsets[0];
+    lo_.resize(total);
+    hi_.resize(total);
+    negate_.resize(total);
+    for (size_t i = 0; i < a.count; i++) {
+      lay_out(a, i);
+    }
+
+    const int16_t* t = a.timings + a.timing_offsets[0];
+    const uint16_t* lo = lo_.data();
+    const uint16_t* hi = hi_.data();
+    const uint16_t* negate = negate_.data();
+    uint8_t* errors = reinterpret_cast<uint8_t*>(v->errors);
+    for (size_t j = 0; j < total; j++) {
+      // Spaces are negative, and negated just as Grader does, into
+      // an unsigned 16 bits.
+      uint16_t actual = ((uint16_t)t[j] ^ negate[j]) - negate[j];
+      errors[j] = (actual < lo[j]) + 2 * (actual > hi[j]);
+    }
+
+    for (size_t i = 0; i < a.count; i++) {
+      verdict(a, i, v);
+    }
+  }
+
+ private:
+  static constexpr uint16_t SLOP_TICKS = Grader<Wpm>::SLOP_TICKS;
+
+  // Timings the elements in an attempt add up to: a mark each, and a
+  // space after all but the last.
+  static uint32_t expected_timings(const Attempts& a, size_t i) {
+    uint32_t elements = 0;
+    for (uint32_t c = a.expected_offsets[i]; c < a.expected_offsets[i + 1];
+         c++) {
+      elements += num_elements(a.expected[c]);
+    }
+    return elements ? 2 * elements - 1 : 0;
+  }
+
+  void set(size_t j, uint16_t lo, uint16_t hi, bool space) {
+    lo_[j] = lo;
+    hi_[j] = hi;
+    negate_[j] = space ? 0xffff : 0;
+  }
+
+  void lay_out(const Attempts& a, size_t i) {
+    size_t j = a.timing_offsets[i] - a.timing_offsets[0];
+    size_t end = a.timing_offsets[i + 1] - a.timing_offsets[0];
+    for (uint32_t c = a.expected_offsets[i];
+         (c < a.expected_offsets[i + 1]) && (j < end); c++) {
+      uint8_t encoded = a.expected[c];
+      for (int8_t pos = num_elements(encoded) - 1; (pos >= 0) && (j < end);
+           pos--) {
+        if (is_dah(encoded, pos)) {
+          set(j++, 2 * DIT, 4 * DIT, false);
+        } else {
+          set(j++, DIT / 2, (DIT * 3) / 2, false);
+        }
+        if (j == end) {
+          break;
+        }
+        if (pos) {
+          set(j++, DIT / 2, (DIT * 3) / 2, true);
+        } else {
+          // Any letter space will do, so long as it's long enough.
+          set(j++, 4 * DIT - SLOP_TICKS, 0xffff, true);
+        }
+      }
+    }
+    // Anything left over is extra, and set aside afterwards.
+    for (; j < end; j++) {
+      set(j, 0, 0xffff, false);
+    }
+  }
+
+  // The character in attempt i that timing slot belongs to.
+  static uint8_t char_at(const Attempts& a, size_t i, uint32_t slot) {
+    uint32_t first = a.expected_offsets[i];
+    for (uint32_t c = first; c < a.expected_offsets[i + 1]; c++) {
+      uint32_t n = 2 * num_elements(a.expected[c]);
+      if (slot < n) {
+        return c - first;
+      }
+      slot -= n;
+    }
+    return a.expected_offsets[i + 1] - first;
+  }
+
+  void verdict(const Attempts& a, size_t i, Verdicts* v) {
+    uint32_t base = a.timing_offsets[i] - a.timing_offsets[0];
+    uint32_t len = a.timing_offsets[i + 1] - a.timing_offsets[i];
+    uint8_t nchars = a.expected_offsets[i + 1] - a.expected_offsets[i];
+    uint32_t expected = expected_timings(a, i);
+    Error* errors = v->errors + base;
+
+    // The last timing checked, as the grader stops at the end of what
+    // was expected.
+    uint32_t checked = (len < expected) ? len : expected;
+    for (uint32_t j = checked; j < len; j++) {
+      errors[j] = Error::Extra;
+    }
+    v->passed[i] = false;
+    if ((len == 0) && (nchars > 0)) {
+      v->missed[i] = Grader<Wpm>::MISS_EMPTY;
+      return;
+    }
+    for (uint32_t j = 0; j < checked; j++) {
+      if (errors[j] != Error::Ok) {
+        v->missed[i] = char_at(a, i, j);
+        return;
+      }
+    }
+    if (len < expected) {
+      v->missed[i] = char_at(a, i, len);
+      return;
+    }
+    v->missed[i] = nchars;
+    v->passed[i] = len == expected;
+  }
+
+  std::vector<uint16_t> lo_;
+  std::vector<uint16_t> hi_;
+  std::vector<uint16_t> negate_;
+};
+
+}  // namespace cw
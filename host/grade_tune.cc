@@ -0,0 +1,700 @@
+// Tunes the grading constants in capture.c against a corpus of
+// attempts that someone has already judged good or bad, so that the
+// device passes the ones they passed and fails the rest.
+//
+//   ./grade_tune [-j threads] [-o prefix] corpus.lab ...
+//   ./grade_tune -g attempts [-s seed] > corpus.lab
+//
+// A labeled corpus is a timing file, as timing_stats reads, with each
+// attempt's little endian int16 0 followed by an int16 label: 1 if it
+// was judged good and 0 if not. Then come the number of characters,
+// their ASCII codes and the timings, as before.
+//
+// The constants, all in ticks, are:
+//
+//   dit_lo, dit_hi   the range for dits and the spaces inside letters
+//                    (DIT_TICKS / 2 and 3 * DIT_TICKS / 2)
+//   dah_lo, dah_hi   the range for dahs (2 and 4 * DIT_TICKS)
+//   letter_gap       the shortest space between letters
+//                    (4 * DIT_TICKS - ELEMENT_SLOP_TICKS)
+//   ticks_max        a space this long ends the attempt, so one before
+//                    the last mark fails it (TIMING_TICKS_MAX)
+//
+// An attempt passes when it has the timings that were asked for and
+// each is in its range, so it comes down to the shortest and longest
+// of each kind of timing in it. Those are worked out once, as the
+// files are read, and attempts that come down to the same figures are
+// merged, keeping a count of how many were good and how many bad.
+// Trying a set of constants is then one branch free pass over the
+// merged figures, which the compiler vectorizes.
+//
+// The search starts with a grid over every constant in steps of a
+// quarter of a dit, and then moves one constant at a time, a tick at
+// a time, for as long as that does better. The candidates at each
+// step are shared out between threads. The merged figures are
+// ordered by how many attempts they stand for, and a candidate is
+// dropped as soon as it has made more mistakes than the best so far.
+// Ties go to the constants closest to the ones the device has now.
+//
+// The output has a line for the device's constants and one for the
+// best found, each with how often they agree with the labels and the
+// precision and recall of a pass as a judgment of good, in percent.
+// With -o, they go to prefix.tsv instead of stdout, and
+// prefix_curves.tsv gets the same figures for each value of each
+// constant, with the others at their best: the precision and recall
+// curve as that constant is loosened.
+//
+// With -g, a corpus of random attempts labeled by the device's own
+// rules is written instead, for trying the search out. The constants
+// found for it agree with every label.
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cw.hpp"
+
+// Longest attempt graded, the most the device can send.
+#define ATTEMPT_CHARS_MAX 5
+
+// Merged figures checked between looks at the best so far.
+#define CHUNK 1024
+
+// Passes of moving one constant at a time.
+#define REFINE_PASSES_MAX 20
+
+using Grader = cw::Grader<>;
+static constexpr uint16_t DIT = Grader::DIT;
+
+enum {
+  DIT_LO,
+  DIT_HI,
+  DAH_LO,
+  DAH_HI,
+  LETTER_GAP,
+  TICKS_MAX,
+  NUM_CONSTANTS
+};
+
+static const char* const NAMES[NUM_CONSTANTS] = {
+  "dit_lo", "dit_hi", "dah_lo", "dah_hi", "letter_gap", "ticks_max",
+};
+
+struct Constants {
+  uint16_t v[NUM_CONSTANTS];
+};
+
+// capture.c's, by way of cw::Grader.
+static constexpr Constants CURRENT = {{
+  DIT / 2, (DIT * 3) / 2, 2 * DIT, 4 * DIT, 4 * DIT - Grader::SLOP_TICKS,
+  Grader::TICKS_MAX,
+}};
+
+// Where each constant is searched. ticks_max stays above the longest
+// dah, so a mark cut short by it still fails.
+struct Range {
+  uint16_t lo, hi, coarse, fine;
+};
+
+static constexpr Range RANGES[NUM_CONSTANTS] = {
+  {0, DIT, DIT / 4, 1},
+  {DIT, 2 * DIT, DIT / 4, 1},
+  {DIT, 3 * DIT, DIT / 4, 1},
+  {3 * DIT, 6 * DIT, DIT / 4, 1},
+  {DIT, 5 * DIT, DIT / 4, 1},
+  {8 * DIT, Grader::TICKS_MAX, Grader::TICKS_MAX - 8 * DIT, 10},
+};
+
+// What an attempt comes down to: the shortest and longest of each
+// kind of timing in it, or 0xffff and 0 if it has none.
+enum {
+  DIT_MIN,
+  DIT_MAX,
+  DAH_MIN,
+  DAH_MAX,
+  LETTER_GAP_MIN,
+  SPACE_MAX,
+  NUM_FIGURES
+};
+
+struct Row {
+  uint16_t f[NUM_FIGURES];
+  uint32_t good = 0, bad = 0;
+};
+
+// One file's attempts, as read.
+struct Part {
+  bool ok = false;
+  std::vector<Row> rows;
+  // Those without the timings asked for, which fail whatever the
+  // constants.
+  uint32_t failed_good = 0, failed_bad = 0;
+};
+
+// All the merged figures, as a structure of arrays, heaviest first.
+// good_before[j] is how many good attempts come before row j.
+struct Corpus {
+  size_t rows = 0;
+  std::vector<uint16_t> f[NUM_FIGURES];
+  std::vector<uint32_t> good, bad;
+  std::vector<uint64_t> good_before;
+  uint64_t attempts = 0, good_total = 0, failed_good = 0;
+};
+
+struct Score {
+  uint64_t passed_good = 0, passed_bad = 0, errors = 0;
+};
+
+// ASCII to an ENCODING[] index, or NUM_CHARS.
+static uint8_t char_index(int c) {
+  if ((c >= 'A') && (c <= 'Z')) {
+    return c - 'A';
+  }
+  if ((c >= 'a') && (c <= 'z')) {
+    return c - 'a';
+  }
+  if ((c >= '0') && (c <= '9')) {
+    return 26 + c - '0';
+  }
+  return cw::NUM_CHARS;
+}
+
+static char index_char(uint8_t idx) {
+  return (idx < 26) ? 'A' + idx : '0' + idx - 26;
+}
+
+static void lower(uint16_t* f, uint16_t v) {
+  if (v < *f) {
+    *f = v;
+  }
+}
+
+static void raise(uint16_t* f, uint16_t v) {
+  if (v > *f) {
+    *f = v;
+  }
+}
+
+// Lines the timings up with the elements asked for, as Grader::match()
+// does. Returns false if they don't have the timings asked for.
+static bool figures(const uint8_t* buf, uint8_t nchars, const int16_t* t,
+                    uint8_t len, Row* row) {
+  uint8_t expected = 0;
+  for (uint8_t i = 0; i < nchars; i++) {
+    expected += 2 * cw::num_elements(buf[i]);
+  }
+  if (len + 1 != expected) {
+    return false;
+  }
+
+  row->f[DIT_MIN] = row->f[DAH_MIN] = row->f[LETTER_GAP_MIN] = 0xffff;
+  row->f[DIT_MAX] = row->f[DAH_MAX] = row->f[SPACE_MAX] = 0;
+  uint8_t idx = 0;
+  for (uint8_t i = 0; i < nchars; i++) {
+    for (int8_t pos = cw::num_elements(buf[i]) - 1; pos >= 0; pos--) {
+      uint16_t mark = t[idx++];
+      if (cw::is_dah(buf[i], pos)) {
+        lower(&row->f[DAH_MIN], mark);
+        raise(&row->f[DAH_MAX], mark);
+      } else {
+        lower(&row->f[DIT_MIN], mark);
+        raise(&row->f[DIT_MAX], mark);
+      }
+      if (idx == len) {
+        break;
+      }
+      uint16_t space = -t[idx++];
+      raise(&row->f[SPACE_MAX], space);
+      if (pos) {
+        lower(&row->f[DIT_MIN], space);
+        raise(&row->f[DIT_MAX], space);
+      } else {
+        lower(&row->f[LETTER_GAP_MIN], space);
+      }
+    }
+  }
+  return true;
+}
+
+static void attempt(Part* p, Grader* grader, const uint8_t* chars,
+                    uint8_t nchars, bool good, const int16_t* t, size_t len) {
+  uint8_t buf[ATTEMPT_CHARS_MAX];
+  for (uint8_t i = 0; i < nchars; i++) {
+    buf[i] = cw::ENCODING[chars[i]];
+  }
+  grader->reset();
+  for (size_t i = 0; i < len; i++) {
+    grader->push(t[i]);
+  }
+  Row row;
+  if (!figures(buf, nchars, grader->timings(), grader->len(), &row)) {
+    if (good) {
+      p->failed_good++;
+    } else {
+      p->failed_bad++;
+    }
+    return;
+  }
+  (good ? row.good : row.bad) = 1;
+  p->rows.push_back(row);
+}
+
+static bool read_corpus(Part* p, const char* path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    perror(path);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    perror(path);
+    close(fd);
+    return false;
+  }
+  size_t len = st.st_size / sizeof(int16_t);
+  if (!len) {
+    close(fd);
+    return true;
+  }
+  void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    perror(path);
+    return false;
+  }
+  madvise(map, st.st_size, MADV_SEQUENTIAL);
+  const int16_t* data = (const int16_t*)map;
+
+  Grader grader;
+  size_t i = 0;
+  bool ok = true;
+  while (i < len) {
+    if (data[i] != 0) {
+      fprintf(stderr, "%s: expected an attempt at %zu\n", path,
+              i * sizeof(int16_t));
+      ok = false;
+      break;
+    }
+    i++;
+    int16_t label = (i < len) ? data[i++] : -1;
+    uint8_t nchars = (i < len) ? data[i++] : 0;
+    if ((label < 0) || (label > 1) || (nchars == 0) ||
+        (nchars > ATTEMPT_CHARS_MAX) || (i + nchars > len)) {
+      fprintf(stderr, "%s: bad attempt at %zu\n", path, i * sizeof(int16_t));
+      ok = false;
+      break;
+    }
+    uint8_t chars[ATTEMPT_CHARS_MAX];
+    for (uint8_t c = 0; c < nchars; c++) {
+      chars[c] = char_index(data[i++]);
+      if (chars[c] >= cw::NUM_CHARS) {
+        ok = false;
+      }
+    }
+    if (!ok) {
+      fprintf(stderr, "%s: bad character at %zu\n", path, i * sizeof(int16_t));
+      break;
+    }
+    size_t start = i;
+    while ((i < len) && (data[i] != 0)) {
+      i++;
+    }
+    attempt(p, &grader, chars, nchars, label, data + start, i - start);
+  }
+  munmap(map, st.st_size);
+  p->ok = ok;
+  return ok;
+}
+
+static bool same_figures(const Row& a, const Row& b) {
+  return !memcmp(a.f, b.f, sizeof(a.f));
+}
+
+static void merge(std::vector<Part>& parts, Corpus* c) {
+  std::vector<Row> rows;
+  for (Part& p : parts) {
+    rows.insert(rows.end(), p.rows.begin(), p.rows.end());
+    c->attempts += p.rows.size() + p.failed_good + p.failed_bad;
+    c->good_total += p.failed_good;
+    c->failed_good += p.failed_good;
+    std::vector<Row>().swap(p.rows);
+  }
+  std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) {
+    return memcmp(a.f, b.f, sizeof(a.f)) < 0;
+  });
+  size_t n = 0;
+  for (size_t i = 0; i < rows.size(); i++) {
+    if (n && same_figures(rows[n - 1], rows[i])) {
+      rows[n - 1].good += rows[i].good;
+      rows[n - 1].bad += rows[i].bad;
+    } else {
+      rows[n++] = rows[i];
+    }
+  }
+  rows.resize(n);
+  std::stable_sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) {
+    return a.good + a.bad > b.good + b.bad;
+  });
+
+  c->rows = n;
+  for (int k = 0; k < NUM_FIGURES; k++) {
+    c->f[k].resize(n);
+  }
+  c->good.resize(n);
+  c->bad.resize(n);
+  c->good_before.resize(n + 1);
+  c->good_before[0] = 0;
+  for (size_t j = 0; j < n; j++) {
+    for (int k = 0; k < NUM_FIGURES; k++) {
+      c->f[k][j] = rows[j].f[k];
+    }
+    c->good[j] = rows[j].good;
+    c->bad[j] = rows[j].bad;
+    c->good_before[j + 1] = c->good_before[j] + rows[j].good;
+  }
+  c->good_total += c->good_before[n];
+}
+
+// Scores a set of constants, unless it makes more than limit mistakes,
+// in which case it stops as soon as it has and returns false.
+static bool evaluate(const Corpus& c, const Constants& k, uint64_t limit,
+                     Score* s) {
+  const uint16_t* dit_min = c.f[DIT_MIN].data();
+  const uint16_t* dit_max = c.f[DIT_MAX].data();
+  const uint16_t* dah_min = c.f[DAH_MIN].data();
+  const uint16_t* dah_max = c.f[DAH_MAX].data();
+  const uint16_t* gap_min = c.f[LETTER_GAP_MIN].data();
+  const uint16_t* space_max = c.f[SPACE_MAX].data();
+  const uint32_t* good = c.good.data();
+  const uint32_t* bad = c.bad.data();
+  uint64_t passed_good = 0, passed_bad = 0;
+  for (size_t start = 0; start < c.rows; start += CHUNK) {
+    size_t end = std::min(start + CHUNK, c.rows);
+    uint32_t chunk_good = 0, chunk_bad = 0;
+    for (size_t j = start; j < end; j++) {
+      uint32_t pass = (dit_min[j] >= k.v[DIT_LO]) &
+        (dit_max[j] <= k.v[DIT_HI]) & (dah_min[j] >= k.v[DAH_LO]) &
+        (dah_max[j] <= k.v[DAH_HI]) & (gap_min[j] >= k.v[LETTER_GAP]) &
+        (space_max[j] < k.v[TICKS_MAX]);
+      chunk_good += pass * good[j];
+      chunk_bad += pass * bad[j];
+    }
+    passed_good += chunk_good;
+    passed_bad += chunk_bad;
+    uint64_t errors =
+      c.failed_good + c.good_before[end] - passed_good + passed_bad;
+    if (errors > limit) {
+      return false;
+    }
+  }
+  s->passed_good = passed_good;
+  s->passed_bad = passed_bad;
+  s->errors = c.good_total - passed_good + passed_bad;
+  return true;
+}
+
+static uint32_t distance(const Constants& k) {
+  uint32_t d = 0;
+  for (int i = 0; i < NUM_CONSTANTS; i++) {
+    d += abs(k.v[i] - CURRENT.v[i]);
+  }
+  return d;
+}
+
+// The best candidate so far. errors is kept apart so that workers can
+// check it without taking the lock.
+struct Best {
+  std::mutex lock;
+  std::atomic<uint64_t> errors{UINT64_MAX};
+  Constants k = CURRENT;
+  Score score;
+  uint32_t evaluated = 0, pruned = 0;
+
+  void offer(const Constants& c, const Score& s) {
+    std::lock_guard<std::mutex> guard(lock);
+    uint64_t e = errors;
+    uint32_t d = distance(c), best_d = distance(k);
+    if ((s.errors < e) || ((s.errors == e) && (d < best_d)) ||
+        ((s.errors == e) && (d == best_d) &&
+         (memcmp(c.v, k.v, sizeof(c.v)) < 0))) {
+      k = c;
+      score = s;
+      errors = s.errors;
+    }
+  }
+};
+
+static void run_pool(unsigned threads, size_t count,
+                     const std::function<void(size_t)>& work) {
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    size_t i;
+    while ((i = next++) < count) {
+      work(i);
+    }
+  };
+  std::vector<std::thread> pool;
+  for (unsigned t = 0; t < threads; t++) {
+    pool.emplace_back(worker);
+  }
+  for (auto& t : pool) {
+    t.join();
+  }
+}
+
+static void search(const Corpus& c, unsigned threads,
+                   const std::vector<Constants>& candidates, Best* best) {
+  std::atomic<uint32_t> pruned(0);
+  run_pool(threads, candidates.size(), [&](size_t i) {
+    Score s;
+    if (evaluate(c, candidates[i], best->errors, &s)) {
+      best->offer(candidates[i], s);
+    } else {
+      pruned++;
+    }
+  });
+  best->evaluated += candidates.size();
+  best->pruned += pruned;
+}
+
+static std::vector<uint16_t> values(int k, bool coarse) {
+  const Range& r = RANGES[k];
+  uint16_t step = coarse ? r.coarse : r.fine;
+  std::vector<uint16_t> v;
+  for (uint32_t x = r.lo; x <= r.hi; x += step) {
+    v.push_back(x);
+  }
+  return v;
+}
+
+static void grid(const Corpus& c, unsigned threads, Best* best) {
+  std::vector<Constants> candidates(1, CURRENT);
+  for (int k = 0; k < NUM_CONSTANTS; k++) {
+    std::vector<Constants> next;
+    for (const Constants& base : candidates) {
+      for (uint16_t x : values(k, true)) {
+        Constants cand = base;
+        cand.v[k] = x;
+        next.push_back(cand);
+      }
+    }
+    candidates.swap(next);
+  }
+  search(c, threads, candidates, best);
+}
+
+static void refine(const Corpus& c, unsigned threads, Best* best) {
+  for (int pass = 0; pass < REFINE_PASSES_MAX; pass++) {
+    Constants before = best->k;
+    for (int k = 0; k < NUM_CONSTANTS; k++) {
+      std::vector<Constants> candidates;
+      for (uint16_t x : values(k, false)) {
+        Constants cand = best->k;
+        cand.v[k] = x;
+        candidates.push_back(cand);
+      }
+      search(c, threads, candidates, best);
+    }
+    if (!memcmp(before.v, best->k.v, sizeof(before.v))) {
+      break;
+    }
+  }
+}
+
+static double percent(uint64_t n, uint64_t d) {
+  return d ? 100.0 * n / d : 0;
+}
+
+static void print_score(FILE* out, const Corpus& c, const Score& s) {
+  fprintf(out, "%.2f\t%.2f\t%.2f\n", percent(c.attempts - s.errors, c.attempts),
+          percent(s.passed_good, s.passed_good + s.passed_bad),
+          percent(s.passed_good, c.good_total));
+}
+
+static void print_constants(FILE* out, const char* name, const Corpus& c,
+                            const Constants& k) {
+  Score s;
+  evaluate(c, k, UINT64_MAX, &s);
+  fprintf(out, "%s", name);
+  for (int i = 0; i < NUM_CONSTANTS; i++) {
+    fprintf(out, "\t%u", k.v[i]);
+  }
+  fprintf(out, "\t");
+  print_score(out, c, s);
+}
+
+static void print_curves(FILE* out, const Corpus& c, unsigned threads,
+                         const Constants& best) {
+  for (int k = 0; k < NUM_CONSTANTS; k++) {
+    std::vector<uint16_t> v = values(k, false);
+    std::vector<Score> scores(v.size());
+    run_pool(threads, v.size(), [&](size_t i) {
+      Constants cand = best;
+      cand.v[k] = v[i];
+      evaluate(c, cand, UINT64_MAX, &scores[i]);
+    });
+    for (size_t i = 0; i < v.size(); i++) {
+      fprintf(out, "%s\t%u\t", NAMES[k], v[i]);
+      print_score(out, c, scores[i]);
+    }
+  }
+}
+
+static uint64_t splitmix(uint64_t* x) {
+  uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+// Each attempt has its own spread, of up to 60% either way, so that
+// there are plenty of near misses.
+static void generate(uint32_t count, uint64_t seed) {
+  uint64_t rng = seed;
+  Grader grader;
+  std::vector<int16_t> out;
+  for (uint32_t n = 0; n < count; n++) {
+    uint8_t nchars = 1 + splitmix(&rng) % ATTEMPT_CHARS_MAX;
+    int spread = splitmix(&rng) % 61;
+    uint8_t chars[ATTEMPT_CHARS_MAX];
+    uint8_t buf[ATTEMPT_CHARS_MAX];
+    for (uint8_t i = 0; i < nchars; i++) {
+      chars[i] = splitmix(&rng) % cw::NUM_CHARS;
+      buf[i] = cw::ENCODING[chars[i]];
+    }
+    std::vector<int16_t> t;
+    auto jitter = [&](int ticks) {
+      int pct = (int)(splitmix(&rng) % (2 * spread + 1)) - spread;
+      return (int16_t)(ticks + ticks * pct / 100);
+    };
+    for (uint8_t i = 0; i < nchars; i++) {
+      for (int8_t pos = cw::num_elements(buf[i]) - 1; pos >= 0; pos--) {
+        t.push_back(jitter(cw::is_dah(buf[i], pos) ? 3 * DIT : DIT));
+        if (pos) {
+          t.push_back(-jitter(DIT));
+        } else if (i < nchars - 1) {
+          t.push_back(-jitter(4 * DIT));
+        }
+      }
+    }
+    grader.reset();
+    for (int16_t v : t) {
+      grader.push(v);
+    }
+    out.push_back(0);
+    out.push_back(grader.match(buf, nchars));
+    out.push_back(nchars);
+    for (uint8_t i = 0; i < nchars; i++) {
+      out.push_back(index_char(chars[i]));
+    }
+    out.insert(out.end(), t.begin(), t.end());
+  }
+  fwrite(out.data(), sizeof(int16_t), out.size(), stdout);
+}
+
+static FILE* open_out(const char* prefix, const char* suffix) {
+  std::string path = std::string(prefix) + suffix;
+  FILE* f = fopen(path.c_str(), "w");
+  if (!f) {
+    perror(path.c_str());
+    exit(1);
+  }
+  return f;
+}
+
+static void usage(void) {
+  fprintf(stderr,
+          "usage: grade_tune [-j threads] [-o prefix] file ...\n"
+          "       grade_tune -g attempts [-s seed] > file\n");
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  unsigned threads = std::thread::hardware_concurrency();
+  const char* prefix = NULL;
+  uint32_t generate_count = 0;
+  uint64_t seed = 1;
+  int opt;
+  while ((opt = getopt(argc, argv, "j:o:g:s:")) != -1) {
+    switch (opt) {
+      case 'j':
+        threads = atoi(optarg);
+        break;
+      case 'o':
+        prefix = optarg;
+        break;
+      case 'g':
+        generate_count = strtoul(optarg, NULL, 0);
+        break;
+      case 's':
+        seed = strtoull(optarg, NULL, 0);
+        break;
+      default:
+        usage();
+    }
+  }
+  if (generate_count) {
+    generate(generate_count, seed);
+    return 0;
+  }
+  int nfiles = argc - optind;
+  if (nfiles <= 0) {
+    usage();
+  }
+  if (threads < 1) {
+    threads = 1;
+  }
+
+  std::vector<Part> parts(nfiles);
+  run_pool(std::min<unsigned>(threads, nfiles), nfiles, [&](size_t i) {
+    read_corpus(&parts[i], argv[optind + i]);
+  });
+  int status = 0;
+  for (const Part& p : parts) {
+    if (!p.ok) {
+      status = 1;
+    }
+  }
+  Corpus corpus;
+  merge(parts, &corpus);
+  if (!corpus.attempts) {
+    fprintf(stderr, "no attempts\n");
+    return 1;
+  }
+
+  Best best;
+  grid(corpus, threads, &best);
+  refine(corpus, threads, &best);
+  fprintf(stderr, "%lu attempts, %zu distinct, %u candidates, %u pruned\n",
+          (unsigned long)corpus.attempts, corpus.rows, best.evaluated,
+          best.pruned);
+
+  FILE* out = prefix ? open_out(prefix, ".tsv") : stdout;
+  fprintf(out, "constants");
+  for (int i = 0; i < NUM_CONSTANTS; i++) {
+    fprintf(out, "\t%s", NAMES[i]);
+  }
+  fprintf(out, "\tagree\tprecision\trecall\n");
+  print_constants(out, "current", corpus, CURRENT);
+  print_constants(out, "best", corpus, best.k);
+  if (prefix) {
+    fclose(out);
+    FILE* curves = open_out(prefix, "_curves.tsv");
+    print_curves(curves, corpus, threads, best.k);
+    fclose(curves);
+  }
+  return status;
+}
@@ -0,0 +1,206 @@
+// Decodes a session log dumped from the device over the uart.
+//
+// Send a 'd' to the device, capture its output and feed it in:
+//
+//   ./journal_decode < dump.txt
+//
+// Each page of the log arrives as a line of 64 hex digits. Pages are
+// ordered by their sequence number before decoding, and difficulty
+// changes are worked out by replaying the same rules as state.c.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "journal.h"
+#include "state.h"
+
+#define PAGE_BYTES 32
+#define MAX_PAGES 8
+#define MAX_ATTEMPTS 3
+
+static uint8_t pages[MAX_PAGES][PAGE_BYTES];
+static int npages = 0;
+
+// Replayed practice state, as in state.c.
+static bool in_practice = false;
+static int nchars = 2;
+static int farnsworth_dits = MAX_FARNSWORTH_DITS;
+static int attempts = 0;
+static int attempt_num = 0;
+
+static int hex_value(int c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+static bool parse_line(const char* line, uint8_t* page) {
+  for (int i = 0; i < PAGE_BYTES; i++) {
+    int hi = hex_value(line[2 * i]);
+    int lo = (hi < 0) ? -1 : hex_value(line[2 * i + 1]);
+    if (lo < 0) {
+      return false;
+    }
+    page[i] = (hi << 4) | lo;
+  }
+  return true;
+}
+
+static int page_order(const void* a, const void* b) {
+  // Sequence numbers wrap, so order by their difference.
+  uint8_t sa = ((const uint8_t*)a)[0];
+  uint8_t sb = ((const uint8_t*)b)[0];
+  return (int8_t)(sa - sb);
+}
+
+static void make_more_difficult(void) {
+  if (farnsworth_dits > 0) {
+    farnsworth_dits--;
+  } else if (nchars < 5) {
+    nchars++;
+    farnsworth_dits = MAX_FARNSWORTH_DITS;
+  }
+}
+
+static void make_easier(void) {
+  if (farnsworth_dits < MAX_FARNSWORTH_DITS) {
+    farnsworth_dits++;
+  } else if (nchars > 2) {
+    nchars--;
+    farnsworth_dits = 0;
+  }
+}
+
+static void print_level(void) {
+  printf("%d chars, %d farnsworth dits", nchars, farnsworth_dits);
+}
+
+static void attempt(bool passed, int code) {
+  attempt_num++;
+  printf("  attempt %d: ", attempt_num);
+  if (passed) {
+    printf("pass");
+  } else if (code < 26) {
+    printf("fail, missed %c", 'A' + code);
+  } else if (code == JOURNAL_MISS_EXTRA) {
+    printf("fail, extra elements");
+  } else if (code == JOURNAL_MISS_EMPTY) {
+    printf("fail, nothing sent");
+  } else {
+    printf("fail");
+  }
+
+  if (!in_practice) {
+    printf("\n");
+    return;
+  }
+
+  if (passed || (attempts >= MAX_ATTEMPTS)) {
+    if (attempts < MAX_ATTEMPTS) {
+      make_more_difficult();
+    } else {
+      make_easier();
+    }
+    attempts = 0;
+    printf(", new drill at ");
+  } else {
+    make_easier();
+    attempts++;
+    printf(", retry at ");
+  }
+  print_level();
+  printf("\n");
+}
+
+static void session(int level) {
+  if (level == JOURNAL_STRAIGHT_KEY) {
+    in_practice = false;
+    printf("session: straight key\n");
+    return;
+  }
+  if (level == JOURNAL_RECEIVE) {
+    in_practice = false;
+    printf("session: receive\n");
+    return;
+  }
+  in_practice = true;
+  nchars = 2 + level / (MAX_FARNSWORTH_DITS + 1);
+  farnsworth_dits = MAX_FARNSWORTH_DITS - level % (MAX_FARNSWORTH_DITS + 1);
+  attempts = 0;
+  printf("session: practice at ");
+  print_level();
+  printf("\n");
+}
+
+static void decode(void) {
+  unsigned idle = 0;
+  int idle_shift = 0;
+
+  for (int p = 0; p < npages; p++) {
+    for (int i = 1; i < PAGE_BYTES; i++) {
+      uint8_t b = pages[p][i];
+      if (b == 0xff) {
+        // End of this page.
+        break;
+      }
+      if ((b & 0x80) == 0) {
+        for (int r = 0; r < (b >> 5); r++) {
+          attempt(true, 0);
+        }
+        attempt(false, b & 0x1f);
+      } else if ((b & 0xc0) == 0x80) {
+        for (int r = 0; r < (b & 0x3f); r++) {
+          attempt(true, 0);
+        }
+      } else if ((b & 0xe0) == 0xc0) {
+        idle |= (b & 0x0f) << idle_shift;
+        idle_shift += 4;
+        if (!(b & 0x10)) {
+          printf("idle: %u minutes\n", idle);
+          idle = 0;
+          idle_shift = 0;
+        }
+      } else {
+        session(b & 0x1f);
+      }
+    }
+  }
+}
+
+int main(void) {
+  char line[256];
+  while (fgets(line, sizeof(line), stdin)) {
+    if (strlen(line) < 2 * PAGE_BYTES) {
+      continue;
+    }
+    if (npages >= MAX_PAGES) {
+      fprintf(stderr, "Too many pages\n");
+      return 1;
+    }
+    if (!parse_line(line, pages[npages])) {
+      continue;
+    }
+    if (pages[npages][0] == 0xff) {
+      // Never written.
+      continue;
+    }
+    npages++;
+  }
+
+  // The oldest page may have been overwritten part way through a
+  // run of events, so anything before the first session is decoded
+  // without levels.
+  qsort(pages, npages, PAGE_BYTES, page_order);
+  decode();
+  return 0;
+}
@@ -0,0 +1,526 @@
+// Measures how long the firmware takes to answer the key on its pins,
+// from a change on PA6 to PA3 starting (or stopping) toggling, broken
+// down by the mode and state it was in when the key moved.
+//
+//   ./pin_latency [-s seed] [-t seconds] [-c cycles] [-v out.vcd]
+//                 [-p percentile -m key_us -M stop_us] [script]
+//
+// The firmware runs unchanged from main(), built against the stand-in
+// registers in avrsim/. Time only passes in sleep_mode(), where this
+// plays the hardware: the RTC PIT every 1/1024s (and RTC.CNT with
+// it), TCA0's PWM on PA3
+// and its overflow interrupt, and the key on PA6, which wakes the
+// device from power-down through the port interrupt. Every wakeup is
+// taken to spend -c cycles (default 400) before the code reads the
+// key or starts the tone. That's an estimate, as the code runs on the
+// host, and the wakeup and tick_max figures from a real unit's shell
+// are the way to refine it.
+//
+// The key follows the script, or without one, -t seconds (default
+// 300) of random keying, with the odd long press to change modes and
+// long pause to let attempts be graded, so that every state comes up.
+// A script has a line per edge, "<ms after the previous edge> <1 for
+// down, 0 for up>". With -v, PA6 and PA3 are written to a VCD file
+// with cycle accurate timestamps.
+//
+// Key to tone is only counted for presses made while the tone was
+// off, and that started it within KEY_TONE_MAX_MS. Those that didn't
+// are no_tone, and those made while it was on aren't counted at all.
+// Tone stop runs from the release to the last edge on PA3, so it
+// includes the fade out. Presses that wake the device from power-down
+// are counted apart from the rest, under power_down. Those include
+// the restarted PIT's first period, though not the ULP oscillator's
+// start-up.
+// With -p, the run fails if, in any state, that percentile of either
+// is over -m or -M microseconds.
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/sleep.h>
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "term.h"
+#include "trace.h"
+
+#define CYCLES_PER_TICK (F_CPU / 1024)
+#define CYCLES_PER_US (F_CPU / 1000000)
+#define PWM_PERIOD_CYCLES 512
+
+#define KEY_TONE_MAX_MS 20
+
+// Time allowed after the last edge for things to finish.
+#define SETTLE_MS 3000
+
+#define MAX_MODES 3
+#define MAX_SUBSTATES 8
+
+PORT_t PORTA;
+TCA_t TCA0;
+TCB_t TCB0;
+RTC_t RTC;
+CLKCTRL_t CLKCTRL;
+SIGROW_t SIGROW;
+
+void sim_RTC_PIT_vect(void);
+void sim_TCA0_OVF_vect(void);
+void sim_PORTA_PORT_vect(void);
+int firmware_main(void);
+
+static jmp_buf done;
+
+static uint64_t now = 0;
+static uint64_t next_pit = CYCLES_PER_TICK;
+static bool pit_running = false;
+static uint64_t wake_cycles = 400;
+
+// TCA0 as seen from outside.
+static bool timer_running = false;
+static uint64_t next_ovf = 0;
+static uint64_t pending_fall = 0;
+static bool pa3 = false;
+static uint64_t last_pa3_edge = 0;
+
+// The key and the script driving it.
+static bool key_down = false;
+static FILE* script = NULL;
+static bool have_edge = false;
+static uint64_t edge_at = 0;
+static bool edge_down = false;
+static uint64_t end_at = 0;
+static uint64_t random_until = 0;
+static uint64_t rng = 1;
+
+static FILE* vcd = NULL;
+
+// Mode and state, as traced by state.c.
+static uint8_t mode = 0;
+static uint8_t substate = 0;
+
+typedef struct {
+  uint32_t* us;
+  size_t len;
+  size_t cap;
+} samples_t;
+
+typedef struct {
+  uint32_t presses;
+  uint32_t no_tone;
+  samples_t key_to_tone;
+  samples_t tone_stop;
+} state_stats_t;
+
+static state_stats_t stats[MAX_MODES][MAX_SUBSTATES];
+static state_stats_t wake_stats;
+
+// The press being followed, and the state it was made in.
+static bool waiting_tone = false;
+static bool waiting_stop = false;
+static bool tone_from_press = false;
+static uint64_t press_at = 0;
+static uint64_t release_at = 0;
+static state_stats_t* press_stats = NULL;
+
+static const char* const MODE_NAMES[MAX_MODES] = {
+  "straight_key", "practice", "receive",
+};
+
+static const char* const SUBSTATE_NAMES[MAX_MODES][MAX_SUBSTATES] = {
+  {"announcing", "ready"},
+  {"announcing", "sending", "waiting", NULL,
+   "announcing", "listening", "waiting", "replaying"},
+  {NULL, NULL, NULL, NULL,
+   "announcing", "listening", "waiting", "replaying"},
+};
+
+void trace_record(uint8_t type, uint8_t value) {
+  if (type == TRACE_MODE) {
+    mode = (value < MAX_MODES) ? value : 0;
+    substate = 0;
+  } else if ((type == TRACE_STRAIGHT_KEY) || (type == TRACE_PRACTICE)) {
+    substate = value % MAX_SUBSTATES;
+  }
+}
+
+void trace_tick(void) {
+}
+
+static void add_sample(samples_t* s, uint64_t cycles) {
+  if (s->len == s->cap) {
+    s->cap = s->cap ? 2 * s->cap : 64;
+    s->us = realloc(s->us, s->cap * sizeof(s->us[0]));
+  }
+  s->us[s->len++] = cycles / CYCLES_PER_US;
+}
+
+static void vcd_change(char id, bool level) {
+  if (vcd) {
+    // Picoseconds, as VCD can't count in 62.5ns.
+    fprintf(vcd, "#%llu\n%d%c\n",
+            (unsigned long long)(now * (1000000 / CYCLES_PER_US)), level, id);
+  }
+}
+
+static void set_pa3(bool level) {
+  if (level == pa3) {
+    return;
+  }
+  pa3 = level;
+  last_pa3_edge = now;
+  vcd_change('3', level);
+  if (level && waiting_tone) {
+    waiting_tone = false;
+    if (now - press_at <= (uint64_t)KEY_TONE_MAX_MS * 1000 * CYCLES_PER_US) {
+      add_sample(&press_stats->key_to_tone, now - press_at);
+      tone_from_press = true;
+    } else {
+      press_stats->no_tone++;
+    }
+  }
+}
+
+// Picks up the code starting or stopping TCA0.
+static void sync_timer(void) {
+  bool enabled = TCA0.SINGLE.CTRLA & TCA_SINGLE_ENABLE_bm;
+  if (enabled && !timer_running) {
+    timer_running = true;
+    next_ovf = now + PWM_PERIOD_CYCLES;
+  } else if (!enabled && timer_running) {
+    timer_running = false;
+    pending_fall = 0;
+    set_pa3(false);
+    if (waiting_stop) {
+      waiting_stop = false;
+      add_sample(&press_stats->tone_stop, last_pa3_edge - release_at);
+    }
+  }
+}
+
+// Single slope PWM: the compare value is updated from its buffer at
+// the bottom, where the output goes high unless it's 0, and the output
+// goes low again when the count reaches it.
+static void overflow(void) {
+  uint16_t cmp = TCA0.SINGLE.CMP0 = TCA0.SINGLE.CMP0BUF;
+  if ((TCA0.SINGLE.CTRLB & TCA_SINGLE_CMP0EN_bm) && cmp) {
+    set_pa3(true);
+    pending_fall = now + 2 * cmp;
+  }
+  if (TCA0.SINGLE.INTCTRL & TCA_SINGLE_OVF_bm) {
+    sim_TCA0_OVF_vect();
+  }
+  next_ovf += PWM_PERIOD_CYCLES;
+}
+
+static uint64_t random_next(void) {
+  rng ^= rng << 13;
+  rng ^= rng >> 7;
+  rng ^= rng << 17;
+  return rng;
+}
+
+static uint64_t random_ms(unsigned lo, unsigned hi) {
+  return (uint64_t)lo * 1000 * CYCLES_PER_US +
+    random_next() % ((uint64_t)(hi - lo) * 1000 * CYCLES_PER_US);
+}
+
+// Random keying: mostly elements and gaps of morse-like lengths, with
+// the odd long press to change modes, and long pause for grading.
+static bool random_edge(void) {
+  if (edge_at >= random_until) {
+    return false;
+  }
+  edge_down = !key_down;
+  unsigned r = random_next() % 100;
+  if (edge_down) {
+    edge_at += (r < 10) ? random_ms(1500, 3500) : random_ms(30, 600);
+  } else {
+    edge_at += (r < 3) ? random_ms(1100, 1400) : random_ms(30, 400);
+  }
+  return true;
+}
+
+static bool script_edge(void) {
+  char line[128];
+  while (fgets(line, sizeof(line), script)) {
+    double ms;
+    int level;
+    if ((line[0] == '#') || (sscanf(line, "%lf %d", &ms, &level) != 2)) {
+      continue;
+    }
+    edge_at += ms * 1000 * CYCLES_PER_US;
+    edge_down = level;
+    return true;
+  }
+  return false;
+}
+
+static void next_edge(void) {
+  have_edge = script ? script_edge() : random_edge();
+  if (!have_edge) {
+    end_at = edge_at + (uint64_t)SETTLE_MS * 1000 * CYCLES_PER_US;
+  }
+}
+
+static void key_edge(void) {
+  if (edge_down == key_down) {
+    return;
+  }
+  key_down = edge_down;
+  // The key pulls the pin low.
+  if (key_down) {
+    PORTA.IN &= ~PIN6_bm;
+  } else {
+    PORTA.IN |= PIN6_bm;
+  }
+  vcd_change('6', !key_down);
+
+  if (key_down) {
+    press_stats = pit_running ? &stats[mode][substate] : &wake_stats;
+    press_stats->presses++;
+    waiting_stop = false;
+    tone_from_press = false;
+    waiting_tone = !timer_running;
+    press_at = now;
+  } else if (waiting_tone) {
+    waiting_tone = false;
+    press_stats->no_tone++;
+  } else if (tone_from_press) {
+    tone_from_press = false;
+    waiting_stop = true;
+    release_at = now;
+  }
+}
+
+// Whether the port interrupt is set to go off for this edge on PA6.
+static bool pa6_senses(bool falling) {
+  switch (PORTA.PIN6CTRL & PORT_ISC_gm) {
+    case PORT_ISC_BOTHEDGES_gc:
+      return true;
+    case PORT_ISC_RISING_gc:
+      return !falling;
+    case PORT_ISC_FALLING_gc:
+    case PORT_ISC_LEVEL_gc:
+      return falling;
+    default:
+      return false;
+  }
+}
+
+void set_sleep_mode(uint8_t sleep) {
+}
+
+// Lets time pass until something wakes the device: the PIT or the key
+// on PA6 (plus the time to get to the point of using the key), or,
+// while the timer runs, its overflow interrupt. With the PIT stopped,
+// it starts over with a full period once it's enabled again.
+void sleep_mode(void) {
+  sync_timer();
+  bool pit_enabled = RTC.PITCTRLA & RTC_PITEN_bm;
+  if (pit_enabled && !pit_running) {
+    next_pit = now + CYCLES_PER_TICK;
+  }
+  pit_running = pit_enabled;
+  uint64_t wake_at = UINT64_MAX;
+  for (;;) {
+    uint64_t t = pit_running ? next_pit : UINT64_MAX;
+    if (timer_running && (next_ovf < t)) {
+      t = next_ovf;
+    }
+    if (pending_fall && (pending_fall < t)) {
+      t = pending_fall;
+    }
+    if (have_edge && (edge_at < t)) {
+      t = edge_at;
+    }
+    if (t > wake_at) {
+      now = wake_at;
+      break;
+    }
+    if (t == UINT64_MAX) {
+      // Powered down, with no more edges to wake us.
+      longjmp(done, 1);
+    }
+    now = t;
+
+    if (have_edge && (t == edge_at)) {
+      key_edge();
+      next_edge();
+      if (pa6_senses(key_down)) {
+        PORTA.INTFLAGS |= PIN6_bm;
+        sim_PORTA_PORT_vect();
+        if (wake_at == UINT64_MAX) {
+          wake_at = now + wake_cycles;
+        }
+      }
+    } else if (pending_fall && (t == pending_fall)) {
+      pending_fall = 0;
+      set_pa3(false);
+    } else if (timer_running && (t == next_ovf)) {
+      overflow();
+      if (wake_at == UINT64_MAX) {
+        break;
+      }
+    } else {
+      if (!have_edge && (now >= end_at)) {
+        longjmp(done, 1);
+      }
+      next_pit += CYCLES_PER_TICK;
+      if (RTC.CTRLA & RTC_RTCEN_bm) {
+        // Counting at the same rate as the PIT.
+        RTC.CNT++;
+      }
+      TCB0.CNT = now / 2;
+      sim_RTC_PIT_vect();
+      wake_at = now + wake_cycles;
+    }
+  }
+  TCB0.CNT = now / 2;
+}
+
+static int compare_u32(const void* a, const void* b) {
+  uint32_t x = *(const uint32_t*)a;
+  uint32_t y = *(const uint32_t*)b;
+  return (x > y) - (x < y);
+}
+
+static uint32_t percentile(samples_t* s, double pct) {
+  if (!s->len) {
+    return 0;
+  }
+  size_t i = (size_t)(pct / 100 * (s->len - 1) + 0.5);
+  return s->us[i];
+}
+
+static void print_samples(samples_t* s) {
+  qsort(s->us, s->len, sizeof(s->us[0]), compare_u32);
+  printf("  %6zu %6u %6u %6u %6u", s->len, percentile(s, 50),
+         percentile(s, 90), percentile(s, 99), percentile(s, 100));
+}
+
+// Prints a row for the presses in st, and returns 1 if they're over
+// the limits.
+static int report(const char* name, state_stats_t* st, double pct,
+                  unsigned max_key_us, unsigned max_stop_us) {
+  if (!st->presses) {
+    return 0;
+  }
+  printf("%-24s %7u %7u", name, st->presses, st->no_tone);
+  print_samples(&st->key_to_tone);
+  print_samples(&st->tone_stop);
+  printf("\n");
+
+  if (pct <= 0) {
+    return 0;
+  }
+  int status = 0;
+  uint32_t key_us = percentile(&st->key_to_tone, pct);
+  uint32_t stop_us = percentile(&st->tone_stop, pct);
+  if (max_key_us && (key_us > max_key_us)) {
+    fprintf(stderr, "%s: p%g key to tone %uus is over %uus\n", name,
+            pct, key_us, max_key_us);
+    status = 1;
+  }
+  if (max_stop_us && (stop_us > max_stop_us)) {
+    fprintf(stderr, "%s: p%g tone stop %uus is over %uus\n", name, pct,
+            stop_us, max_stop_us);
+    status = 1;
+  }
+  return status;
+}
+
+static void usage(void) {
+  fprintf(stderr,
+          "usage: pin_latency [-s seed] [-t seconds] [-c cycles] "
+          "[-v out.vcd] [-p percentile -m key_us -M stop_us] [script]\n");
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  unsigned seconds = 300;
+  double pct = 0;
+  unsigned max_key_us = 0;
+  unsigned max_stop_us = 0;
+  const char* vcd_path = NULL;
+  int opt;
+  while ((opt = getopt(argc, argv, "s:t:c:v:p:m:M:")) != -1) {
+    switch (opt) {
+      case 's':
+        rng = strtoull(optarg, NULL, 0) | 1;
+        break;
+      case 't':
+        seconds = atoi(optarg);
+        break;
+      case 'c':
+        wake_cycles = atoi(optarg);
+        break;
+      case 'v':
+        vcd_path = optarg;
+        break;
+      case 'p':
+        pct = atof(optarg);
+        break;
+      case 'm':
+        max_key_us = atoi(optarg);
+        break;
+      case 'M':
+        max_stop_us = atoi(optarg);
+        break;
+      default:
+        usage();
+    }
+  }
+  if (optind < argc) {
+    script = fopen(argv[optind], "r");
+    if (!script) {
+      perror(argv[optind]);
+      return 1;
+    }
+  }
+  random_until = (uint64_t)seconds * F_CPU;
+
+  if (vcd_path) {
+    vcd = fopen(vcd_path, "w");
+    if (!vcd) {
+      perror(vcd_path);
+      return 1;
+    }
+    fprintf(vcd,
+            "$timescale 1ps $end\n"
+            "$scope module attiny412 $end\n"
+            "$var wire 1 6 PA6 $end\n"
+            "$var wire 1 3 PA3 $end\n"
+            "$upscope $end\n"
+            "$enddefinitions $end\n"
+            "#0\n16\n03\n");
+  }
+
+  PORTA.IN = PIN6_bm;
+  term_eeprom_load(NULL);
+  next_edge();
+  if (!setjmp(done)) {
+    firmware_main();
+  }
+  if (vcd) {
+    fclose(vcd);
+  }
+
+  printf("%-24s %7s %7s  %6s %6s %6s %6s %6s  %6s %6s %6s %6s %6s\n",
+         "state", "presses", "no_tone", "tone", "p50", "p90", "p99", "max",
+         "stop", "p50", "p90", "p99", "max");
+  int status = 0;
+  for (int m = 0; m < MAX_MODES; m++) {
+    for (int s = 0; s < MAX_SUBSTATES; s++) {
+      char name[64];
+      snprintf(name, sizeof(name), "%s/%s", MODE_NAMES[m],
+               SUBSTATE_NAMES[m][s] ? SUBSTATE_NAMES[m][s] : "?");
+      status |= report(name, &stats[m][s], pct, max_key_us, max_stop_us);
+    }
+  }
+  status |= report("power_down", &wake_stats, pct, max_key_us, max_stop_us);
+  return status;
+}
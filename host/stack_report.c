@@ -0,0 +1,338 @@
+// Works out the deepest the stack can get, from the firmware's
+// disassembly and avr-gcc's -fstack-usage figures, and checks what's
+// left of RAM against a margin:
+//
+//   avr-objdump -d main.elf | ./stack_report [-r ram] [-s static]
+//                               [-m min_free] [-i target]... *.su
+//
+// Calls are followed from main() and from each interrupt vector. The
+// worst chain under each call made from main() is printed with its
+// depth, and then those of the interrupts. Interrupts don't nest, so
+// the deepest of them goes on top of the deepest chain from main().
+//
+// -s gives the bytes of .data and .bss. Those and the stack are taken
+// out of -r bytes of RAM (default 256), and the run fails if fewer
+// than -m bytes are left. The figures from the .su files include the
+// return address. Tail calls are counted as calls, which overstates them by
+// the return address.
+//
+// Indirect calls can go to any of the -i targets. The run also fails
+// if the depth can't be bounded: recursion, frames the .su files call
+// dynamic, or indirect calls with no -i targets. Functions without a
+// .su figure, which are those from libgcc and avr-libc, are counted
+// as just their return address and listed, so they can be checked.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_FUNCS 1024
+#define MAX_NAME 64
+#define MAX_TARGETS 16
+#define RETURN_BYTES 2
+
+typedef struct call_t {
+  int callee;
+  struct call_t* next;
+} call_t;
+
+typedef struct {
+  char name[MAX_NAME];
+  // From the .su files, or -1 if there's no figure.
+  int frame;
+  bool dynamic;
+  bool indirect;
+  call_t* calls;
+  // Worst depth from here down, and the call that gets there.
+  int depth;
+  int worst;
+  uint8_t visit;
+} func_t;
+
+enum { UNVISITED, VISITING, VISITED };
+
+static func_t funcs[MAX_FUNCS];
+static int nfuncs = 0;
+
+static const char* targets[MAX_TARGETS];
+static int ntargets = 0;
+
+static bool unbounded = false;
+
+static int find(const char* name) {
+  for (int i = 0; i < nfuncs; i++) {
+    if (!strcmp(funcs[i].name, name)) {
+      return i;
+    }
+  }
+  if (nfuncs == MAX_FUNCS) {
+    fprintf(stderr, "too many functions\n");
+    exit(1);
+  }
+  func_t* f = &funcs[nfuncs];
+  snprintf(f->name, sizeof(f->name), "%s", name);
+  f->frame = -1;
+  f->worst = -1;
+  return nfuncs++;
+}
+
+static void add_call(int caller, int callee) {
+  for (call_t* c = funcs[caller].calls; c; c = c->next) {
+    if (c->callee == callee) {
+      return;
+    }
+  }
+  call_t* c = malloc(sizeof(call_t));
+  c->callee = callee;
+  c->next = funcs[caller].calls;
+  funcs[caller].calls = c;
+}
+
+// Lines look like "state.c:546:6:state_tick\t12\tstatic". Static
+// functions with the same name in different files get the larger.
+static void read_su(const char* path) {
+  FILE* f = fopen(path, "r");
+  if (!f) {
+    perror(path);
+    exit(1);
+  }
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    char* tab = strchr(line, '\t');
+    if (!tab) {
+      continue;
+    }
+    *tab = 0;
+    char* name = strrchr(line, ':');
+    name = name ? name + 1 : line;
+    int bytes = atoi(tab + 1);
+    func_t* fn = &funcs[find(name)];
+    if (bytes > fn->frame) {
+      fn->frame = bytes;
+    }
+    if (strstr(tab + 1, "dynamic")) {
+      fn->dynamic = true;
+    }
+  }
+  fclose(f);
+}
+
+// The "<name>" at the end of a line, without any "+0x..." offset.
+// Returns false if there isn't one.
+static bool target_name(const char* line, char* name, bool* offset) {
+  const char* lt = strrchr(line, '<');
+  const char* gt = lt ? strchr(lt, '>') : NULL;
+  if (!gt) {
+    return false;
+  }
+  const char* plus = memchr(lt, '+', gt - lt);
+  const char* end = plus ? plus : gt;
+  int len = end - lt - 1;
+  if (len >= MAX_NAME) {
+    len = MAX_NAME - 1;
+  }
+  memcpy(name, lt + 1, len);
+  name[len] = 0;
+  *offset = plus != NULL;
+  return true;
+}
+
+// Reads avr-objdump -d, where each function starts with a line like
+// "000000a4 <state_tick>:" and calls look like
+// " a8:\t0e 94 52 00 \tcall\t0xa4\t; 0xa4 <state_tick>".
+static void read_disassembly(FILE* in) {
+  char line[256];
+  int current = -1;
+  while (fgets(line, sizeof(line), in)) {
+    char name[MAX_NAME];
+    bool offset;
+    size_t len = strlen(line);
+    if ((len > 2) && (line[0] != ' ') && !strcmp(line + len - 3, ">:\n")) {
+      line[len - 3] = 0;
+      const char* lt = strchr(line, '<');
+      current = lt ? find(lt + 1) : -1;
+      continue;
+    }
+    if (current < 0) {
+      continue;
+    }
+    // The mnemonic follows the address and the opcode bytes.
+    char* tab = strchr(line, '\t');
+    tab = tab ? strchr(tab + 1, '\t') : NULL;
+    if (!tab) {
+      continue;
+    }
+    char op[16];
+    if (sscanf(tab + 1, "%15s", op) != 1) {
+      continue;
+    }
+
+    if (!strcmp(op, "icall") || !strcmp(op, "eicall") ||
+        !strcmp(op, "ijmp") || !strcmp(op, "eijmp")) {
+      funcs[current].indirect = true;
+    } else if (!strcmp(op, "call") || !strcmp(op, "rcall")) {
+      if (target_name(line, name, &offset)) {
+        add_call(current, find(name));
+      }
+    } else if (!strcmp(op, "jmp") || !strcmp(op, "rjmp")) {
+      // Only jumps to the start of another function are tail calls.
+      if (target_name(line, name, &offset) && !offset &&
+          strcmp(name, funcs[current].name)) {
+        add_call(current, find(name));
+      }
+    }
+  }
+}
+
+static void walk(int i) {
+  func_t* f = &funcs[i];
+  if (f->visit == VISITED) {
+    return;
+  }
+  if (f->visit == VISITING) {
+    fprintf(stderr, "recursion through %s\n", f->name);
+    unbounded = true;
+    return;
+  }
+  f->visit = VISITING;
+  if (f->dynamic) {
+    fprintf(stderr, "%s has a dynamic frame\n", f->name);
+    unbounded = true;
+  }
+  if (f->indirect) {
+    if (!ntargets) {
+      fprintf(stderr, "%s makes indirect calls, and there's no -i\n",
+              f->name);
+      unbounded = true;
+    }
+    for (int t = 0; t < ntargets; t++) {
+      add_call(i, find(targets[t]));
+    }
+  }
+
+  int below = 0;
+  for (call_t* c = f->calls; c; c = c->next) {
+    walk(c->callee);
+    if (funcs[c->callee].depth > below) {
+      below = funcs[c->callee].depth;
+      f->worst = c->callee;
+    }
+  }
+  f->depth = ((f->frame < 0) ? RETURN_BYTES : f->frame) + below;
+  f->visit = VISITED;
+}
+
+static void print_chain(int depth, const char* prefix, int i) {
+  printf("  %4d  %s%s", depth, prefix, funcs[i].name);
+  for (int w = funcs[i].worst; w >= 0; w = funcs[w].worst) {
+    printf(" > %s", funcs[w].name);
+  }
+  printf("\n");
+}
+
+static void usage(void) {
+  fprintf(stderr,
+          "usage: avr-objdump -d main.elf | stack_report [-r ram] "
+          "[-s static] [-m min_free] [-i target]... file.su...\n");
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  int ram = 256;
+  int static_bytes = -1;
+  int min_free = 0;
+  int opt;
+  while ((opt = getopt(argc, argv, "r:s:m:i:")) != -1) {
+    switch (opt) {
+      case 'r':
+        ram = atoi(optarg);
+        break;
+      case 's':
+        static_bytes = atoi(optarg);
+        break;
+      case 'm':
+        min_free = atoi(optarg);
+        break;
+      case 'i':
+        if (ntargets == MAX_TARGETS) {
+          usage();
+        }
+        targets[ntargets++] = optarg;
+        break;
+      default:
+        usage();
+    }
+  }
+  if (optind == argc) {
+    usage();
+  }
+  for (int i = optind; i < argc; i++) {
+    read_su(argv[i]);
+  }
+  read_disassembly(stdin);
+
+  int main_fn = find("main");
+  walk(main_fn);
+  if (!funcs[main_fn].calls) {
+    fprintf(stderr, "no calls from main in the disassembly\n");
+    return 1;
+  }
+
+  int main_frame = (funcs[main_fn].frame < 0) ?
+    RETURN_BYTES : funcs[main_fn].frame;
+  printf("deepest chains, in bytes of stack:\n");
+  for (call_t* c = funcs[main_fn].calls; c; c = c->next) {
+    print_chain(main_frame + funcs[c->callee].depth, "main > ", c->callee);
+  }
+
+  int isr_depth = 0;
+  for (int i = 0; i < nfuncs; i++) {
+    const char* name = funcs[i].name;
+    if (strncmp(name, "__vector_", 9) || (name[9] < '0') || (name[9] > '9')) {
+      continue;
+    }
+    walk(i);
+    print_chain(funcs[i].depth, "", i);
+    if (funcs[i].depth > isr_depth) {
+      isr_depth = funcs[i].depth;
+    }
+  }
+
+  bool unknown = false;
+  for (int i = 0; i < nfuncs; i++) {
+    if ((funcs[i].frame < 0) && (funcs[i].visit == VISITED)) {
+      if (!unknown) {
+        printf("without a frame size:");
+        unknown = true;
+      }
+      printf(" %s", funcs[i].name);
+    }
+  }
+  if (unknown) {
+    printf("\n");
+  }
+
+  int stack = funcs[main_fn].depth + isr_depth;
+  printf("stack: %d from main + %d for interrupts = %d bytes\n",
+         funcs[main_fn].depth, isr_depth, stack);
+  if (unbounded) {
+    fprintf(stderr, "the stack depth can't be bounded\n");
+    return 1;
+  }
+  if (static_bytes < 0) {
+    return 0;
+  }
+
+  int free_bytes = ram - static_bytes - stack;
+  printf("ram: %d static + %d stack = %d of %d bytes, %d free\n",
+         static_bytes, stack, static_bytes + stack, ram, free_bytes);
+  if (free_bytes < min_free) {
+    fprintf(stderr, "only %d bytes of RAM to spare, wanted %d\n",
+            free_bytes, min_free);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,987 @@
+// Explores every state the firmware's state machine can get into,
+// breadth first, and checks that none of them break the rules below.
+//
+//   ./state_check [-j workers] [-n max_states]
+//
+// state.c and jobs.c are compiled in unchanged, and everything they
+// call is swapped for a small model of it: whether the key is down,
+// whether the tone is on, whether morse is playing and in a mark, how
+// many of the drill's letters are in, how much has been captured, and
+// what's saved in the EEPROM. Timers are abstracted away. A step is
+// one state_tick(), and any timer may run out on any step the model
+// allows, except that the leading word space always outlasts picking
+// the letters during it (it's hundreds of quiet ticks, and a letter
+// takes one). The random generator only picks letters, so it's left out.
+//
+// Each step is a tick with one of each allowed key event, morse
+// action, capture timeout, grade and (built with -DRECEIVE) decoded
+// word, or a power cycle into state_resume(). The search starts from
+// a power on with nothing saved, and with every possible settings
+// byte saved.
+//
+// These are checked on every step:
+//
+//   range     the difficulty and attempts stay in range
+//   tone      the tone is only on for a key down or a morse mark
+//   sidetone  while the user is keying, the tone follows the key
+//   long      a long press always moves on to the next mode
+//   drill     only complete drills are graded
+//   saved     only settings that would be resumed, into the mode
+//             the device is in, are saved
+//
+// And these once everything has been explored:
+//
+//   idle      from anywhere, without pressing the key again, the
+//             device gets back to the user's turn
+//   modes     from anywhere, every mode can be reached
+//
+// A failure is printed along with a shortest run of steps leading to
+// it, and the exit status is 1.
+//
+// The firmware's globals can only hold one state per process, so the
+// workers are forked processes, sharing the states, the hash set of
+// them and the edges between them through shared memory. Each level's
+// new states are split between the workers, and a worker that runs
+// out steals from the others' shares.
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/jobs.c"
+#include "../src/state.c"
+
+#define MAX_WORKERS 64
+#define BATCH 32
+#define EDGES_PER_STATE 24
+#define NO_NODE 0xffffffff
+
+#ifdef RECEIVE
+#define NUM_MODES 3
+#else
+#define NUM_MODES 2
+#endif
+
+typedef enum _check_t {
+  CHECK_OK,
+  CHECK_RANGE,
+  CHECK_TONE,
+  CHECK_SIDETONE,
+  CHECK_LONG,
+  CHECK_DRILL,
+  CHECK_SAVED,
+  CHECK_IDLE,
+  CHECK_MODES,
+} check_t;
+
+static const char* const CHECK_NAMES[] = {
+  "ok", "range", "tone", "sidetone", "long", "drill", "saved", "idle",
+  "modes",
+};
+
+static const char* const CHECK_TEXT[] = {
+  "",
+  "the difficulty or attempts went out of range",
+  "the tone is on without a key down or a morse mark",
+  "the tone doesn't follow the key while the user is keying",
+  "a long press didn't move on to the next mode",
+  "a drill was graded before all its letters were in",
+  "settings were saved that wouldn't be resumed into this mode",
+  "the device can't get back to the user's turn from here without "
+  "another press",
+  "a mode can't be reached from here",
+};
+
+// A state, as bytes so there's no padding to get in the way of
+// hashing and comparing them.
+typedef struct {
+  // state.c
+  uint8_t mode;
+  uint8_t practice_state;
+  uint8_t straight_key_state;
+  uint8_t receive_state;
+  uint8_t nchars;
+  uint8_t farnsworth_dits;
+  uint8_t attempts;
+  uint8_t key_held;
+  // jobs.c, oldest first.
+  uint8_t jobs_len;
+  uint8_t jobs[JOBS_MAX];
+  // The models.
+  uint8_t key_down;
+  uint8_t tone_on;
+  uint8_t morse_playing;
+  uint8_t morse_in_mark;
+  uint8_t morse_len;
+  uint8_t morse_nchars;
+  // Marks captured, up to 2.
+  uint8_t captured;
+  uint8_t capture_in_mark;
+  uint8_t rx_on;
+  uint8_t save_pending;
+  uint8_t pending_settings;
+  uint8_t saved;
+  uint8_t saved_settings;
+} snap_t;
+
+enum { JOB_GENERATE, JOB_MATCH };
+
+// Steps are packed into 16 bits.
+#define STEP_KEY(s) ((s) & 0x03)
+#define STEP_MORSE(s) (((s) >> 2) & 0x03)
+#define STEP_TIMEOUT 0x10
+#define STEP_PASS 0x20
+#define STEP_WORD 0x40
+#define STEP_POWER_CYCLE 0x80
+// Only the first step: a power on, with a settings byte saved or not.
+#define STEP_POWER_ON 0x100
+#define STEP_SAVED 0x200
+
+typedef struct {
+  snap_t s;
+  uint32_t parent;
+  uint16_t step;
+  uint16_t depth;
+  _Atomic uint8_t live;
+} node_t;
+
+typedef struct {
+  uint32_t from;
+  uint32_t to;
+  uint16_t step;
+} edge_t;
+
+typedef struct {
+  pthread_barrier_t barrier;
+  atomic_uint nstates;
+  atomic_uint nedges;
+  atomic_uint violation;
+  atomic_uint violation_node;
+  atomic_bool full;
+  // The level being explored.
+  uint32_t lo;
+  uint32_t hi;
+  bool done;
+  atomic_uint cursor[MAX_WORKERS];
+  uint32_t end[MAX_WORKERS];
+} shared_t;
+
+static shared_t* shared;
+static node_t* nodes;
+static atomic_uint* slots;
+static edge_t* edges;
+static uint32_t max_states;
+static uint32_t slots_mask;
+static uint32_t max_edges;
+static int workers;
+
+// The model, and what the current step feeds it.
+static snap_t model;
+static uint16_t step;
+static check_t failed;
+
+static snap_t boot;
+
+static void fail(check_t check) {
+  if (failed == CHECK_OK) {
+    failed = check;
+  }
+}
+
+key_state_t key_tick(void) {
+  key_state_t key = STEP_KEY(step);
+  if (key == KEY_DOWN) {
+    model.key_down = 1;
+  } else if (key != KEY_NO_CHANGE) {
+    model.key_down = 0;
+  }
+  return key;
+}
+
+void tone_enable(bool enable) {
+  model.tone_on = enable;
+}
+
+bool tone_active(void) {
+  return model.tone_on;
+}
+
+void tone_tick(void) {
+}
+
+void morse_reset(void) {
+  model.morse_playing = 0;
+  model.morse_in_mark = 0;
+  model.morse_len = 0;
+  model.morse_nchars = 0;
+}
+
+void morse_set(uint8_t char_idx) {
+  morse_reset();
+  model.morse_len = model.morse_nchars = 1;
+  model.morse_playing = 1;
+}
+
+void morse_flush(void) {
+  model.morse_playing = 0;
+  model.morse_in_mark = 0;
+}
+
+void morse_rewind(void) {
+  model.morse_playing = 1;
+  model.morse_in_mark = 0;
+}
+
+void morse_random_begin(uint8_t nchars, uint8_t farnsworth_dit_spacing) {
+  morse_reset();
+  model.morse_nchars = (nchars > 5) ? 5 : nchars;
+  model.morse_playing = 1;
+}
+
+bool morse_random_step(void) {
+  if (model.morse_len < model.morse_nchars) {
+    model.morse_len++;
+  }
+  return model.morse_len >= model.morse_nchars;
+}
+
+uint32_t morse_random_state(void) {
+  return 0;
+}
+
+void morse_random_seed(uint32_t state) {}
+
+static bool morse_allowed(morse_action_t action) {
+  if (!model.morse_playing) {
+    return action == MORSE_NONE;
+  }
+  bool filled = model.morse_len >= model.morse_nchars;
+  switch (action) {
+    case MORSE_HOLD:
+      return true;
+    case MORSE_START_SPACE:
+      return model.morse_in_mark;
+    default:
+      return !model.morse_in_mark && filled;
+  }
+}
+
+morse_action_t morse_tick(void) {
+  morse_action_t action = STEP_MORSE(step);
+  if (action == MORSE_START_MARK) {
+    model.morse_in_mark = 1;
+  } else if (action == MORSE_START_SPACE) {
+    model.morse_in_mark = 0;
+  } else if (action == MORSE_NONE) {
+    model.morse_playing = 0;
+  }
+  return action;
+}
+
+void capture_reset(void) {
+  model.captured = 0;
+  model.capture_in_mark = 0;
+}
+
+void capture_push_mark(void) {
+  if (model.captured < 2) {
+    model.captured++;
+  }
+  model.capture_in_mark = 0;
+}
+
+void capture_push_space(void) {
+  model.capture_in_mark = 1;
+}
+
+bool capture_match(void) {
+  if (model.morse_len < model.morse_nchars) {
+    fail(CHECK_DRILL);
+  }
+  return model.captured && (step & STEP_PASS);
+}
+
+bool capture_match_step(void) {
+  return true;
+}
+
+uint8_t capture_missed_char(void) {
+  return 0;
+}
+
+bool capture_timeout(void) {
+  return step & STEP_TIMEOUT;
+}
+
+bool persist_load(uint8_t* settings, uint32_t* seed) {
+  *settings = model.saved_settings;
+  *seed = 0;
+  return model.saved;
+}
+
+void persist_save(uint8_t settings, uint32_t seed) {
+  uint8_t nchars = (settings >> SETTINGS_NCHARS_bp) & 0x07;
+  state_mode_t saved_mode;
+  if ((nchars < 2) || (nchars > 5) ||
+      ((settings & SETTINGS_FARNSWORTH_gm) > MAX_FARNSWORTH_DITS) ||
+      !settings_mode(settings, &saved_mode) || (saved_mode != mode)) {
+    fail(CHECK_SAVED);
+  }
+  model.save_pending = 1;
+  model.pending_settings = settings;
+}
+
+void persist_tick(void) {
+  if (model.save_pending) {
+    model.save_pending = 0;
+    model.saved = 1;
+    model.saved_settings = model.pending_settings;
+  }
+}
+
+void journal_session(uint8_t level) {
+}
+
+void journal_pass(void) {
+}
+
+void journal_fail(uint8_t missed_char) {
+}
+
+void journal_tick(bool second) {
+}
+
+void counters_tick_begin(void) {
+}
+
+bool counters_second(void) {
+  return false;
+}
+
+void counters_tick_end(void) {
+}
+
+void counters_attempt_begin(void) {
+}
+
+void counters_attempt_keyed(void) {
+}
+
+void counters_attempt_graded(bool passed) {
+}
+
+void shell_tick(void) {
+}
+
+// Power-down is up to main.c, so the key never goes unused for long.
+void idle_tick(bool active, bool second) {
+}
+
+bool idle_expired(void) {
+  return false;
+}
+
+#ifdef RECEIVE
+void rx_start(void) {
+  model.rx_on = 1;
+}
+
+void rx_stop(void) {
+  model.rx_on = 0;
+}
+
+bool rx_active(void) {
+  return model.rx_on;
+}
+
+bool rx_tick(void) {
+  if (step & STEP_WORD) {
+    // The decoder fills in morse_buf[].
+    model.morse_len = model.morse_nchars = 1;
+    return true;
+  }
+  return false;
+}
+#endif
+
+static void snapshot(snap_t* s) {
+  *s = model;
+  s->mode = mode;
+  s->practice_state = practice_state;
+  s->straight_key_state = straight_key_state;
+#ifdef RECEIVE
+  s->receive_state = receive_state;
+#endif
+  s->nchars = practice_nchars;
+  s->farnsworth_dits = practice_farnsworth_dits;
+  s->attempts = practice_attempts;
+  s->key_held = key_held;
+  s->jobs_len = len;
+  for (uint8_t i = 0; i < JOBS_MAX; i++) {
+    s->jobs[i] = 0;
+    if (i < len) {
+      s->jobs[i] = (queue[(head + i) % JOBS_MAX] == generate_job) ?
+        JOB_GENERATE : JOB_MATCH;
+    }
+  }
+}
+
+static void restore(const snap_t* s) {
+  model = *s;
+  mode = s->mode;
+  practice_state = s->practice_state;
+  straight_key_state = s->straight_key_state;
+#ifdef RECEIVE
+  receive_state = s->receive_state;
+#endif
+  practice_nchars = s->nchars;
+  practice_farnsworth_dits = s->farnsworth_dits;
+  practice_attempts = s->attempts;
+  key_held = s->key_held;
+  head = 0;
+  len = s->jobs_len;
+  for (uint8_t i = 0; i < len; i++) {
+    queue[i] = (s->jobs[i] == JOB_GENERATE) ? generate_job : capture_match_step;
+  }
+}
+
+// The user is keying, or can start to.
+static bool keying(const snap_t* s) {
+  switch (s->mode) {
+    case STRAIGHT_KEY:
+      return s->straight_key_state == STRAIGHT_KEY_READY;
+    case PRACTICE:
+      return s->practice_state == PRACTICE_WAITING;
+#ifdef RECEIVE
+    case RECEIVING:
+      return s->receive_state == RECEIVE_WAITING;
+#endif
+  }
+  return false;
+}
+
+static bool users_turn(const snap_t* s) {
+#ifdef RECEIVE
+  if ((s->mode == RECEIVING) && (s->receive_state == RECEIVE_LISTENING)) {
+    return true;
+  }
+#endif
+  return keying(s);
+}
+
+static void check(const snap_t* s) {
+  if ((s->mode >= NUM_MODES) || (s->nchars < 2) || (s->nchars > 5) ||
+      (s->farnsworth_dits > MAX_FARNSWORTH_DITS) ||
+      (s->attempts > MAX_ATTEMPTS)) {
+    fail(CHECK_RANGE);
+  }
+  if (s->tone_on && !s->key_down && !s->morse_in_mark) {
+    fail(CHECK_TONE);
+  }
+  if (keying(s) && (s->tone_on != s->key_down)) {
+    fail(CHECK_SIDETONE);
+  }
+}
+
+// Takes the step from the current state, leaving the next one in s.
+static void take_step(uint16_t next_step, snap_t* s) {
+  failed = CHECK_OK;
+  step = next_step;
+  if (step & (STEP_POWER_CYCLE | STEP_POWER_ON)) {
+    // RAM starts afresh, and anything not yet written is lost.
+    uint8_t saved = model.saved;
+    uint8_t saved_settings = model.saved_settings;
+    if (step & STEP_POWER_ON) {
+      saved = (step & STEP_SAVED) != 0;
+      saved_settings = step & 0xff;
+    }
+    restore(&boot);
+    model.saved = saved;
+    model.saved_settings = saved_settings;
+    state_resume();
+  } else {
+    state_mode_t expected = next_mode();
+    state_tick();
+    if ((STEP_KEY(step) == KEY_UP_LONG) && (mode != expected)) {
+      fail(CHECK_LONG);
+    }
+  }
+  snapshot(s);
+  check(s);
+}
+
+static uint64_t hash(const snap_t* s) {
+  const uint8_t* p = (const uint8_t*)s;
+  uint64_t h = 14695981039346656037ULL;
+  for (size_t i = 0; i < sizeof(*s); i++) {
+    h = (h ^ p[i]) * 1099511628211ULL;
+  }
+  return h;
+}
+
+// Returns the node for s, adding it if it's new. Adding writes out the
+// node before publishing it in the hash set, so any worker that finds
+// it there can compare against it. A node that loses the race for a
+// slot to the same state is left behind, not live.
+static uint32_t insert(const snap_t* s, uint32_t parent, uint16_t from_step,
+                       uint16_t depth) {
+  uint32_t id = NO_NODE;
+  for (uint32_t i = hash(s) & slots_mask;; i = (i + 1) & slots_mask) {
+    uint32_t v = atomic_load(&slots[i]);
+    if (!v) {
+      if (id == NO_NODE) {
+        id = atomic_fetch_add(&shared->nstates, 1);
+        if (id >= max_states) {
+          atomic_store(&shared->full, true);
+          return NO_NODE;
+        }
+        nodes[id].s = *s;
+        nodes[id].parent = parent;
+        nodes[id].step = from_step;
+        nodes[id].depth = depth;
+      }
+      if (atomic_compare_exchange_strong(&slots[i], &v, id + 1)) {
+        atomic_store(&nodes[id].live, 1);
+        return id;
+      }
+    }
+    if (!memcmp(&nodes[v - 1].s, s, sizeof(*s))) {
+      return v - 1;
+    }
+  }
+}
+
+static void violation(check_t check, uint32_t id) {
+  unsigned none = CHECK_OK;
+  if (atomic_compare_exchange_strong(&shared->violation, &none, check)) {
+    atomic_store(&shared->violation_node, id);
+  }
+}
+
+static bool step_allowed(uint16_t s) {
+  key_state_t key = STEP_KEY(s);
+  if (model.key_down ? (key == KEY_DOWN) :
+      ((key == KEY_UP) || (key == KEY_UP_LONG))) {
+    return false;
+  }
+  if (!morse_allowed(STEP_MORSE(s))) {
+    return false;
+  }
+  // Only a key that's been let go of times out, and only if it's not
+  // moving this tick.
+  if ((s & STEP_TIMEOUT) && ((key != KEY_NO_CHANGE) || model.capture_in_mark)) {
+    return false;
+  }
+  if ((s & STEP_PASS) && !((s & STEP_TIMEOUT) && model.captured)) {
+    return false;
+  }
+  if ((s & STEP_WORD) && !model.rx_on) {
+    return false;
+  }
+  return true;
+}
+
+// How far out of the way a step is: idle, pressing the key, or a
+// power cycle.
+static uint8_t edge_class(uint16_t st) {
+  if (st & STEP_POWER_CYCLE) {
+    return 2;
+  }
+  return ((STEP_KEY(st) == KEY_NO_CHANGE) || (STEP_KEY(st) == KEY_UP)) ? 0 : 1;
+}
+
+static void expand(uint32_t id) {
+  const node_t* n = &nodes[id];
+  uint32_t next[STEP_POWER_CYCLE + 1];
+  uint16_t next_steps[STEP_POWER_CYCLE + 1];
+  uint32_t nnext = 0;
+  snap_t s;
+
+  for (uint16_t st = 0; st <= STEP_POWER_CYCLE; st++) {
+    restore(&n->s);
+    if ((st < STEP_POWER_CYCLE) && !step_allowed(st)) {
+      continue;
+    }
+    take_step(st, &s);
+    uint32_t to = insert(&s, id, st, n->depth + 1);
+    if (to == NO_NODE) {
+      return;
+    }
+    if (failed != CHECK_OK) {
+      violation(failed, to);
+    }
+    // One edge to each next state is enough, as long as it's one
+    // the liveness checks would follow if there's one.
+    bool seen = false;
+    for (uint32_t i = 0; i < nnext; i++) {
+      if ((next[i] == to) && (edge_class(next_steps[i]) <= edge_class(st))) {
+        seen = true;
+      }
+    }
+    if (!seen) {
+      next[nnext] = to;
+      next_steps[nnext++] = st;
+    }
+  }
+
+  uint32_t at = atomic_fetch_add(&shared->nedges, nnext);
+  if (at + nnext > max_edges) {
+    atomic_store(&shared->full, true);
+    return;
+  }
+  for (uint32_t i = 0; i < nnext; i++) {
+    edges[at + i].from = id;
+    edges[at + i].to = next[i];
+    edges[at + i].step = next_steps[i];
+  }
+}
+
+// Expands the nodes from cursor up to end, a batch at a time.
+static void drain(int w) {
+  uint32_t i;
+  while ((i = atomic_fetch_add(&shared->cursor[w], BATCH)) < shared->end[w]) {
+    uint32_t end = (i + BATCH < shared->end[w]) ? i + BATCH : shared->end[w];
+    for (; i < end; i++) {
+      if (atomic_load(&nodes[i].live)) {
+        expand(i);
+      }
+    }
+  }
+}
+
+// Splits up the next level between the workers. Only one worker calls
+// this, between barriers.
+static void next_level(void) {
+  shared->lo = shared->hi;
+  shared->hi = atomic_load(&shared->nstates);
+  if (shared->hi > max_states) {
+    shared->hi = max_states;
+  }
+  shared->done = (shared->lo == shared->hi) ||
+    atomic_load(&shared->violation) || atomic_load(&shared->full);
+  uint32_t share = (shared->hi - shared->lo + workers - 1) / workers;
+  for (int w = 0; w < workers; w++) {
+    uint32_t from = shared->lo + w * share;
+    atomic_store(&shared->cursor[w], (from < shared->hi) ? from : shared->hi);
+    shared->end[w] = (from + share < shared->hi) ? from + share : shared->hi;
+  }
+}
+
+static void worker(int w) {
+  for (;;) {
+    pthread_barrier_wait(&shared->barrier);
+    if (shared->done) {
+      return;
+    }
+    drain(w);
+    for (int v = 1; v < workers; v++) {
+      drain((w + v) % workers);
+    }
+    if (pthread_barrier_wait(&shared->barrier) ==
+        PTHREAD_BARRIER_SERIAL_THREAD) {
+      next_level();
+    }
+  }
+}
+
+static const char* const MODE_NAMES[] = {"straight_key", "practice", "receive"};
+static const char* const STRAIGHT_KEY_NAMES[] = {"announcing", "ready"};
+static const char* const PRACTICE_NAMES[] = {
+  "announcing", "sending", "waiting",
+};
+static const char* const RECEIVE_NAMES[] = {
+  "announcing", "listening", "waiting", "replaying",
+};
+static const char* const KEY_NAMES[] = {"-", "down", "up", "up_long"};
+static const char* const MORSE_NAMES[] = {"none", "hold", "mark", "space"};
+
+static void print_state(const snap_t* s) {
+  const char* sub = (s->mode == STRAIGHT_KEY) ?
+    STRAIGHT_KEY_NAMES[s->straight_key_state] :
+    (s->mode == PRACTICE) ? PRACTICE_NAMES[s->practice_state] :
+    RECEIVE_NAMES[s->receive_state];
+  printf("%s/%s nchars=%d farnsworth=%d attempts=%d key=%s tone=%s "
+         "morse=%s letters=%d/%d captured=%d%s jobs=",
+         MODE_NAMES[s->mode], sub, s->nchars, s->farnsworth_dits,
+         s->attempts, s->key_down ? "down" : "up", s->tone_on ? "on" : "off",
+         !s->morse_playing ? "idle" : s->morse_in_mark ? "mark" : "space",
+         s->morse_len, s->morse_nchars, s->captured,
+         s->capture_in_mark ? "+" : "");
+  for (uint8_t i = 0; i < s->jobs_len; i++) {
+    printf("%c", (s->jobs[i] == JOB_GENERATE) ? 'g' : 'm');
+  }
+  if (s->saved) {
+    printf(" saved=0x%02x", s->saved_settings);
+  }
+  printf("\n");
+}
+
+static void print_step(uint16_t st) {
+  if (st & STEP_POWER_ON) {
+    if (st & STEP_SAVED) {
+      printf("power on, saved 0x%02x", st & 0xff);
+    } else {
+      printf("power on, nothing saved");
+    }
+  } else if (st & STEP_POWER_CYCLE) {
+    printf("power cycle");
+  } else {
+    printf("key %s, morse %s%s%s%s", KEY_NAMES[STEP_KEY(st)],
+           MORSE_NAMES[STEP_MORSE(st)], (st & STEP_TIMEOUT) ? ", timeout" : "",
+           (st & STEP_TIMEOUT) ? ((st & STEP_PASS) ? " passed" : " failed") : "",
+           (st & STEP_WORD) ? ", heard a word" : "");
+  }
+}
+
+static void print_trace(check_t check, uint32_t id) {
+  printf("%s: %s\n", CHECK_NAMES[check], CHECK_TEXT[check]);
+  uint32_t depth = nodes[id].depth;
+  uint32_t* path = malloc((depth + 1) * sizeof(uint32_t));
+  for (uint32_t i = depth + 1; i > 0; i--) {
+    path[i - 1] = id;
+    id = nodes[id].parent;
+  }
+  for (uint32_t i = 0; i <= depth; i++) {
+    printf("%4u  ", i);
+    print_step(nodes[path[i]].step);
+    printf("\n      ");
+    print_state(&nodes[path[i]].s);
+  }
+  free(path);
+}
+
+static bool idle_step(uint16_t st) {
+  return edge_class(st) == 0;
+}
+
+// Marks each live node that can reach one where goal() holds, going
+// back along the edges that allow() lets through. Returns the
+// shallowest node that can't, or NO_NODE.
+static uint32_t unreachable(uint32_t nstates, uint32_t nedges,
+                            const uint32_t* first, const uint32_t* from,
+                            const uint16_t* steps,
+                            bool (*goal)(const snap_t*, int), int arg,
+                            bool (*allow)(uint16_t)) {
+  uint8_t* reached = calloc(nstates, 1);
+  uint32_t* queue_ids = malloc(nstates * sizeof(uint32_t));
+  uint32_t qlen = 0;
+  for (uint32_t i = 0; i < nstates; i++) {
+    if (nodes[i].live && goal(&nodes[i].s, arg)) {
+      reached[i] = 1;
+      queue_ids[qlen++] = i;
+    }
+  }
+  for (uint32_t q = 0; q < qlen; q++) {
+    uint32_t to = queue_ids[q];
+    for (uint32_t e = first[to]; e < first[to + 1]; e++) {
+      if (!reached[from[e]] && allow(steps[e])) {
+        reached[from[e]] = 1;
+        queue_ids[qlen++] = from[e];
+      }
+    }
+  }
+  uint32_t worst = NO_NODE;
+  for (uint32_t i = 0; i < nstates; i++) {
+    if (nodes[i].live && !reached[i] &&
+        ((worst == NO_NODE) || (nodes[i].depth < nodes[worst].depth))) {
+      worst = i;
+    }
+  }
+  free(queue_ids);
+  free(reached);
+  return worst;
+}
+
+static bool is_users_turn(const snap_t* s, int arg) {
+  return users_turn(s);
+}
+
+static bool in_mode(const snap_t* s, int m) {
+  return s->mode == m;
+}
+
+static bool any_but_power(uint16_t st) {
+  return edge_class(st) < 2;
+}
+
+static bool check_liveness(uint32_t nstates, uint32_t nedges) {
+  // Edges grouped by where they go to.
+  uint32_t* first = calloc(nstates + 1, sizeof(uint32_t));
+  uint32_t* from = malloc(nedges * sizeof(uint32_t));
+  uint16_t* steps = malloc(nedges * sizeof(uint16_t));
+  for (uint32_t e = 0; e < nedges; e++) {
+    first[edges[e].to + 1]++;
+  }
+  for (uint32_t i = 0; i < nstates; i++) {
+    first[i + 1] += first[i];
+  }
+  uint32_t* fill = malloc(nstates * sizeof(uint32_t));
+  memcpy(fill, first, nstates * sizeof(uint32_t));
+  for (uint32_t e = 0; e < nedges; e++) {
+    uint32_t at = fill[edges[e].to]++;
+    from[at] = edges[e].from;
+    steps[at] = edges[e].step;
+  }
+  free(fill);
+
+  bool ok = true;
+  uint32_t id = unreachable(nstates, nedges, first, from, steps,
+                            is_users_turn, 0, idle_step);
+  if (id != NO_NODE) {
+    print_trace(CHECK_IDLE, id);
+    ok = false;
+  }
+  for (int m = 0; ok && (m < NUM_MODES); m++) {
+    id = unreachable(nstates, nedges, first, from, steps, in_mode, m,
+                     any_but_power);
+    if (id != NO_NODE) {
+      print_trace(CHECK_MODES, id);
+      printf("      (can't reach %s)\n", MODE_NAMES[m]);
+      ok = false;
+    }
+  }
+  free(first);
+  free(from);
+  free(steps);
+  return ok;
+}
+
+static void* shared_alloc(size_t size) {
+  void* p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (p == MAP_FAILED) {
+    perror("mmap");
+    exit(1);
+  }
+  return p;
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: state_check [-j workers] [-n max_states]\n");
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  workers = (cpus > 0) ? cpus : 1;
+  max_states = 1 << 20;
+  int opt;
+  while ((opt = getopt(argc, argv, "j:n:")) != -1) {
+    switch (opt) {
+      case 'j':
+        workers = atoi(optarg);
+        break;
+      case 'n':
+        max_states = strtoul(optarg, NULL, 0);
+        break;
+      default:
+        usage();
+    }
+  }
+  if (optind != argc) {
+    usage();
+  }
+  if (workers < 1) {
+    workers = 1;
+  }
+  if (workers > MAX_WORKERS) {
+    workers = MAX_WORKERS;
+  }
+  uint32_t nslots = 1;
+  while (nslots < 2 * max_states) {
+    nslots <<= 1;
+  }
+  slots_mask = nslots - 1;
+  max_edges = max_states * EDGES_PER_STATE;
+
+  shared = shared_alloc(sizeof(shared_t));
+  nodes = shared_alloc((size_t)max_states * sizeof(node_t));
+  slots = shared_alloc((size_t)nslots * sizeof(atomic_uint));
+  edges = shared_alloc((size_t)max_edges * sizeof(edge_t));
+  pthread_barrierattr_t attr;
+  pthread_barrierattr_init(&attr);
+  pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  pthread_barrier_init(&shared->barrier, &attr, workers);
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  // The globals as they are at power on.
+  snapshot(&boot);
+
+  snap_t s;
+  for (int saved = -1; saved < 0x100; saved++) {
+    uint16_t st = STEP_POWER_ON | ((saved >= 0) ? STEP_SAVED | saved : 0);
+    take_step(st, &s);
+    uint32_t id = insert(&s, NO_NODE, st, 0);
+    if (failed != CHECK_OK) {
+      violation(failed, id);
+    }
+  }
+
+  shared->hi = 0;
+  next_level();
+
+  pid_t pids[MAX_WORKERS];
+  for (int w = 0; w < workers; w++) {
+    pids[w] = fork();
+    if (pids[w] < 0) {
+      perror("fork");
+      exit(1);
+    }
+    if (pids[w] == 0) {
+      worker(w);
+      _exit(0);
+    }
+  }
+  int status = 0;
+  for (int w = 0; w < workers; w++) {
+    int ws;
+    pid_t pid = wait(&ws);
+    if (!WIFEXITED(ws) || WEXITSTATUS(ws)) {
+      // The rest would wait at the barrier forever.
+      fprintf(stderr, "state_check: worker %d failed\n", (int)pid);
+      for (int v = 0; v < workers; v++) {
+        kill(pids[v], SIGKILL);
+      }
+      exit(1);
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  uint32_t nstates = atomic_load(&shared->nstates);
+  uint32_t nedges = atomic_load(&shared->nedges);
+  if (atomic_load(&shared->full)) {
+    fprintf(stderr, "state_check: more than %u states, try a larger -n\n",
+            max_states);
+    return 1;
+  }
+  uint32_t live = 0, depth = 0;
+  for (uint32_t i = 0; i < nstates; i++) {
+    if (nodes[i].live) {
+      live++;
+      depth = (nodes[i].depth > depth) ? nodes[i].depth : depth;
+    }
+  }
+  printf("state_check: %u states, %u edges, depth %u, %d workers, %.2fs\n",
+         live, nedges, depth, workers,
+         (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+
+  check_t check = atomic_load(&shared->violation);
+  if (check != CHECK_OK) {
+    print_trace(check, atomic_load(&shared->violation_node));
+    status = 1;
+  } else if (!check_liveness(nstates, nedges)) {
+    status = 1;
+  }
+  return status;
+}
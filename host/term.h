@@ -0,0 +1,44 @@
+#pragma once
+
+// Host side of the terminal build of the trainer. These stand in for
+// the hardware behind hal_key.h, tone.h, hal_eeprom.h, uart.h and
+// ticks.h, so the unchanged state machine from src/ can run on a
+// laptop.
+//
+// The key is the space bar, read either from a terminal that can
+// report key releases or straight from a Linux input device. The
+// sidetone is a sine wave written out as 16-bit PCM, one tick's worth
+// of samples at a time.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// CLOCK_MONOTONIC in nanoseconds.
+uint64_t term_now_ns(void);
+
+// Opens the keyboard, either the controlling terminal or the given
+// input device. Returns false, having said why, if neither will do.
+bool term_key_open(const char* device);
+void term_key_close(void);
+
+// Reads pending input. Returns false once the user asks to quit. The
+// time of the most recent press of the key is left in
+// term_key_down_ns, and other keys are passed on as uart input.
+bool term_key_poll(void);
+extern uint64_t term_key_down_ns;
+
+// Starts writing PCM at the given rate, with a WAV header if asked.
+void term_tone_open(FILE* out, bool wav, unsigned rate, unsigned pitch);
+void term_tone_close(void);
+
+// Writes out the next tick of audio. Returns true if the tone came on
+// during it.
+bool term_tone_render(void);
+
+// Loads and saves the EEPROM image, so settings and the journal
+// survive from one run to the next.
+void term_eeprom_load(const char* path);
+void term_eeprom_save(const char* path);
+
+void term_uart_receive(uint8_t c);
@@ -0,0 +1,42 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "hal_eeprom.h"
+#include "term.h"
+
+static uint8_t eeprom[EEPROM_BYTES];
+
+void term_eeprom_load(const char* path) {
+  memset(eeprom, 0xff, sizeof(eeprom));
+  FILE* f = path ? fopen(path, "rb") : NULL;
+  if (f) {
+    fread(eeprom, 1, sizeof(eeprom), f);
+    fclose(f);
+  }
+}
+
+void term_eeprom_save(const char* path) {
+  FILE* f = path ? fopen(path, "wb") : NULL;
+  if (f) {
+    fwrite(eeprom, 1, sizeof(eeprom), f);
+    fclose(f);
+  }
+}
+
+uint8_t hal_eeprom_read(uint8_t addr) {
+  return eeprom[addr];
+}
+
+bool hal_eeprom_ready(void) {
+  return true;
+}
+
+void hal_eeprom_write(uint8_t addr, const uint8_t* buf, uint8_t len) {
+  memcpy(eeprom + addr, buf, len);
+}
+
+void hal_eeprom_erase(uint8_t addr, uint8_t len) {
+  memset(eeprom + addr, 0xff, len);
+}
@@ -0,0 +1,226 @@
+#include <fcntl.h>
+#include <linux/input.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hal_key.h"
+#include "term.h"
+
+// Terminals only send key releases with the kitty keyboard protocol.
+// Ask for every key as an escape code, with its event type.
+#define KITTY_PUSH "\033[>11u"
+#define KITTY_POP "\033[<u"
+#define KITTY_QUERY "\033[?u\033[c"
+
+#define KITTY_PRESS 1
+#define KITTY_RELEASE 3
+#define KITTY_CTRL 4
+
+#define CTRL_C 3
+#define ESC 27
+
+uint64_t term_key_down_ns = 0;
+
+static int tty = -1;
+static int device = -1;
+static struct termios saved_termios;
+static bool pressed = false;
+static bool kitty = false;
+
+// Escape sequence being read from the terminal.
+static char seq[32];
+static uint8_t seq_len = 0;
+
+uint64_t term_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void hal_key_init(void) {
+}
+
+bool hal_key_pressed(void) {
+  return pressed;
+}
+
+static void key_event(bool down, uint64_t at) {
+  if (down && !pressed) {
+    term_key_down_ns = at;
+  }
+  pressed = down;
+}
+
+// Waits a little while for the terminal to answer a query about the
+// kitty protocol. The answer to the device attributes query that
+// follows it arrives either way.
+static bool kitty_supported(void) {
+  if (write(tty, KITTY_QUERY, sizeof(KITTY_QUERY) - 1) < 0) {
+    return false;
+  }
+  bool supported = false;
+  char buf[64];
+  int len = 0;
+  struct pollfd pfd = {tty, POLLIN, 0};
+  while ((len < sizeof(buf) - 1) && (poll(&pfd, 1, 200) > 0)) {
+    if (read(tty, buf + len, 1) != 1) {
+      break;
+    }
+    len++;
+    buf[len] = 0;
+    if (buf[len - 1] == 'u') {
+      supported = true;
+    } else if (buf[len - 1] == 'c') {
+      break;
+    }
+  }
+  return supported;
+}
+
+bool term_key_open(const char* device_path) {
+  tty = open("/dev/tty", O_RDWR | O_NONBLOCK);
+  if (tty < 0) {
+    perror("/dev/tty");
+    return false;
+  }
+  tcgetattr(tty, &saved_termios);
+  struct termios raw = saved_termios;
+  raw.c_lflag &= ~(ICANON | ECHO | ISIG);
+  raw.c_cc[VMIN] = 0;
+  raw.c_cc[VTIME] = 0;
+  tcsetattr(tty, TCSANOW, &raw);
+
+  if (device_path) {
+    device = open(device_path, O_RDONLY | O_NONBLOCK);
+    if (device < 0) {
+      perror(device_path);
+      term_key_close();
+      return false;
+    }
+    // Stamp events with the same clock as everything else.
+    int clock = CLOCK_MONOTONIC;
+    ioctl(device, EVIOCSCLOCKID, &clock);
+    return true;
+  }
+
+  if (!kitty_supported()) {
+    fprintf(stderr,
+            "This terminal can't report key releases. Use a terminal with "
+            "the kitty keyboard protocol, or read the keyboard directly "
+            "with -k /dev/input/eventN.\n");
+    term_key_close();
+    return false;
+  }
+  kitty = true;
+  write(tty, KITTY_PUSH, sizeof(KITTY_PUSH) - 1);
+  return true;
+}
+
+void term_key_close(void) {
+  if (tty < 0) {
+    return;
+  }
+  if (kitty) {
+    write(tty, KITTY_POP, sizeof(KITTY_POP) - 1);
+    kitty = false;
+  }
+  tcsetattr(tty, TCSANOW, &saved_termios);
+  close(tty);
+  tty = -1;
+  if (device >= 0) {
+    close(device);
+    device = -1;
+  }
+}
+
+// Handles a key from the terminal. Returns false if it means quit.
+static bool terminal_key(unsigned key, unsigned mods, unsigned event,
+                         uint64_t at) {
+  if ((key == CTRL_C) || (key == ESC) ||
+      ((key == 'c') && (mods & KITTY_CTRL))) {
+    return false;
+  }
+  if (key == ' ') {
+    // The input device reports the space bar itself.
+    if (device < 0) {
+      key_event(event != KITTY_RELEASE, at);
+    }
+  } else if ((event == KITTY_PRESS) && (key < 0x80)) {
+    term_uart_receive(key);
+  }
+  return true;
+}
+
+// Handles a complete CSI sequence, which with the kitty protocol looks
+// like "key[:alternates][;mods[:event][;text]]u".
+static bool terminal_sequence(uint64_t at) {
+  if ((seq_len < 2) || (seq[seq_len - 1] != 'u')) {
+    // Not a key we care about.
+    return true;
+  }
+  seq[seq_len] = 0;
+  unsigned key = 0;
+  unsigned mods = 1;
+  unsigned event = KITTY_PRESS;
+  const char* p = seq + 2;
+  sscanf(p, "%u", &key);
+  p = strchr(p, ';');
+  if (p) {
+    sscanf(p + 1, "%u:%u", &mods, &event);
+  }
+  return terminal_key(key, mods - 1, event, at);
+}
+
+static bool poll_terminal(uint64_t at) {
+  char c;
+  while (read(tty, &c, 1) == 1) {
+    if (seq_len) {
+      if (seq_len < sizeof(seq) - 1) {
+        seq[seq_len++] = c;
+      }
+      if ((seq_len > 2) && (c >= 0x40) && (c <= 0x7e)) {
+        bool keep_going = terminal_sequence(at);
+        seq_len = 0;
+        if (!keep_going) {
+          return false;
+        }
+      }
+      continue;
+    }
+    if (c == ESC) {
+      seq[seq_len++] = c;
+      continue;
+    }
+    if (!terminal_key((uint8_t)c, 0, KITTY_PRESS, at)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void poll_device(void) {
+  struct input_event ev;
+  while (read(device, &ev, sizeof(ev)) == sizeof(ev)) {
+    if ((ev.type != EV_KEY) || (ev.code != KEY_SPACE) || (ev.value == 2)) {
+      // Not the key, or just autorepeat.
+      continue;
+    }
+    uint64_t at = (uint64_t)ev.input_event_sec * 1000000000 +
+      ev.input_event_usec * 1000;
+    key_event(ev.value, at);
+  }
+}
+
+bool term_key_poll(void) {
+  if (device >= 0) {
+    poll_device();
+  }
+  return poll_terminal(term_now_ns());
+}
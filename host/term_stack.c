@@ -0,0 +1,8 @@
+#include <stdint.h>
+
+#include "hal_stack.h"
+
+// There's no painted stack on the host, and plenty of room.
+uint8_t hal_stack_free(void) {
+  return 0xff;
+}
@@ -0,0 +1,130 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "term.h"
+#include "tone.h"
+
+#define AMPLITUDE 12000
+
+// Most samples in a tick, at 192kHz.
+#define TICK_SAMPLES_MAX 192
+
+static FILE* out = NULL;
+static bool wav = false;
+static unsigned rate = 0;
+// Samples per tick is rate / 1024, with the remainder carried in
+// tick_rem so the output keeps up with the ticks.
+static unsigned tick_rem = 0;
+static uint32_t data_bytes = 0;
+
+static double phase = 0;
+static double phase_step = 0;
+
+// Fade the tone in and out with a raised cosine over 5ms, as the
+// device does.
+#define ENVELOPE_MS 5
+static double envelope = 0;
+static double envelope_step = 0;
+
+static bool tone_enabled = false;
+static bool was_enabled = false;
+
+static void put_le(uint8_t* p, uint32_t v, int n) {
+  while (n--) {
+    *p++ = v;
+    v >>= 8;
+  }
+}
+
+static void write_wav_header(void) {
+  uint8_t hdr[44] = "RIFF\0\0\0\0WAVEfmt ";
+  put_le(hdr + 4, 36 + data_bytes, 4);
+  put_le(hdr + 16, 16, 4);
+  put_le(hdr + 20, 1, 2);
+  put_le(hdr + 22, 1, 2);
+  put_le(hdr + 24, rate, 4);
+  put_le(hdr + 28, rate * 2, 4);
+  put_le(hdr + 32, 2, 2);
+  put_le(hdr + 34, 16, 2);
+  put_le(hdr + 36, 0x61746164, 4);
+  put_le(hdr + 40, data_bytes, 4);
+  fwrite(hdr, 1, sizeof(hdr), out);
+}
+
+void term_tone_open(FILE* f, bool with_header, unsigned sample_rate,
+                    unsigned pitch) {
+  out = f;
+  wav = with_header;
+  rate = sample_rate;
+  tick_rem = 0;
+  phase_step = 2 * M_PI * pitch / rate;
+  envelope_step = 1000.0 / (ENVELOPE_MS * rate);
+  data_bytes = 0;
+  if (wav) {
+    // The sizes are filled in once we're done.
+    write_wav_header();
+  }
+}
+
+void term_tone_close(void) {
+  fflush(out);
+  if (wav && !fseek(out, 0, SEEK_SET)) {
+    write_wav_header();
+    fflush(out);
+  }
+}
+
+void tone_init(void) {
+}
+
+void tone_enable(bool enable) {
+  tone_enabled = enable;
+}
+
+bool tone_active(void) {
+  return tone_enabled || (envelope > 0);
+}
+
+void tone_tick(void) {
+}
+
+bool term_tone_render(void) {
+  uint8_t buf[TICK_SAMPLES_MAX * 2];
+  tick_rem += rate;
+  unsigned tick_samples = tick_rem / 1024;
+  tick_rem %= 1024;
+  if (tick_samples > TICK_SAMPLES_MAX) {
+    tick_samples = TICK_SAMPLES_MAX;
+  }
+  for (unsigned i = 0; i < tick_samples; i++) {
+    if (tone_enabled && (envelope < 1)) {
+      envelope += envelope_step;
+      if (envelope > 1) {
+        envelope = 1;
+      }
+    } else if (!tone_enabled && (envelope > 0)) {
+      envelope -= envelope_step;
+    }
+    if (envelope <= 0) {
+      // Start each mark at the same point in the wave.
+      envelope = 0;
+      phase = 0;
+    }
+    double gain = (1 - cos(M_PI * envelope)) / 2;
+    put_le(buf + 2 * i, (int16_t)(AMPLITUDE * gain * sin(phase)), 2);
+    phase += phase_step;
+    if (phase > 2 * M_PI) {
+      phase -= 2 * M_PI;
+    }
+  }
+  fwrite(buf, 2, tick_samples, out);
+  // Hand it over right away, rather than when stdio's buffer fills up.
+  fflush(out);
+  data_bytes += 2 * tick_samples;
+
+  bool started = tone_enabled && !was_enabled;
+  was_enabled = tone_enabled;
+  return started;
+}
@@ -0,0 +1,40 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "term.h"
+#include "uart.h"
+
+// Keys typed ahead of the shell.
+static uint8_t rx[16];
+static uint8_t rx_head = 0;
+static uint8_t rx_len = 0;
+
+void term_uart_receive(uint8_t c) {
+  if (rx_len < sizeof(rx)) {
+    rx[(rx_head + rx_len++) % sizeof(rx)] = c;
+  }
+}
+
+void uart_init(void) {
+}
+
+// What the device would send goes to stderr, as stdout has the audio.
+bool uart_put(uint8_t c) {
+  fputc(c, stderr);
+  return true;
+}
+
+int16_t uart_get(void) {
+  if (!rx_len) {
+    return -1;
+  }
+  uint8_t c = rx[rx_head];
+  rx_head = (rx_head + 1) % sizeof(rx);
+  rx_len--;
+  return c;
+}
+
+bool uart_busy(void) {
+  return false;
+}
@@ -0,0 +1,379 @@
+// Summarizes large corpora of keyed timings, one file per operator,
+// with the same rules the device grades by.
+//
+//   ./timing_stats [-j threads] [-o prefix] operator.tim ...
+//
+// A timing file is a run of attempts, each a little endian int16 0,
+// then the number of characters that were asked for and their ASCII
+// codes (A-Z, 0-9), then the timings that were keyed, in ticks, in
+// capture.c's convention: positive for marks and negative for spaces.
+// The attempt ends at the next 0 or the end of the file. Files are
+// memory mapped and shared out between threads, so one large file
+// is still handled by one thread, but a class's worth of them isn't.
+//
+// Each operator gets one line of summary, with tab separated:
+//
+//   name attempts passed dit_mean dah_mean dah/dit gap_mean
+//   letter_gap_mean drift errors
+//
+// Means are in ticks, and only come from attempts that had exactly
+// the marks that were asked for, so each can be lined up with the
+// element it was meant to be. drift is the least squares slope of
+// the dit length over the file, in ticks per 100 attempts: negative
+// means the operator sped up. errors lists each character that was
+// asked for along with how often and how often it was the one
+// cw::Grader gave up on, as "A:3/40,B:0/12".
+//
+// With -o, the summaries go to prefix.tsv instead of stdout, and
+// prefix_hist.tsv gets each operator's mark and space histograms in
+// HIST_BUCKET tick buckets, the last being everything longer.
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cw.hpp"
+
+#define HIST_BUCKET 10
+#define HIST_BUCKETS 100
+
+// Longest attempt graded, the most the device can send.
+#define ATTEMPT_CHARS_MAX 5
+
+struct Stats {
+  std::string name;
+  bool ok = false;
+
+  uint32_t attempts = 0;
+  uint32_t passed = 0;
+
+  // Sums over lined up elements, in ticks.
+  uint64_t dit_sum = 0, dah_sum = 0, gap_sum = 0, letter_gap_sum = 0;
+  uint32_t dits = 0, dahs = 0, gaps = 0, letter_gaps = 0;
+
+  // For the drift fit, over lined up attempts: x is the attempt
+  // number and y the mean dit length in the attempt.
+  double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+
+  uint32_t asked[cw::NUM_CHARS] = {};
+  uint32_t missed[cw::NUM_CHARS] = {};
+
+  uint32_t mark_hist[HIST_BUCKETS + 1] = {};
+  uint32_t space_hist[HIST_BUCKETS + 1] = {};
+};
+
+// ASCII to an ENCODING[] index, or NUM_CHARS.
+static uint8_t char_index(int c) {
+  if ((c >= 'A') && (c <= 'Z')) {
+    return c - 'A';
+  }
+  if ((c >= 'a') && (c <= 'z')) {
+    return c - 'a';
+  }
+  if ((c >= '0') && (c <= '9')) {
+    return 26 + c - '0';
+  }
+  return cw::NUM_CHARS;
+}
+
+static char index_char(uint8_t idx) {
+  return (idx < 26) ? 'A' + idx : '0' + idx - 26;
+}
+
+// Counts the marks in a run of timings. Written without branches so
+// it vectorizes, as this and the histograms are the passes that see
+// every timing.
+static uint32_t count_marks(const int16_t* t, size_t len) {
+  uint32_t marks = 0;
+  for (size_t i = 0; i < len; i++) {
+    marks += t[i] > 0;
+  }
+  return marks;
+}
+
+static void histogram(Stats* s, const int16_t* t, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    int v = t[i];
+    unsigned bucket = ((v < 0) ? -v : v) / HIST_BUCKET;
+    if (bucket > HIST_BUCKETS) {
+      bucket = HIST_BUCKETS;
+    }
+    if (v > 0) {
+      s->mark_hist[bucket]++;
+    } else {
+      s->space_hist[bucket]++;
+    }
+  }
+}
+
+// Adds up each mark and space as the element or gap it was meant to
+// be. Only called when the number of marks is right.
+static void line_up(Stats* s, const uint8_t* chars, uint8_t nchars,
+                    const int16_t* t, size_t len) {
+  uint64_t dit_sum = 0, dah_sum = 0;
+  uint32_t dits = 0, dahs = 0;
+  size_t idx = 0;
+  for (uint8_t i = 0; i < nchars; i++) {
+    uint8_t encoded = cw::ENCODING[chars[i]];
+    for (int8_t pos = cw::num_elements(encoded) - 1; pos >= 0; pos--) {
+      while ((idx < len) && (t[idx] <= 0)) {
+        // Spaces before the first mark aren't recorded by capture.c,
+        // but skip any that were.
+        idx++;
+      }
+      if (idx >= len) {
+        return;
+      }
+      if (cw::is_dah(encoded, pos)) {
+        dah_sum += t[idx];
+        dahs++;
+      } else {
+        dit_sum += t[idx];
+        dits++;
+      }
+      idx++;
+      if ((idx < len) && (t[idx] < 0)) {
+        if (pos) {
+          s->gap_sum -= t[idx];
+          s->gaps++;
+        } else {
+          s->letter_gap_sum -= t[idx];
+          s->letter_gaps++;
+        }
+      }
+    }
+  }
+  s->dit_sum += dit_sum;
+  s->dah_sum += dah_sum;
+  s->dits += dits;
+  s->dahs += dahs;
+
+  // Dahs count as three dits towards the speed.
+  if (dits + dahs) {
+    double y = (double)(dit_sum + dah_sum) / (dits + 3 * dahs);
+    double x = s->attempts;
+    s->n++;
+    s->sx += x;
+    s->sy += y;
+    s->sxx += x * x;
+    s->sxy += x * y;
+  }
+}
+
+static void attempt(Stats* s, cw::Grader<>* grader, const uint8_t* chars,
+                    uint8_t nchars, const int16_t* t, size_t len) {
+  uint8_t buf[ATTEMPT_CHARS_MAX];
+  uint32_t elements = 0;
+  for (uint8_t i = 0; i < nchars; i++) {
+    buf[i] = cw::ENCODING[chars[i]];
+    elements += cw::num_elements(buf[i]);
+    s->asked[chars[i]]++;
+  }
+
+  histogram(s, t, len);
+  if (count_marks(t, len) == elements) {
+    line_up(s, chars, nchars, t, len);
+  }
+
+  grader->reset();
+  for (size_t i = 0; i < len; i++) {
+    grader->push(t[i]);
+  }
+  if (grader->match(buf, nchars)) {
+    s->passed++;
+  } else if (grader->missed_char() < nchars) {
+    s->missed[chars[grader->missed_char()]]++;
+  }
+  s->attempts++;
+}
+
+static bool analyze(Stats* s, const char* path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    perror(path);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    perror(path);
+    close(fd);
+    return false;
+  }
+  size_t len = st.st_size / sizeof(int16_t);
+  if (!len) {
+    close(fd);
+    return true;
+  }
+  void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    perror(path);
+    return false;
+  }
+  madvise(map, st.st_size, MADV_SEQUENTIAL);
+  const int16_t* data = (const int16_t*)map;
+
+  cw::Grader<> grader;
+  size_t i = 0;
+  bool ok = true;
+  while (i < len) {
+    if (data[i] != 0) {
+      fprintf(stderr, "%s: expected an attempt at %zu\n", path,
+              i * sizeof(int16_t));
+      ok = false;
+      break;
+    }
+    i++;
+    uint8_t nchars = (i < len) ? data[i++] : 0;
+    if ((nchars == 0) || (nchars > ATTEMPT_CHARS_MAX) || (i + nchars > len)) {
+      fprintf(stderr, "%s: bad attempt at %zu\n", path, i * sizeof(int16_t));
+      ok = false;
+      break;
+    }
+    uint8_t chars[ATTEMPT_CHARS_MAX];
+    for (uint8_t c = 0; c < nchars; c++) {
+      chars[c] = char_index(data[i++]);
+      if (chars[c] >= cw::NUM_CHARS) {
+        ok = false;
+      }
+    }
+    if (!ok) {
+      fprintf(stderr, "%s: bad character at %zu\n", path, i * sizeof(int16_t));
+      break;
+    }
+    size_t start = i;
+    while ((i < len) && (data[i] != 0)) {
+      i++;
+    }
+    attempt(s, &grader, chars, nchars, data + start, i - start);
+  }
+  munmap(map, st.st_size);
+  return ok;
+}
+
+static double mean(uint64_t sum, uint32_t count) {
+  return count ? (double)sum / count : 0;
+}
+
+static void print_summary(FILE* out, const Stats& s) {
+  double dit = mean(s.dit_sum, s.dits);
+  double dah = mean(s.dah_sum, s.dahs);
+  double denom = s.n * s.sxx - s.sx * s.sx;
+  double drift = (denom > 0) ? 100 * (s.n * s.sxy - s.sx * s.sy) / denom : 0;
+  fprintf(out, "%s\t%u\t%u\t%.1f\t%.1f\t%.2f\t%.1f\t%.1f\t%.2f\t",
+          s.name.c_str(), s.attempts, s.passed, dit, dah,
+          (dit > 0) ? dah / dit : 0, mean(s.gap_sum, s.gaps),
+          mean(s.letter_gap_sum, s.letter_gaps), drift);
+  bool first = true;
+  for (uint8_t c = 0; c < cw::NUM_CHARS; c++) {
+    if (s.asked[c]) {
+      fprintf(out, "%s%c:%u/%u", first ? "" : ",", index_char(c), s.missed[c],
+              s.asked[c]);
+      first = false;
+    }
+  }
+  fprintf(out, "\n");
+}
+
+static void print_hist(FILE* out, const Stats& s) {
+  fprintf(out, "%s\tmark", s.name.c_str());
+  for (int i = 0; i <= HIST_BUCKETS; i++) {
+    fprintf(out, "\t%u", s.mark_hist[i]);
+  }
+  fprintf(out, "\n%s\tspace", s.name.c_str());
+  for (int i = 0; i <= HIST_BUCKETS; i++) {
+    fprintf(out, "\t%u", s.space_hist[i]);
+  }
+  fprintf(out, "\n");
+}
+
+static FILE* open_out(const char* prefix, const char* suffix) {
+  std::string path = std::string(prefix) + suffix;
+  FILE* f = fopen(path.c_str(), "w");
+  if (!f) {
+    perror(path.c_str());
+    exit(1);
+  }
+  return f;
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: timing_stats [-j threads] [-o prefix] file ...\n");
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  unsigned threads = std::thread::hardware_concurrency();
+  const char* prefix = NULL;
+  int opt;
+  while ((opt = getopt(argc, argv, "j:o:")) != -1) {
+    switch (opt) {
+      case 'j':
+        threads = atoi(optarg);
+        break;
+      case 'o':
+        prefix = optarg;
+        break;
+      default:
+        usage();
+    }
+  }
+  int nfiles = argc - optind;
+  if (nfiles <= 0) {
+    usage();
+  }
+  if (threads < 1) {
+    threads = 1;
+  }
+  if (threads > (unsigned)nfiles) {
+    threads = nfiles;
+  }
+
+  // Each file is one Stats, so workers only share the next index.
+  std::vector<Stats> stats(nfiles);
+  std::atomic<int> next(0);
+  auto worker = [&]() {
+    int i;
+    while ((i = next++) < nfiles) {
+      const char* path = argv[optind + i];
+      const char* base = strrchr(path, '/');
+      stats[i].name = base ? base + 1 : path;
+      stats[i].ok = analyze(&stats[i], path);
+    }
+  };
+  std::vector<std::thread> pool;
+  for (unsigned t = 0; t < threads; t++) {
+    pool.emplace_back(worker);
+  }
+  for (auto& t : pool) {
+    t.join();
+  }
+
+  FILE* out = prefix ? open_out(prefix, ".tsv") : stdout;
+  FILE* hist = prefix ? open_out(prefix, "_hist.tsv") : NULL;
+  int status = 0;
+  for (const Stats& s : stats) {
+    if (!s.ok) {
+      status = 1;
+    }
+    print_summary(out, s);
+    if (hist) {
+      print_hist(hist, s);
+    }
+  }
+  if (prefix) {
+    fclose(out);
+    fclose(hist);
+  }
+  return status;
+}
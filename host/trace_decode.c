@@ -0,0 +1,82 @@
+// Decodes trace records sent by a firmware built with -DTRACE into a
+// timeline.
+//
+//   stty -F /dev/ttyUSB0 38400 raw
+//   ./trace_decode < /dev/ttyUSB0
+//
+// Times are in ticks since the first record seen. The state names
+// below follow the enums in state.c, morse.h and key.h.
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "key.h"
+#include "morse.h"
+#include "trace.h"
+
+static const char* MODES[] = {"straight key", "practice"};
+static const char* STRAIGHT_KEY_STATES[] = {"announcing", "ready"};
+static const char* PRACTICE_STATES[] = {
+  "announcing", "sending", "waiting", "?",
+  "receive announcing", "receive listening", "receive waiting",
+  "receive replaying",
+};
+static const char* MORSE_ACTIONS[] = {"none", "hold", "start mark", "start space"};
+static const char* KEY_STATES[] = {"no change", "down", "up", "up long"};
+
+#define NAME(names, v) \
+  (((v) < sizeof(names) / sizeof(names[0])) ? names[v] : "?")
+
+static void print_event(uint8_t type, uint8_t v) {
+  switch (type) {
+    case TRACE_MODE:
+      printf("mode %s\n", NAME(MODES, v));
+      break;
+    case TRACE_STRAIGHT_KEY:
+      printf("straight key %s\n", NAME(STRAIGHT_KEY_STATES, v));
+      break;
+    case TRACE_PRACTICE:
+      printf("practice %s\n", NAME(PRACTICE_STATES, v));
+      break;
+    case TRACE_MORSE:
+      printf("morse %s\n", NAME(MORSE_ACTIONS, v));
+      break;
+    case TRACE_KEY:
+      printf("key %s\n", NAME(KEY_STATES, v));
+      break;
+    case TRACE_GRADE:
+      printf("grade %s after %d retries\n", (v & 1) ? "pass" : "fail", v >> 1);
+      break;
+    case TRACE_OVERFLOW:
+      printf("*** %d%s events lost\n", v, (v == 15) ? "+" : "");
+      break;
+    case TRACE_TIME:
+      break;
+  }
+}
+
+int main(void) {
+  unsigned long now = 0;
+  int c;
+  int event = -1;
+
+  while ((c = getchar()) != EOF) {
+    if (c & 0x80) {
+      // Start of a record.
+      event = c;
+      continue;
+    }
+    if (event < 0) {
+      // Not synchronized yet, or a stray byte.
+      continue;
+    }
+    now += c;
+    if (((event >> 4) & 0x07) != TRACE_TIME) {
+      printf("%8lu ", now);
+      print_event((event >> 4) & 0x07, event & 0x0f);
+      fflush(stdout);
+    }
+    event = -1;
+  }
+  return 0;
+}
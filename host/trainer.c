@@ -0,0 +1,217 @@
+// Runs the trainer in a terminal, with the space bar as the key and
+// the sidetone written to stdout as 16-bit mono PCM.
+//
+//   ./trainer | aplay -q -f S16_LE -r 48000 --buffer-time=10000
+//   ./trainer -w session.wav
+//
+// Options:
+//   -k /dev/input/eventN  read the space bar from an input device,
+//                         for terminals that can't report key releases
+//   -r rate               sample rate, default 48000
+//   -p pitch              sidetone pitch in Hz, default 600
+//   -e file               keep the EEPROM image here between runs
+//
+// Other keys go to the diagnostics shell, whose output appears on
+// stderr. Esc or ctrl-c quits.
+//
+// Ticks are scheduled on the monotonic clock, 1024 a second like the
+// device's, and each one writes its 1/1024s of audio as soon as
+// state_tick() is done. On the way out it reports how long it took
+// from each key press to the write that carried the start of its
+// tone.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hal_key.h"
+#include "journal.h"
+#include "key.h"
+#include "state.h"
+#include "term.h"
+#include "ticks.h"
+#include "tone.h"
+#include "uart.h"
+
+// Ticks are 1/1024s, which isn't a whole number of nanoseconds, so
+// what's left over is carried from one tick to the next.
+#define TICK_NS (1000000000 / 1024)
+#define TICK_NS_REM (1000000000 % 1024)
+
+// Give up on catching up after a stall longer than this.
+#define MAX_LATE_NS (100 * TICK_NS)
+
+// Key to audio latency, in microseconds.
+#define LATENCY_BUCKETS 20
+static unsigned latency_hist[LATENCY_BUCKETS];
+static unsigned latency_count = 0;
+static uint64_t latency_total = 0;
+static uint64_t latency_max = 0;
+
+void ticks_init(void) {
+}
+
+bool ticks_elapsed(void) {
+  return true;
+}
+
+// Ticks run so far.
+static uint16_t tick_count = 0;
+
+uint16_t ticks_now(void) {
+  return tick_count;
+}
+
+// Counts at 8MHz, like TCB0 on the device.
+uint16_t ticks_cycles(void) {
+  return term_now_ns() / 125;
+}
+
+// ticks_cycles() as each tick starts, in place of the PIT interrupt's.
+static uint16_t tick_stamp = 0;
+
+uint16_t ticks_stamp(void) {
+  return tick_stamp;
+}
+
+static void record_latency(uint64_t ns) {
+  uint64_t us = ns / 1000;
+  latency_count++;
+  latency_total += us;
+  if (us > latency_max) {
+    latency_max = us;
+  }
+  unsigned bucket = us / 500;
+  latency_hist[(bucket < LATENCY_BUCKETS) ? bucket : LATENCY_BUCKETS - 1]++;
+}
+
+static void report_latency(void) {
+  if (!latency_count) {
+    return;
+  }
+  fprintf(stderr, "key to audio: %u presses, mean %.2fms, max %.2fms\n",
+          latency_count, latency_total / 1000.0 / latency_count,
+          latency_max / 1000.0);
+  for (int i = 0; i < LATENCY_BUCKETS; i++) {
+    if (latency_hist[i]) {
+      fprintf(stderr, "  under %4.1fms%s %u\n", (i + 1) * 0.5,
+              (i == LATENCY_BUCKETS - 1) ? "+" : " ", latency_hist[i]);
+    }
+  }
+}
+
+static void usage(void) {
+  fprintf(stderr,
+          "usage: trainer [-k input_device] [-r rate] [-p pitch] "
+          "[-e eeprom_file] [-w out.wav]\n");
+  exit(2);
+}
+
+int main(int argc, char** argv) {
+  const char* device = NULL;
+  const char* eeprom_path = NULL;
+  const char* wav_path = NULL;
+  unsigned rate = 48000;
+  unsigned pitch = 600;
+  int opt;
+  while ((opt = getopt(argc, argv, "k:r:p:e:w:")) != -1) {
+    switch (opt) {
+      case 'k':
+        device = optarg;
+        break;
+      case 'r':
+        rate = atoi(optarg);
+        break;
+      case 'p':
+        pitch = atoi(optarg);
+        break;
+      case 'e':
+        eeprom_path = optarg;
+        break;
+      case 'w':
+        wav_path = optarg;
+        break;
+      default:
+        usage();
+    }
+  }
+  if ((optind != argc) || (rate < 8000) || !pitch || (pitch >= rate / 2)) {
+    usage();
+  }
+
+  FILE* out = stdout;
+  if (wav_path) {
+    out = fopen(wav_path, "wb");
+    if (!out) {
+      perror(wav_path);
+      return 1;
+    }
+  } else if (isatty(STDOUT_FILENO)) {
+    fprintf(stderr, "Pipe the audio into a player, or use -w.\n");
+    return 1;
+  }
+
+  if (!term_key_open(device)) {
+    return 1;
+  }
+  term_eeprom_load(eeprom_path);
+  term_tone_open(out, wav_path != NULL, rate, pitch);
+
+  // As in main.c.
+  ticks_init();
+  tone_init();
+  key_init();
+  uart_init();
+  journal_init();
+  state_resume();
+
+  struct timespec next;
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  unsigned next_rem = 0;
+  uint64_t pending_down = 0;
+  while (term_key_poll()) {
+    if (term_key_down_ns) {
+      pending_down = term_key_down_ns;
+      term_key_down_ns = 0;
+    }
+
+    tick_count++;
+    tick_stamp = ticks_cycles();
+    state_tick();
+    if (term_tone_render() && pending_down) {
+      record_latency(term_now_ns() - pending_down);
+      pending_down = 0;
+    } else if (!hal_key_pressed()) {
+      // Released without any tone, as when grading is going on.
+      pending_down = 0;
+    }
+
+    next.tv_nsec += TICK_NS;
+    next_rem += TICK_NS_REM;
+    if (next_rem >= 1024) {
+      next_rem -= 1024;
+      next.tv_nsec++;
+    }
+    if (next.tv_nsec >= 1000000000) {
+      next.tv_nsec -= 1000000000;
+      next.tv_sec++;
+    }
+    uint64_t deadline = (uint64_t)next.tv_sec * 1000000000 + next.tv_nsec;
+    uint64_t now = term_now_ns();
+    if (now > deadline + MAX_LATE_NS) {
+      // We were stopped for a while, don't try to make it up.
+      clock_gettime(CLOCK_MONOTONIC, &next);
+    } else if (now < deadline) {
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+  }
+
+  term_key_close();
+  term_tone_close();
+  term_eeprom_save(eeprom_path);
+  report_latency();
+  return 0;
+}
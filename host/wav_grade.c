@@ -0,0 +1,446 @@
+// Grades recorded sending, such as the audio from a class session,
+// with the same rules the device uses.
+//
+//   ./wav_grade [-g gap_ms] [-j jobs] [-r rate] file.wav ...
+//
+// Files are WAV (8 or 16 bit PCM, the first channel is used) unless
+// -r is given, in which case they're raw signed 16 bit little endian
+// mono at that sample rate. "-" reads from stdin. Each file is
+// handled by its own process, up to -j at a time (default: one per
+// cpu), and is read in small chunks so recordings of any length
+// stream through.
+//
+// The tone is found by a bank of Goertzel filters across a range of
+// pitches, and the loudest one over time is followed. Its level is
+// thresholded into marks and spaces, which go through the decoder
+// from decode.c to work out what was sent. A long enough silence
+// ends a word, which is then graded by capture_match() from
+// capture.c, just as though it had been keyed in. Each word is
+// printed with when it started, and whether it passed.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "capture.h"
+#include "decode.h"
+#include "morse.h"
+#include "ticks.h"
+
+// Candidate pitches, 400Hz to 1150Hz. The count is kept to a multiple
+// of the vector width so the filter loops vectorize cleanly.
+#define NUM_PITCHES 16
+#define MIN_PITCH_HZ 400
+#define PITCH_STEP_HZ 50
+
+// Each filter runs over blocks of this long, which is also the
+// resolution of the timings.
+#define BLOCK_MS 4
+
+// How much louder than the noise floor a mark has to be.
+#define MIN_SNR_DB 15.0f
+
+#define CHUNK_FRAMES 4096
+
+// The device's PIT tick rate, which capture and the decoder count in.
+#define TICK_HZ 1024
+
+// Longest run of timings kept for a word.
+#define WORD_TIMINGS_MAX 64
+
+typedef struct {
+  FILE* f;
+  const char* name;
+  unsigned rate;
+  unsigned channels;
+  unsigned bytes_per_sample;
+  unsigned long remaining;
+} input_t;
+
+// Filter bank state, one lane per pitch.
+static float coeff[NUM_PITCHES];
+static float s1[NUM_PITCHES];
+static float s2[NUM_PITCHES];
+static float energy[NUM_PITCHES];
+
+static unsigned block_samples;
+static unsigned block_pos;
+
+// Level tracking for the pitch being followed, in dB.
+static bool levels_known;
+static float floor_db;
+static float peak_db;
+static bool in_mark;
+
+// Length of the current mark or space, in samples, and where the
+// current word started.
+static unsigned long run_samples;
+static unsigned long now_samples;
+static unsigned long word_start;
+
+static int16_t word[WORD_TIMINGS_MAX];
+static int word_len;
+
+// Silence that ends a word, in ticks. The device waits for
+// capture_timeout(), but -g (in ms) can shorten it for recordings with
+// less of a pause.
+static uint32_t gap_ticks = TIMING_TICKS_MAX;
+
+static unsigned words;
+static unsigned passes;
+
+static uint32_t read_le(const uint8_t* p, int n) {
+  uint32_t v = 0;
+  while (n--) {
+    v = (v << 8) | p[n];
+  }
+  return v;
+}
+
+// Fills in the format from the WAV header, leaving the file at the
+// start of the samples.
+static bool read_wav_header(input_t* in) {
+  uint8_t hdr[12];
+  if ((fread(hdr, 1, 12, in->f) != 12) || memcmp(hdr, "RIFF", 4) ||
+      memcmp(hdr + 8, "WAVE", 4)) {
+    return false;
+  }
+
+  bool have_fmt = false;
+  uint8_t chunk[8];
+  while (fread(chunk, 1, 8, in->f) == 8) {
+    uint32_t len = read_le(chunk + 4, 4);
+    if (!memcmp(chunk, "fmt ", 4)) {
+      uint8_t fmt[16];
+      if ((len < 16) || (fread(fmt, 1, 16, in->f) != 16)) {
+        return false;
+      }
+      if (read_le(fmt, 2) != 1) {
+        // Only plain PCM.
+        return false;
+      }
+      in->channels = read_le(fmt + 2, 2);
+      in->rate = read_le(fmt + 4, 4);
+      in->bytes_per_sample = read_le(fmt + 14, 2) / 8;
+      have_fmt = true;
+      len -= 16;
+    } else if (!memcmp(chunk, "data", 4)) {
+      in->remaining = len;
+      return have_fmt && in->channels && in->rate &&
+        ((in->bytes_per_sample == 1) || (in->bytes_per_sample == 2));
+    }
+    // Chunks are padded to an even length.
+    for (uint32_t i = 0; i < len + (len & 1); i++) {
+      if (getc(in->f) == EOF) {
+        return false;
+      }
+    }
+  }
+  return false;
+}
+
+// Reads the next chunk of samples from the first channel, scaled to
+// +/-1. Returns the number of samples read.
+static size_t read_samples(input_t* in, float* out) {
+  static uint8_t raw[CHUNK_FRAMES * 2 * 8];
+  size_t frame_bytes = in->channels * in->bytes_per_sample;
+  size_t want = CHUNK_FRAMES * frame_bytes;
+  if (want > in->remaining) {
+    want = in->remaining;
+  }
+  size_t got = fread(raw, 1, want, in->f);
+  in->remaining -= got;
+
+  size_t n = got / frame_bytes;
+  for (size_t i = 0; i < n; i++) {
+    const uint8_t* p = raw + i * frame_bytes;
+    if (in->bytes_per_sample == 1) {
+      out[i] = (p[0] - 128) / 128.0f;
+    } else {
+      out[i] = (int16_t)read_le(p, 2) / 32768.0f;
+    }
+  }
+  return n;
+}
+
+static void reset(unsigned rate) {
+  for (int k = 0; k < NUM_PITCHES; k++) {
+    float hz = MIN_PITCH_HZ + k * PITCH_STEP_HZ;
+    coeff[k] = 2.0f * cosf(2.0f * (float)M_PI * hz / rate);
+    s1[k] = s2[k] = energy[k] = 0;
+  }
+  block_samples = rate * BLOCK_MS / 1000;
+  block_pos = 0;
+  levels_known = false;
+  in_mark = false;
+  run_samples = now_samples = word_start = 0;
+  word_len = 0;
+  words = passes = 0;
+  decode_reset();
+}
+
+static char letter(uint8_t encoded) {
+  uint8_t idx = morse_char_idx(encoded);
+  if (idx < 26) {
+    return 'A' + idx;
+  }
+  return (idx < MORSE_NUM_CHARS) ? ('0' + idx - 26) : '?';
+}
+
+// The clock capture reads, which runs through each word a tick at a
+// time as it's replayed.
+static uint16_t replay_ticks = 0;
+
+uint16_t ticks_now(void) {
+  return replay_ticks;
+}
+
+// Replays the word's timings into capture, just as state.c does, and
+// grades it against what was decoded.
+static void grade_word(const char* name, unsigned rate) {
+  capture_reset();
+  for (int i = 0; i < word_len; i++) {
+    int16_t t = word[i];
+    if (t > 0) {
+      capture_push_space();
+      replay_ticks += t;
+      capture_push_mark();
+    } else {
+      replay_ticks -= t;
+    }
+  }
+
+  char text[6];
+  for (uint8_t i = 0; i < morse_buf_len; i++) {
+    text[i] = letter(morse_buf[i]);
+  }
+  text[morse_buf_len] = 0;
+
+  words++;
+  printf("%s: %9.3fs %-5s ", name, (double)word_start / rate, text);
+  if (capture_match()) {
+    passes++;
+    printf("ok\n");
+  } else if (capture_missed_char() < morse_buf_len) {
+    printf("miss at %c\n", text[capture_missed_char()]);
+  } else {
+    printf("miss, extra elements\n");
+  }
+}
+
+// Ends the current mark or space.
+static void push_run(const char* name, unsigned rate) {
+  uint32_t ticks = (uint64_t)run_samples * TICK_HZ / rate;
+  // Capture doesn't bother recording anything longer.
+  int16_t t = (ticks > TIMING_TICKS_MAX) ? TIMING_TICKS_MAX : ticks;
+  if (!in_mark) {
+    t = -t;
+  }
+
+  if (in_mark && !word_len) {
+    word_start = now_samples - run_samples;
+  }
+  if ((in_mark || word_len) && (word_len < WORD_TIMINGS_MAX)) {
+    word[word_len++] = t;
+  }
+  run_samples = 0;
+
+  decode_push(t);
+  if (!in_mark && (ticks >= gap_ticks)) {
+    if (morse_buf_len) {
+      // Capture doesn't record the space after the last mark.
+      if (word[word_len - 1] < 0) {
+        word_len--;
+      }
+      grade_word(name, rate);
+    }
+    word_len = 0;
+    decode_reset();
+  }
+}
+
+// Picks the pitch with the most energy so far, and decides whether
+// this block is a mark.
+static bool detect(float* power) {
+  int best = 0;
+  for (int k = 0; k < NUM_PITCHES; k++) {
+    energy[k] = energy[k] * 0.999f + power[k];
+    if (energy[k] > energy[best]) {
+      best = k;
+    }
+  }
+
+  float level = 10.0f * log10f(power[best] + 1e-12f);
+  if (!levels_known) {
+    floor_db = peak_db = level;
+    levels_known = true;
+  }
+
+  if (level > peak_db) {
+    peak_db = level;
+  } else {
+    // Let the peak fall slowly, about 1dB a second.
+    peak_db -= BLOCK_MS / 1000.0f;
+  }
+
+  bool mark = (peak_db >= floor_db + MIN_SNR_DB) &&
+    (level > (floor_db + peak_db) / 2);
+  if (!mark) {
+    floor_db += (level - floor_db) / 8;
+  }
+  return mark;
+}
+
+// Runs the bank over the samples. Each step updates every pitch at
+// once, which is the loop the compiler vectorizes.
+static void process(const char* name, unsigned rate, const float* x,
+                    size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    for (int k = 0; k < NUM_PITCHES; k++) {
+      float s0 = x[i] + coeff[k] * s1[k] - s2[k];
+      s2[k] = s1[k];
+      s1[k] = s0;
+    }
+    now_samples++;
+    run_samples++;
+    if (++block_pos < block_samples) {
+      continue;
+    }
+
+    float power[NUM_PITCHES];
+    for (int k = 0; k < NUM_PITCHES; k++) {
+      power[k] = s1[k] * s1[k] + s2[k] * s2[k] - coeff[k] * s1[k] * s2[k];
+      s1[k] = s2[k] = 0;
+    }
+    block_pos = 0;
+
+    bool mark = detect(power);
+    if (mark != in_mark) {
+      // The run started a block ago.
+      run_samples -= block_samples;
+      push_run(name, rate);
+      run_samples = block_samples;
+      in_mark = mark;
+    }
+  }
+}
+
+static int grade_file(const char* name, unsigned raw_rate) {
+  input_t in = {0};
+  in.name = name;
+  in.f = strcmp(name, "-") ? fopen(name, "rb") : stdin;
+  if (!in.f) {
+    perror(name);
+    return 1;
+  }
+
+  if (raw_rate) {
+    in.rate = raw_rate;
+    in.channels = 1;
+    in.bytes_per_sample = 2;
+    in.remaining = (unsigned long)-1;
+  } else if (!read_wav_header(&in)) {
+    fprintf(stderr, "%s: not a PCM wav file\n", name);
+    return 1;
+  }
+  if (in.channels > 8) {
+    fprintf(stderr, "%s: too many channels\n", name);
+    return 1;
+  }
+
+  reset(in.rate);
+  static float samples[CHUNK_FRAMES];
+  size_t n;
+  while ((n = read_samples(&in, samples)) > 0) {
+    process(name, in.rate, samples, n);
+  }
+  // Finish off with a word gap.
+  if (in_mark) {
+    push_run(name, in.rate);
+    in_mark = false;
+  }
+  run_samples += (uint64_t)in.rate * gap_ticks / TICK_HZ;
+  push_run(name, in.rate);
+
+  int best = 0;
+  for (int k = 0; k < NUM_PITCHES; k++) {
+    if (energy[k] > energy[best]) {
+      best = k;
+    }
+  }
+  printf("%s: %u of %u words ok, pitch %dHz\n", name, passes, words,
+         MIN_PITCH_HZ + best * PITCH_STEP_HZ);
+  if (in.f != stdin) {
+    fclose(in.f);
+  }
+  return 0;
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: wav_grade [-g gap_ms] [-j jobs] [-r rate] file.wav ...\n");
+  exit(2);
+}
+
+int main(int argc, char** argv) {
+  long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+  unsigned raw_rate = 0;
+  int opt;
+  while ((opt = getopt(argc, argv, "g:j:r:")) != -1) {
+    switch (opt) {
+      case 'g':
+        gap_ticks = (uint32_t)atoi(optarg) * TICK_HZ / 1000;
+        break;
+      case 'j':
+        jobs = atoi(optarg);
+        break;
+      case 'r':
+        raw_rate = atoi(optarg);
+        break;
+      default:
+        usage();
+    }
+  }
+  if ((optind >= argc) || (jobs < 1)) {
+    usage();
+  }
+
+  if (argc - optind == 1) {
+    return grade_file(argv[optind], raw_rate);
+  }
+
+  // The decoder and capture keep their state in globals, so each
+  // file gets its own process. Output is line buffered so lines
+  // from different files don't get mixed up.
+  int status = 0;
+  long running = 0;
+  for (int i = optind; i < argc; i++) {
+    if (running >= jobs) {
+      int s;
+      wait(&s);
+      status |= !WIFEXITED(s) || WEXITSTATUS(s);
+      running--;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+      perror("fork");
+      return 1;
+    }
+    if (pid == 0) {
+      setvbuf(stdout, NULL, _IOLBF, 0);
+      exit(grade_file(argv[i], raw_rate));
+    }
+    running++;
+  }
+  while (running--) {
+    int s;
+    wait(&s);
+    status |= !WIFEXITED(s) || WEXITSTATUS(s);
+  }
+  return status;
+}
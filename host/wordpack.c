@@ -0,0 +1,176 @@
+// Packs a word list into the tables in src/wordlist.h, for practice
+// with real words (-DDICTIONARY).
+//
+//   ./wordpack < words.txt > ../src/wordlist.h
+//
+// Words of 2 to 5 letters are kept, others (and lines starting with
+// '#') are skipped. The words are grouped by length and sorted, and
+// each is front-coded against the one before it: a 3-bit count of
+// letters shared with the previous word, then the rest of its letters
+// at 5 bits each, all packed LSB first.
+//
+// Every WORDLIST_RESTART'th word in a group shares nothing with the
+// previous one, and its bit offset goes into an index. So the device
+// can pick any word by decoding at most WORDLIST_RESTART words from
+// the nearest restart.
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_LEN 2
+#define MAX_LEN 5
+#define NUM_LENS (MAX_LEN - MIN_LEN + 1)
+#define MAX_WORDS 4096
+#define RESTART 16
+
+#define PREFIX_BITS 3
+#define LETTER_BITS 5
+
+static char words[MAX_WORDS][MAX_LEN + 1];
+static int nwords = 0;
+
+static uint8_t bits[MAX_WORDS * 4];
+static int nbits = 0;
+
+static uint16_t counts[NUM_LENS];
+static uint16_t index_bits[MAX_WORDS / RESTART + NUM_LENS];
+static int nindex = 0;
+static uint8_t first_restart[NUM_LENS];
+
+static int compare(const void* a, const void* b) {
+  const char* x = a;
+  const char* y = b;
+  size_t lx = strlen(x);
+  size_t ly = strlen(y);
+  if (lx != ly) {
+    return (int)lx - (int)ly;
+  }
+  return strcmp(x, y);
+}
+
+static void put_bits(unsigned v, int n) {
+  for (int i = 0; i < n; i++) {
+    if (v & (1 << i)) {
+      bits[nbits / 8] |= 1 << (nbits % 8);
+    }
+    nbits++;
+  }
+}
+
+static void read_words(void) {
+  char line[256];
+  while (fgets(line, sizeof(line), stdin)) {
+    if (line[0] == '#') {
+      continue;
+    }
+    char word[MAX_LEN + 1];
+    int len = 0;
+    char* p = line;
+    while (isalpha((unsigned char)*p)) {
+      if (len <= MAX_LEN) {
+        word[len] = toupper((unsigned char)*p);
+      }
+      len++;
+      p++;
+    }
+    if ((len < MIN_LEN) || (len > MAX_LEN) ||
+        (*p && !isspace((unsigned char)*p))) {
+      continue;
+    }
+    word[len] = 0;
+    if (nwords >= MAX_WORDS) {
+      fprintf(stderr, "too many words\n");
+      exit(1);
+    }
+    strcpy(words[nwords++], word);
+  }
+}
+
+int main(void) {
+  read_words();
+  qsort(words, nwords, sizeof(words[0]), compare);
+
+  const char* prev = "";
+  int in_group = 0;
+  int group = -1;
+  for (int i = 0; i < nwords; i++) {
+    if ((i > 0) && !strcmp(words[i], words[i - 1])) {
+      continue;
+    }
+    int len = strlen(words[i]);
+    if (len - MIN_LEN != group) {
+      // Skipped lengths get an empty group.
+      while (group < len - MIN_LEN) {
+        group++;
+        first_restart[group] = nindex;
+      }
+      in_group = 0;
+    }
+
+    int shared = 0;
+    if (in_group % RESTART == 0) {
+      index_bits[nindex++] = nbits;
+    } else {
+      while ((shared < len - 1) && (prev[shared] == words[i][shared])) {
+        shared++;
+      }
+    }
+    put_bits(shared, PREFIX_BITS);
+    for (int j = shared; j < len; j++) {
+      put_bits(words[i][j] - 'A', LETTER_BITS);
+    }
+    counts[group]++;
+    in_group++;
+    prev = words[i];
+  }
+  while (group < NUM_LENS - 1) {
+    group++;
+    first_restart[group] = nindex;
+  }
+  if (nbits > 0xffff) {
+    fprintf(stderr, "word list too big\n");
+    return 1;
+  }
+
+  int nbytes = (nbits + 7) / 8;
+  printf("#pragma once\n\n");
+  printf("// Generated by host/wordpack, see there for the format. %d words\n",
+         counts[0] + counts[1] + counts[2] + counts[3]);
+  printf("// in %d bytes.\n\n", nbytes + 2 * nindex + 2 * NUM_LENS + NUM_LENS + 1);
+  printf("#include <stdint.h>\n\n");
+  printf("#define WORDLIST_RESTART %d\n", RESTART);
+  printf("#define WORDLIST_PREFIX_BITS %d\n", PREFIX_BITS);
+  printf("#define WORDLIST_LETTER_BITS %d\n\n", LETTER_BITS);
+
+  // One spare byte, as bits are read two bytes at a time.
+  printf("static const uint8_t WORDLIST_BITS[%d] = {", nbytes + 1);
+  for (int i = 0; i < nbytes + 1; i++) {
+    printf("%s0x%02x,", (i % 12) ? " " : "\n  ", bits[i]);
+  }
+  printf("\n};\n\n");
+
+  printf("// Words of each length, from %d letters up.\n", MIN_LEN);
+  printf("static const uint16_t WORDLIST_COUNT[%d] = {", NUM_LENS);
+  for (int i = 0; i < NUM_LENS; i++) {
+    printf("%s%d", i ? ", " : "", counts[i]);
+  }
+  printf("};\n\n");
+
+  printf("// Where each length's restarts begin in WORDLIST_INDEX.\n");
+  printf("static const uint8_t WORDLIST_FIRST[%d] = {", NUM_LENS);
+  for (int i = 0; i < NUM_LENS; i++) {
+    printf("%s%d", i ? ", " : "", first_restart[i]);
+  }
+  printf("};\n\n");
+
+  printf("// Bit offset of every WORDLIST_RESTART'th word.\n");
+  printf("static const uint16_t WORDLIST_INDEX[%d] = {", nindex);
+  for (int i = 0; i < nindex; i++) {
+    printf("%s%d,", (i % 8) ? " " : "\n  ", index_bits[i]);
+  }
+  printf("\n};\n");
+  return 0;
+}
@@ -0,0 +1,88 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "calib.h"
+
+// Ticks measured each time. TCB0 counts at 16MHz / 2, so that's 31250
+// counts at the nominal rate, which still fits in 16 bits with the PIT
+// running at half its rate, well past SCALE_MIN.
+#define CALIB_TICKS 4
+
+// PIT ticks per nominal tick is 4096 * (1/1024s) / (cycles /
+// CALIB_TICKS / (8MHz * (1024 + osc_err) / 1024)), which comes to
+// CALIB_NUM * (1024 + osc_err) / cycles.
+#define CALIB_NUM (8000000UL / 256 * CALIB_TICKS)
+
+// Measurements further out than this are taken to be wrong.
+#define SCALE_MIN 3072
+#define SCALE_MAX 5120
+
+#define CALIB_IDLE 0
+// Waiting for a tick to start from.
+#define CALIB_STARTING 1
+#define CALIB_MEASURING 2
+
+// PIT ticks per nominal tick, in 1/4096ths.
+static uint16_t scale = 4096;
+
+static int8_t osc_err = 0;
+
+static uint8_t state = CALIB_IDLE;
+
+// The TCB0 count and the low byte of RTC.CNT on the tick the
+// measurement started from.
+static uint16_t start_stamp = 0;
+static uint8_t start_tick = 0;
+
+void calib_init(int8_t err) {
+  osc_err = err;
+  calib_begin();
+}
+
+void calib_begin(void) {
+  state = CALIB_STARTING;
+}
+
+bool calib_active(void) {
+  return state != CALIB_IDLE;
+}
+
+static void finish(uint16_t cycles) {
+  state = CALIB_IDLE;
+  uint32_t s = CALIB_NUM * (uint32_t)(1024 + osc_err) / cycles;
+  if ((s >= SCALE_MIN) && (s <= SCALE_MAX)) {
+    scale = s;
+  }
+}
+
+void calib_tick(uint16_t stamp, uint16_t now) {
+  if (state == CALIB_IDLE) {
+    // Measure again every 64s or so, whenever RTC.CNT wraps around.
+    if (now) {
+      return;
+    }
+    state = CALIB_STARTING;
+  }
+  uint8_t elapsed = (uint8_t)now - start_tick;
+  if ((state == CALIB_MEASURING) && (elapsed == CALIB_TICKS)) {
+    finish(stamp - start_stamp);
+    return;
+  }
+  if ((state == CALIB_STARTING) || (elapsed > CALIB_TICKS)) {
+    // Start over from here, including after the last tick of a
+    // measurement went by unseen. Any before that are fine, as
+    // RTC.CNT counts them anyway.
+    state = CALIB_MEASURING;
+    start_stamp = stamp;
+    start_tick = now;
+  }
+}
+
+uint16_t calib_ticks(uint16_t nominal) {
+  return ((uint32_t)nominal * scale + 2048) >> 12;
+}
+
+uint16_t calib_nominal(uint16_t ticks) {
+  uint32_t nominal = (((uint32_t)ticks << 12) + scale / 2) / scale;
+  return (nominal > 0xffff) ? 0xffff : nominal;
+}
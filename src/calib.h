@@ -0,0 +1,37 @@
+#pragma once
+
+// Ticks come from the PIT, which runs off the ULP 32k oscillator. That
+// can be 10-20% off over temperature and supply, and everything timed
+// in ticks would be off with it. So the PIT is measured against the
+// main clock, through the TCB0 count taken in its interrupt, at power
+// up and then every 64s or so, whenever RTC.CNT wraps around. RTC.CNT
+// also tells how many PIT ticks a measurement spans, so a tick the
+// main loop missed along the way doesn't throw it off. The main
+// clock's own error, as measured in production, is taken out too,
+// which leaves its drift since then, well under 1% at room
+// temperature.
+//
+// Times are worked out in nominal ticks of 1/1024s, and calib_ticks()
+// turns them into PIT ticks to count, while calib_nominal() turns a
+// count of PIT ticks back into nominal ones.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Takes the main clock's error at 3V from the signature row, in
+// 1/1024ths, and starts measuring.
+void calib_init(int8_t osc_err);
+
+// Measures again from the next tick, eg: after the PIT has stopped.
+void calib_begin(void);
+
+// Called on each tick with the TCB0 count from the PIT interrupt, and
+// ticks_now().
+void calib_tick(uint16_t stamp, uint16_t now);
+
+// While measuring, TCB0 has to keep counting, so the main clock has
+// to stay on.
+bool calib_active(void);
+
+uint16_t calib_ticks(uint16_t nominal);
+uint16_t calib_nominal(uint16_t ticks);
@@ -1,29 +1,46 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "calib.h"
 #include "capture.h"
 #include "morse.h"
+#include "ticks.h"
 
-#define TIMING_BUF_MAX 50
-
-// Only bother to record times up to this many ticks.
-#define TIMING_TICKS_MAX 2000
+// Timings are graded as they come in, so only those not checked yet
+// need keeping. Must be a power of two.
+#define TIMING_BUF_MAX 8
 
 // We allow a slop for mark and space timings within
 // characters of this many ticks.
 #define ELEMENT_SLOP_TICKS 50
 
-// Captured mark/space timings in ticks.
+// Captured mark/space timings in nominal ticks, whatever the PIT's
+// actual rate, indexed by their position in the whole capture masked
+// to the buffer.
 // Negative values are spaces, positive values
 // are marks.
-static int16_t timing[TIMING_BUF_MAX] = {0};
+static int16_t timing[TIMING_BUF_MAX];
 
-// length of captured timings.
+// How many timings have been captured in all, saturating at 0xff.
 static uint8_t timing_len = 0;
 
 // are we accumulating a mark?
 bool in_mark = false;
 
+// When the current mark or space started.
+static uint16_t edge_ticks = 0;
+
+// Where the last capture_match() went wrong.
+static uint8_t missed_char = 0;
+
+// How far grading has got: the character in morse_buf[], how many of
+// its elements are left (0 if it hasn't been started), and the next
+// timing to check.
+static uint8_t match_char = 0;
+static uint8_t match_elements = 0;
+static uint8_t match_idx = 0;
+static bool match_failed = false;
+
 static bool is_close(uint16_t actual, bool is_dah) {
   // For a dit:
   // Anything that's at least DIT_TICKS // 2 and not more
@@ -38,104 +55,146 @@ static bool is_close(uint16_t actual, bool is_dah) {
   return ((actual >= (DIT_TICKS / 2)) && (actual <= ((DIT_TICKS * 3) / 2)));
 }
 
-void capture_reset(void) {
-  timing_len = 0;
-  for (int i = 0; i < TIMING_BUF_MAX; i++) {
-    timing[i] = 0;
-  }
-  in_mark = false;
+// Nominal ticks since the current mark or space started, up to
+// TIMING_TICKS_MAX. Also starts the next one.
+static uint16_t take_elapsed(void) {
+  uint16_t now = ticks_now();
+  uint16_t elapsed = calib_nominal(now - edge_ticks);
+  edge_ticks = now;
+  return (elapsed < TIMING_TICKS_MAX) ? elapsed : TIMING_TICKS_MAX;
 }
 
-void capture_increment(void) {
-  if (timing[timing_len] < TIMING_TICKS_MAX) {
-    timing[timing_len]++;
+static void push_timing(int16_t t) {
+  // Make room by grading what's in, if none of it has been yet.
+  while (((uint8_t)(timing_len - match_idx) >= TIMING_BUF_MAX) &&
+         !capture_match_step()) {
+  }
+  // Still no room means grading is done with, so the timing is only
+  // counted.
+  if ((uint8_t)(timing_len - match_idx) < TIMING_BUF_MAX) {
+    timing[timing_len & (TIMING_BUF_MAX - 1)] = t;
+  }
+  if (timing_len < 0xff) {
+    timing_len++;
   }
 }
 
+void capture_reset(void) {
+  // Timings are written as they're pushed, so there's nothing to
+  // clear.
+  timing_len = 0;
+  in_mark = false;
+  edge_ticks = ticks_now();
+  match_char = 0;
+  match_elements = 0;
+  match_idx = 0;
+  match_failed = false;
+}
+
 void capture_push_mark(void) {
-  if (timing_len < TIMING_BUF_MAX) {
-    timing_len++;
-  }
+  push_timing(take_elapsed());
   // Having pushed a mark, we're now capturing a space.
   in_mark = false;
 }
 
 void capture_push_space(void) {
-  if (timing_len == 0) {
-    // Skip capturing the space if that's the first timing we have. We
-    // can't really make use of it. But make sure we reset the tick
-    // counter for the upcoming mark.
-    timing[0] = 0;
-  } else if (timing_len < TIMING_BUF_MAX) {
+  uint16_t elapsed = take_elapsed();
+  // Skip capturing the space if that's the first timing we have. We
+  // can't really make use of it.
+  if (timing_len > 0) {
     // Record it as a space.
-    timing[timing_len] = -timing[timing_len];
-    timing_len++;
+    push_timing(-elapsed);
   }
   // Having pushed a space, we're now capturing a mark.
   in_mark = true;
 }
 
 bool capture_timeout(void) {
-  return (!in_mark && timing[timing_len] >= TIMING_TICKS_MAX);
+  return !in_mark &&
+    (calib_nominal(ticks_now() - edge_ticks) >= TIMING_TICKS_MAX);
 }
 
-bool capture_match(void) {
-  // Current position in the timing[] array.
-  uint8_t timing_idx = 0;
-
-  // Step through morse buffer.
-  for (uint8_t i = 0; i < morse_buf_len; i++) {
-    uint8_t morse_encoded = morse_buf[i];
-    uint8_t start_bit_pos = morse_num_elements(morse_encoded);
-    for (int8_t pos = start_bit_pos - 1; pos >= 0; pos--) {
-      // Did we run out of timing elements too soon?
-      if (timing_idx >= timing_len) {
-        return false;
-      }
+uint8_t capture_missed_char(void) {
+  return missed_char;
+}
 
-      // Verify mark duration.
-      bool is_dah = morse_is_dah(morse_encoded, pos);
-      if (!is_close(timing[timing_idx], is_dah)) {
-        // Mark duration failed.
-        return false;
-      }
+// Checks the next element of morse_buf[] against what's been
+// captured, if its mark (and the space after it, unless it's the very
+// last element) are in yet.
+bool capture_match_step(void) {
+  if (match_failed || (match_char >= morse_buf_len)) {
+    return true;
+  }
+  uint8_t morse_encoded = morse_buf[match_char];
+  if (!match_elements) {
+    match_elements = morse_num_elements(morse_encoded);
+  }
+  int8_t pos = match_elements - 1;
+  bool is_last_element = (pos == 0);
+  bool is_last_char_element = (match_char == (morse_buf_len - 1));
+  // We don't record the final char's last space.
+  uint8_t needed = (is_last_element && is_last_char_element) ? 1 : 2;
+  if (match_idx + needed > timing_len) {
+    // Wait for more.
+    return true;
+  }
 
-      // Verify space duration.
-      bool is_last_element = (pos == 0);
-      bool is_last_char_element = (i == (morse_buf_len - 1));
-      if (is_last_element && is_last_char_element) {
-        // We don't record the final char's last space, so
-        // just increment and move on.
-        timing_idx++;
-        continue;
-      }
+  // Any failure from here on is blamed on this character.
+  missed_char = match_char;
 
-      // Check the key-up duration.
-      timing_idx++;
-      if (timing_idx >= timing_len) {
-        // Stopped too soon.
-        return false;
-      }
+  // Verify mark duration.
+  bool is_dah = morse_is_dah(morse_encoded, pos);
+  if (!is_close(timing[match_idx & (TIMING_BUF_MAX - 1)], is_dah)) {
+    // Mark duration failed.
+    match_failed = true;
+    return true;
+  }
 
-      // note that spaces are stored as negative.
-      uint16_t actual = -timing[timing_idx];
-      // We'll be flexible about inter letter space, just requiring
-      // that we have at least 4 dits overall.
-      if (is_last_element) {
-        if (actual < 4 * DIT_TICKS - ELEMENT_SLOP_TICKS) {
-          return false;
-        }
-      } else {
-        if (!is_close(actual, /* is_dah */ false)) {
-          return false;
-        }
+  if (needed == 2) {
+    // Check the key-up duration. Note that spaces are stored as
+    // negative.
+    uint16_t actual = -timing[(match_idx + 1) & (TIMING_BUF_MAX - 1)];
+    // We'll be flexible about inter letter space, just requiring
+    // that we have at least 4 dits overall.
+    if (is_last_element) {
+      if (actual < 4 * DIT_TICKS - ELEMENT_SLOP_TICKS) {
+        match_failed = true;
+        return true;
       }
-      // Move on to the next timing element.
-      timing_idx++;
+    } else if (!is_close(actual, /* is_dah */ false)) {
+      match_failed = true;
+      return true;
     }
   }
 
+  // Move on to the next timing element.
+  match_idx += needed;
+  if (!--match_elements) {
+    match_char++;
+  }
+  return false;
+}
+
+bool capture_match(void) {
+  if ((timing_len == 0) && (morse_buf_len > 0)) {
+    missed_char = CAPTURE_MISS_EMPTY;
+    return false;
+  }
+
+  // Catch up on whatever hasn't been checked yet.
+  while (!capture_match_step()) {
+  }
+  if (match_failed) {
+    return false;
+  }
+  if (match_char < morse_buf_len) {
+    // Ran out of timing elements too soon.
+    missed_char = match_char;
+    return false;
+  }
+
   // After checking all characters, we should have consumed all timing
   // entries. Otherwise, the user sent too many elements.
-  return (timing_idx == timing_len);
+  missed_char = morse_buf_len;
+  return (match_idx == timing_len);
 }
@@ -1,16 +1,38 @@
 #pragma once
 
-// This library records (up to 50) "ticks" counts representing marks
-// and spaces sent by the user.
+// This library records "ticks" counts representing marks and spaces
+// sent by the user.
+//
+// Each push works out how long the mark or space it ends lasted from
+// ticks_now(), so nothing needs doing between key edges. The counts
+// are nominal ticks, corrected by calib_nominal().
 //
 // It can further grade the recorded sequence against an expected
-// morse code sequence.
+// morse code sequence. Only the last few counts that haven't been
+// graded yet are kept, so a push grades some first if it has to.
+// After a failed match, capture_missed_char() returns the index in
+// morse_buf[] of the first character that didn't match, morse_buf_len
+// if extra elements were sent, or CAPTURE_MISS_EMPTY if nothing was
+// sent at all.
 
 #include <stdbool.h>
+#include <stdint.h>
+
+#define CAPTURE_MISS_EMPTY 0xff
+
+// Only bother to record times up to this many ticks.
+#define TIMING_TICKS_MAX 2000
 
 void capture_reset(void);
-void capture_increment(void);
 void capture_push_mark(void);
 void capture_push_space(void);
 bool capture_match(void);
+
+// Grades a bit more of what's been captured so far, returning true
+// once it's caught up (or found a mismatch). capture_match() does
+// whatever's left, so calling this on quiet ticks just makes that
+// quicker. morse_buf[] has to be complete before this is first
+// called, and stay put until capture_match().
+bool capture_match_step(void);
+uint8_t capture_missed_char(void);
 bool capture_timeout(void);
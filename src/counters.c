@@ -0,0 +1,98 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "counters.h"
+#include "ticks.h"
+
+#define TICKS_PER_SECOND 1024
+
+uint16_t counters[NUM_COUNTERS] = {0};
+
+// Wakeups and ticks so far in the current second.
+static uint16_t wakeups = 0;
+static uint16_t second_ticks = 0;
+
+// Ticks since playback finished, while waiting for a key down.
+static uint16_t attempt_ticks = 0;
+static bool attempt_pending = false;
+
+static void saturating_add(counter_t counter, uint16_t n) {
+  uint16_t v = counters[counter] + n;
+  counters[counter] = (v < n) ? 0xffff : v;
+}
+
+void counters_reset(void) {
+  for (uint8_t i = 0; i < NUM_COUNTERS; i++) {
+    counters[i] = 0;
+  }
+}
+
+void counters_inc(counter_t counter) {
+  saturating_add(counter, 1);
+}
+
+void counters_wakeup(void) {
+  if (wakeups < 0xffff) {
+    wakeups++;
+  }
+}
+
+void counters_tick_begin(void) {
+  second_ticks++;
+  if (second_ticks >= TICKS_PER_SECOND) {
+    counters[COUNTER_WAKEUPS] = wakeups;
+    wakeups = 0;
+    second_ticks = 0;
+  }
+
+  if (attempt_pending && (attempt_ticks < 0xffff)) {
+    attempt_ticks++;
+  }
+}
+
+bool counters_second(void) {
+  return second_ticks == 0;
+}
+
+void counters_tick_end(void) {
+  // From the PIT interrupt that started the tick, which takes in
+  // waking up as well.
+  uint16_t duration = ticks_cycles() - ticks_stamp();
+  if (duration > counters[COUNTER_TICK_MAX]) {
+    counters[COUNTER_TICK_MAX] = duration;
+  }
+  // The cycle counter wraps after about 8 ticks, so this undercounts
+  // really long stalls. We'd have bigger problems by then.
+  if (duration >= COUNTER_TICK_CYCLES) {
+    saturating_add(COUNTER_MISSED_TICKS, duration / COUNTER_TICK_CYCLES);
+  }
+}
+
+void counters_attempt_begin(void) {
+  attempt_ticks = 0;
+  attempt_pending = true;
+}
+
+void counters_attempt_keyed(void) {
+  if (!attempt_pending) {
+    return;
+  }
+  attempt_pending = false;
+
+  // Keep a moving average over roughly the last 8 attempts.
+  uint16_t avg = counters[COUNTER_LATENCY];
+  if (avg == 0) {
+    avg = attempt_ticks;
+  } else {
+    avg = (uint16_t)(((uint32_t)avg * 7 + attempt_ticks) / 8);
+  }
+  counters[COUNTER_LATENCY] = avg;
+}
+
+void counters_attempt_graded(bool passed) {
+  attempt_pending = false;
+  counters_inc(COUNTER_ATTEMPTS);
+  if (passed) {
+    counters_inc(COUNTER_PASSES);
+  }
+}
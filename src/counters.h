@@ -0,0 +1,50 @@
+#pragma once
+
+// Saturating 16-bit counters to keep an eye on how the device is
+// doing while it runs. They can be read out through the shell.
+//
+// Tick durations are measured in units of 2 main clock cycles, so a
+// tick that runs past the next PIT interrupt takes about
+// COUNTER_TICK_CYCLES.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum _counter_t {
+  // Wakeups during the last second.
+  COUNTER_WAKEUPS,
+  // Longest tick.
+  COUNTER_TICK_MAX,
+  // Ticks lost to overrunning ticks.
+  COUNTER_MISSED_TICKS,
+  // Key contact changes while the key was settling.
+  COUNTER_KEY_BOUNCES,
+  // Graded attempts, and how many of those passed.
+  COUNTER_ATTEMPTS,
+  COUNTER_PASSES,
+  // Average ticks from the end of playback to the first key down.
+  COUNTER_LATENCY,
+  // Longest sidetone sample interrupt, in the same units as
+  // COUNTER_TICK_MAX.
+  COUNTER_TONE_ISR,
+  // Bytes of RAM the stack has never reached, as of the last print.
+  COUNTER_STACK_FREE,
+  NUM_COUNTERS,
+} counter_t;
+
+// 16MHz / 2 / 1024Hz
+#define COUNTER_TICK_CYCLES 7812
+
+extern uint16_t counters[];
+
+void counters_reset(void);
+void counters_inc(counter_t counter);
+void counters_wakeup(void);
+void counters_tick_begin(void);
+// Whether the tick just begun starts a new second. This is the one
+// count of seconds the rest of the firmware times itself by.
+bool counters_second(void);
+void counters_tick_end(void);
+void counters_attempt_begin(void);
+void counters_attempt_keyed(void);
+void counters_attempt_graded(bool passed);
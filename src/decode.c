@@ -0,0 +1,64 @@
+#ifdef RECEIVE
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "decode.h"
+#include "morse.h"
+
+// Elements in the character so far, with a leading 1 just as in the
+// morse encoding. 0 if we're between characters.
+static uint8_t letter = 0;
+
+// Current estimate of the dit length.
+static uint16_t dit_ticks = DIT_TICKS;
+
+static void end_letter(void) {
+  // Keep only characters we know, and don't overflow the buffer.
+  if (letter && (morse_char_idx(letter) < MORSE_NUM_CHARS) &&
+      (morse_buf_len < 5)) {
+    morse_buf[morse_buf_len++] = letter;
+  }
+  letter = 0;
+}
+
+void decode_reset(void) {
+  morse_reset();
+  letter = 0;
+  dit_ticks = DIT_TICKS;
+}
+
+bool decode_push(int16_t timing) {
+  if (timing > 0) {
+    uint16_t mark = timing;
+    bool is_dah = (mark >= 2 * dit_ticks);
+
+    // Move a quarter of the way towards the dit length implied by
+    // this mark.
+    uint16_t implied = is_dah ? (mark / 3) : mark;
+    dit_ticks = (3 * dit_ticks + implied) / 4;
+
+    if (!letter) {
+      letter = 1;
+    }
+    if (letter & 0x80) {
+      // Too many elements for any character, drop it.
+      letter = 0xff;
+    } else {
+      letter = (letter << 1) | is_dah;
+    }
+    return false;
+  }
+
+  uint16_t space = -timing;
+  if (space < 2 * dit_ticks) {
+    // Between elements.
+    return false;
+  }
+
+  end_letter();
+  // A word gap is 7 dits, split the difference with a letter gap.
+  return (space >= 5 * dit_ticks) && (morse_buf_len > 0);
+}
+
+#endif
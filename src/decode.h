@@ -0,0 +1,18 @@
+#pragma once
+
+// This library turns mark/space timings, in ticks and in the same
+// form that capture records them (positive marks, negative spaces),
+// into characters in morse_buf[].
+//
+// The dit length is tracked from the marks as they arrive, starting
+// from DIT_TICKS, so moderate speed differences are handled.
+//
+// decode_push() returns true once a word gap follows at least one
+// character. morse_buf[] then holds the word (up to its first 5
+// characters), ready to be played back with morse_rewind().
+
+#include <stdbool.h>
+#include <stdint.h>
+
+void decode_reset(void);
+bool decode_push(int16_t timing);
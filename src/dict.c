@@ -0,0 +1,47 @@
+#ifdef DICTIONARY
+
+#include <stdint.h>
+
+#include "dict.h"
+#include "morse.h"
+#include "wordlist.h"
+
+#ifdef WORDS
+#error "Pick one of -DWORDS and -DDICTIONARY"
+#endif
+
+// Position of the next bit to read.
+static uint16_t bit_pos = 0;
+
+static uint8_t read_bits(uint8_t n) {
+  const uint8_t* p = WORDLIST_BITS + (bit_pos >> 3);
+  uint16_t window = p[0] | (p[1] << 8);
+  uint8_t v = (window >> (bit_pos & 7)) & ((1 << n) - 1);
+  bit_pos += n;
+  return v;
+}
+
+void dict_generate(uint8_t nchars) {
+  morse_random_clear();
+
+  uint8_t group = nchars - 2;
+  if ((nchars < 2) || (group >= sizeof(WORDLIST_COUNT) / sizeof(uint16_t)) ||
+      !WORDLIST_COUNT[group]) {
+    return;
+  }
+
+  uint16_t word = morse_random() % WORDLIST_COUNT[group];
+  uint16_t restart = word / WORDLIST_RESTART;
+  bit_pos = WORDLIST_INDEX[WORDLIST_FIRST[group] + restart];
+
+  // Each word keeps the start of the one before, so decode every word
+  // from the restart up to the one we want.
+  for (uint8_t i = word % WORDLIST_RESTART + 1; i; i--) {
+    for (uint8_t j = read_bits(WORDLIST_PREFIX_BITS); j < nchars; j++) {
+      morse_buf[j] = morse_encoding(read_bits(WORDLIST_LETTER_BITS));
+    }
+  }
+  morse_buf_len = nchars;
+}
+
+#endif
@@ -0,0 +1,16 @@
+#pragma once
+
+// This library picks practice words from a word list packed into
+// flash (see host/wordpack.c for the format). Build with -DDICTIONARY
+// to practice with these in place of random letter groups.
+//
+// dict_generate() fills the buffer in place of morse_random_step(),
+// during the word space morse_random_begin() started. It picks a
+// random word of exactly nchars letters, and decodes it straight into
+// morse_buf[]. Decoding starts from the nearest restart point in the
+// index, so it takes at most WORDLIST_RESTART words' worth of work,
+// and needs no RAM beyond a bit position and morse_buf[] itself.
+
+#include <stdint.h>
+
+void dict_generate(uint8_t nchars);
@@ -0,0 +1,43 @@
+#pragma once
+
+// Morse encodings for A-Z and then 0-9, in the form described in
+// morse.c. It's a bare list so that host tools can build their own
+// tables from it as well.
+
+#define MORSE_ENCODING \
+  0b00000101, /* A */ \
+  0b00011000, /* B */ \
+  0b00011010, /* C */ \
+  0b00001100, /* D */ \
+  0b00000010, /* E */ \
+  0b00010010, /* F */ \
+  0b00001110, /* G */ \
+  0b00010000, /* H */ \
+  0b00000100, /* I */ \
+  0b00010111, /* J */ \
+  0b00001101, /* K */ \
+  0b00010100, /* L */ \
+  0b00000111, /* M */ \
+  0b00000110, /* N */ \
+  0b00001111, /* O */ \
+  0b00010110, /* P */ \
+  0b00011101, /* Q */ \
+  0b00001010, /* R */ \
+  0b00001000, /* S */ \
+  0b00000011, /* T */ \
+  0b00001001, /* U */ \
+  0b00010001, /* V */ \
+  0b00001011, /* W */ \
+  0b00011001, /* X */ \
+  0b00011011, /* Y */ \
+  0b00011100, /* Z */ \
+  0b00111111, /* 0 */ \
+  0b00101111, /* 1 */ \
+  0b00100111, /* 2 */ \
+  0b00100011, /* 3 */ \
+  0b00100001, /* 4 */ \
+  0b00100000, /* 5 */ \
+  0b00110000, /* 6 */ \
+  0b00111000, /* 7 */ \
+  0b00111100, /* 8 */ \
+  0b00111110, /* 9 */
@@ -0,0 +1,36 @@
+#ifdef RECEIVE
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+
+#include "hal_adc.h"
+#include "rx.h"
+
+void hal_adc_start(void) {
+  // Audio comes in on PA7, biased to half the supply.
+  PORTA.DIRCLR = PIN7_bm;
+  PORTA.PIN7CTRL = PORT_ISC_INPUT_DISABLE_gc;
+
+  // 16MHz / 64 = 250kHz ADC clock. With the sample length extended,
+  // each conversion takes 13 + 16 + 2 ADC clocks, or about 8kHz.
+  ADC0.CTRLC = ADC_SAMPCAP_bm | ADC_REFSEL_VDDREF_gc | ADC_PRESC_DIV64_gc;
+  ADC0.CTRLD = ADC_INITDLY_DLY16_gc | 2;
+  ADC0.SAMPCTRL = 16;
+  ADC0.MUXPOS = ADC_MUXPOS_AIN7_gc;
+  ADC0.INTCTRL = ADC_RESRDY_bm;
+  ADC0.CTRLA = ADC_RESSEL_8BIT_gc | ADC_FREERUN_bm | ADC_ENABLE_bm;
+  ADC0.COMMAND = ADC_STCONV_bm;
+}
+
+void hal_adc_stop(void) {
+  ADC0.CTRLA = 0;
+  ADC0.INTCTRL = 0;
+  ADC0.INTFLAGS = ADC_RESRDY_bm;
+}
+
+ISR(ADC0_RESRDY_vect) {
+  // Reading the result clears the interrupt flag.
+  rx_sample(ADC0.RESL);
+}
+
+#endif
@@ -0,0 +1,7 @@
+#pragma once
+
+// Free-running ADC on PA7, sampling at about RX_SAMPLE_HZ. Each 8-bit
+// result is handed to rx_sample() from the result-ready interrupt.
+
+void hal_adc_start(void);
+void hal_adc_stop(void);
@@ -0,0 +1,34 @@
+#include <avr/io.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hal_eeprom.h"
+
+uint8_t hal_eeprom_read(uint8_t addr) {
+  // EEPROM is memory mapped, so reads are just loads.
+  return *(volatile uint8_t*)(EEPROM_START + addr);
+}
+
+bool hal_eeprom_ready(void) {
+  return !(NVMCTRL.STATUS & NVMCTRL_EEBUSY_bm);
+}
+
+void hal_eeprom_write(uint8_t addr, const uint8_t* buf, uint8_t len) {
+  // Stores to the mapped EEPROM land in the page buffer. Only the
+  // bytes loaded here are erased and written by the command, the
+  // rest of the page is left alone.
+  for (uint8_t i = 0; i < len; i++) {
+    *(volatile uint8_t*)(EEPROM_START + addr + i) = buf[i];
+  }
+  // The CPU keeps running from flash while the EEPROM is written.
+  _PROTECTED_WRITE_SPM(NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEERASEWRITE_gc);
+}
+
+void hal_eeprom_erase(uint8_t addr, uint8_t len) {
+  // As with writes, only the bytes loaded into the page buffer are
+  // erased. Their values don't matter.
+  for (uint8_t i = 0; i < len; i++) {
+    *(volatile uint8_t*)(EEPROM_START + addr + i) = 0xff;
+  }
+  _PROTECTED_WRITE_SPM(NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEERASE_gc);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+// Minimal access to the on-chip EEPROM.
+//
+// Writes are non-blocking: hal_eeprom_write() loads the page buffer
+// and starts an erase/write cycle, which takes a few ms to complete
+// in the background. Callers check hal_eeprom_ready() before
+// starting another write.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define EEPROM_BYTES 128
+#define EEPROM_PAGE_BYTES 32
+
+uint8_t hal_eeprom_read(uint8_t addr);
+bool hal_eeprom_ready(void);
+
+// All len bytes starting at addr must lie within the same page.
+void hal_eeprom_write(uint8_t addr, const uint8_t* buf, uint8_t len);
+void hal_eeprom_erase(uint8_t addr, uint8_t len);
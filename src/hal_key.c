@@ -1,3 +1,4 @@
+#include <avr/interrupt.h>
 #include <avr/io.h>
 #include <stdbool.h>
 
@@ -7,8 +8,33 @@ void hal_key_init(void) {
   // Pin configured as input with pullup enabled.
   PORTA.DIRCLR = PIN6_bm;
   PORTA.PIN6CTRL = PORT_PULLUPEN_bm;
+#ifdef PADDLE
+  PORTA.DIRCLR = PIN7_bm;
+  PORTA.PIN7CTRL = PORT_PULLUPEN_bm;
+#endif
 }
 
 bool hal_key_pressed(void) {
   return !(PORTA.IN & PIN6_bm);
 }
+
+#ifdef PADDLE
+bool hal_key_dah_pressed(void) {
+  return !(PORTA.IN & PIN7_bm);
+}
+#endif
+
+void hal_key_wake(bool enable) {
+  // PA6 is fully asynchronous, so a falling edge wakes us even with
+  // every clock stopped. PA7 isn't, and has to sense both edges for
+  // that.
+  PORTA.PIN6CTRL = PORT_PULLUPEN_bm | (enable ? PORT_ISC_FALLING_gc : 0);
+#ifdef PADDLE
+  PORTA.PIN7CTRL = PORT_PULLUPEN_bm | (enable ? PORT_ISC_BOTHEDGES_gc : 0);
+#endif
+}
+
+// Only here to wake us up, the key is read on the next tick as usual.
+ISR(PORTA_PORT_vect) {
+  PORTA.INTFLAGS = PIN6_bm | PIN7_bm;
+}
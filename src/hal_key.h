@@ -4,3 +4,10 @@
 
 void hal_key_init(void);
 bool hal_key_pressed(void);
+
+// The dah paddle, with -DPADDLE.
+bool hal_key_dah_pressed(void);
+
+// Lets the key (either paddle, with -DPADDLE) wake us from power-down,
+// or stops it from doing so.
+void hal_key_wake(bool enable);
@@ -0,0 +1,31 @@
+#include <avr/io.h>
+#include <stdint.h>
+
+#include "hal_stack.h"
+
+#define PAINT 0xc5
+
+// Placed by the linker just past .bss.
+extern uint8_t __heap_start;
+
+// Runs as part of the startup code, once the stack pointer is set up.
+// Naked, so it falls through into the rest of the startup code rather
+// than returning.
+__attribute__((naked, used, section(".init3")))
+static void paint(void) {
+  uint8_t* p = &__heap_start;
+  while (p < (uint8_t*)SP) {
+    *p++ = PAINT;
+  }
+}
+
+uint8_t hal_stack_free(void) {
+  // The stack grows down from RAMEND, so the first byte that isn't
+  // paint is the deepest it's been. The odd pushed byte could match
+  // the paint, which makes this a byte or two hopeful at worst.
+  const uint8_t* p = &__heap_start;
+  while ((p <= (const uint8_t*)RAMEND) && (*p == PAINT)) {
+    p++;
+  }
+  return p - &__heap_start;
+}
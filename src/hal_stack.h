@@ -0,0 +1,10 @@
+#pragma once
+
+// The RAM between the end of .bss and the stack is painted with a
+// known byte before main() runs. hal_stack_free() counts how much of
+// it is still untouched, which is how close the stack has ever come
+// to the globals since power up.
+
+#include <stdint.h>
+
+uint8_t hal_stack_free(void);
@@ -0,0 +1,25 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "idle.h"
+
+// Seconds begun since the key last did anything.
+static uint16_t idle_seconds = 0;
+
+void idle_tick(bool active, bool second) {
+  if (active) {
+    idle_seconds = 0;
+    return;
+  }
+  if (second && (idle_seconds < SLEEP_AFTER_SECONDS)) {
+    idle_seconds++;
+  }
+}
+
+bool idle_expired(void) {
+  return SLEEP_AFTER_SECONDS && (idle_seconds >= SLEEP_AFTER_SECONDS);
+}
+
+void idle_expire(void) {
+  idle_seconds = SLEEP_AFTER_SECONDS;
+}
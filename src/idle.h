@@ -0,0 +1,26 @@
+#pragma once
+
+// Keeps track of how long the key has gone unused, so the device can
+// power down when nobody's around rather than waking up on every tick
+// all night.
+//
+// Build with -DSLEEP_AFTER_SECONDS=n to change how long that takes,
+// or with 0 to never power down.
+
+#include <stdbool.h>
+
+#ifndef SLEEP_AFTER_SECONDS
+#define SLEEP_AFTER_SECONDS 300
+#endif
+
+// Called on each tick, with whether the key did anything, and whether
+// the tick starts a new second by counters_second().
+void idle_tick(bool active, bool second);
+
+// Whether the key has gone unused for SLEEP_AFTER_SECONDS, give or
+// take the second it was last used in.
+bool idle_expired(void);
+
+// Takes the key to have gone unused for long enough already, eg: so
+// the sleep current can be measured without waiting.
+void idle_expire(void);
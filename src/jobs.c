@@ -0,0 +1,49 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "jobs.h"
+
+// There are only two jobs, grading and picking the next drill, and
+// neither is ever queued twice.
+#define JOBS_MAX 2
+
+static job_t queue[JOBS_MAX];
+static uint8_t head = 0;
+static uint8_t len = 0;
+
+static void run_oldest(void) {
+  while (!queue[head]()) {
+  }
+  head = (head + 1) % JOBS_MAX;
+  len--;
+}
+
+void jobs_add(job_t job) {
+  for (uint8_t i = 0; i < len; i++) {
+    if (queue[(head + i) % JOBS_MAX] == job) {
+      return;
+    }
+  }
+  if (len == JOBS_MAX) {
+    run_oldest();
+  }
+  queue[(head + len) % JOBS_MAX] = job;
+  len++;
+}
+
+void jobs_tick(void) {
+  if (len && queue[head]()) {
+    head = (head + 1) % JOBS_MAX;
+    len--;
+  }
+}
+
+void jobs_finish(void) {
+  while (len) {
+    run_oldest();
+  }
+}
+
+void jobs_reset(void) {
+  len = 0;
+}
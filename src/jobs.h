@@ -0,0 +1,27 @@
+#pragma once
+
+// A small queue of work that can wait for a quiet tick.
+//
+// A job does a bounded slice of its work each time it's called, and
+// returns true once it's done. jobs_tick() runs one slice of the
+// oldest job, and is only called on ticks with nothing else going on,
+// like shell_tick(). So work such as grading and picking the next
+// drill gets spread over otherwise empty ticks rather than landing in
+// one long tick.
+//
+// Anything that needs a job's result has to call jobs_finish() first,
+// which runs what's left of every queued job straight away.
+
+#include <stdbool.h>
+
+typedef bool (*job_t)(void);
+
+// Queues a job, unless it's already queued. If the queue is full, the
+// oldest job is finished first to make room.
+void jobs_add(job_t job);
+
+void jobs_tick(void);
+void jobs_finish(void);
+
+// Drops all queued jobs.
+void jobs_reset(void);
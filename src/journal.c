@@ -0,0 +1,233 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "capture.h"
+#include "hal_eeprom.h"
+#include "journal.h"
+#include "morse.h"
+#include "persist.h"
+#include "uart.h"
+
+#define FIRST_PAGE_ADDR PERSIST_EEPROM_BYTES
+#define NUM_PAGES ((EEPROM_BYTES - PERSIST_EEPROM_BYTES) / EEPROM_PAGE_BYTES)
+
+#define PASSES_MAX 63
+
+// The page we're appending to, its sequence number and the offset of
+// the next free byte in it. This starts out as though the last page
+// was full, so the first write moves on to the first page.
+static uint8_t head_page = NUM_PAGES - 1;
+static uint8_t head_seq = 0xff;
+static uint8_t head_off = EEPROM_PAGE_BYTES;
+
+// Set once the page after the head has been erased.
+static bool next_erased = false;
+
+// Encoded events waiting to be written out.
+static uint8_t stage[6];
+static uint8_t stage_len = 0;
+
+// Passed attempts not yet staged.
+static uint8_t passes = 0;
+
+// How long since the last event, in seconds begun since then.
+static uint8_t idle_seconds = 0;
+static uint8_t idle_minutes = 0;
+
+// Position (plus one) of the next character to dump, or 0 if we
+// aren't dumping.
+static uint8_t dump_pos = 0;
+
+static uint8_t page_addr(uint8_t page) {
+  return FIRST_PAGE_ADDR + page * EEPROM_PAGE_BYTES;
+}
+
+void journal_init(void) {
+  bool found = false;
+  next_erased = false;
+  for (uint8_t page = 0; page < NUM_PAGES; page++) {
+    uint8_t seq = hal_eeprom_read(page_addr(page));
+    if (seq == 0xff) {
+      // Never written.
+      continue;
+    }
+    // Sequence numbers wrap, so compare them by their difference.
+    if (found && ((int8_t)(seq - head_seq) <= 0)) {
+      continue;
+    }
+    found = true;
+    head_page = page;
+    head_seq = seq;
+  }
+
+  if (!found) {
+    head_page = NUM_PAGES - 1;
+    head_seq = 0xff;
+    head_off = EEPROM_PAGE_BYTES;
+    return;
+  }
+
+  // Find the end of the newest page.
+  head_off = 1;
+  while ((head_off < EEPROM_PAGE_BYTES) &&
+         (hal_eeprom_read(page_addr(head_page) + head_off) != 0xff)) {
+    head_off++;
+  }
+}
+
+static void stage_byte(uint8_t b) {
+  // Drop events if we're somehow too far behind.
+  if (stage_len < sizeof(stage)) {
+    stage[stage_len++] = b;
+  }
+}
+
+static void stage_passes(void) {
+  if (passes) {
+    stage_byte(0x80 | passes);
+    passes = 0;
+  }
+}
+
+static void stage_idle(void) {
+  // Record how long we were idle before this event.
+  uint8_t minutes = idle_minutes;
+  if (minutes) {
+    stage_passes();
+    do {
+      uint8_t b = 0xc0 | (minutes & 0x0f);
+      minutes >>= 4;
+      if (minutes) {
+        b |= 0x10;
+      }
+      stage_byte(b);
+    } while (minutes);
+  }
+  idle_minutes = 0;
+  idle_seconds = 0;
+}
+
+void journal_session(uint8_t level) {
+  stage_idle();
+  stage_passes();
+  stage_byte(0xe0 | level);
+}
+
+void journal_pass(void) {
+  stage_idle();
+  passes++;
+  if (passes >= PASSES_MAX) {
+    stage_passes();
+  }
+}
+
+void journal_fail(uint8_t missed_char) {
+  uint8_t code;
+  if (missed_char == CAPTURE_MISS_EMPTY) {
+    code = JOURNAL_MISS_EMPTY;
+  } else if (missed_char >= morse_buf_len) {
+    code = JOURNAL_MISS_EXTRA;
+  } else {
+    code = morse_char_idx(morse_buf[missed_char]);
+    if (code >= JOURNAL_MISS_OTHER) {
+      code = JOURNAL_MISS_OTHER;
+    }
+  }
+
+  stage_idle();
+  if (passes > 3) {
+    stage_passes();
+  }
+  // Fold any short run of passes into the same byte.
+  stage_byte((passes << 5) | code);
+  passes = 0;
+}
+
+static void write_stage(void) {
+  if (!stage_len || !hal_eeprom_ready()) {
+    return;
+  }
+
+  if (head_off >= EEPROM_PAGE_BYTES) {
+    // Move on to the next page, overwriting the oldest one. It takes
+    // one write to erase it and another for the new header.
+    uint8_t page = head_page + 1;
+    if (page >= NUM_PAGES) {
+      page = 0;
+    }
+    if (!next_erased) {
+      hal_eeprom_erase(page_addr(page), EEPROM_PAGE_BYTES);
+      next_erased = true;
+      return;
+    }
+    head_page = page;
+    head_seq++;
+    if (head_seq == 0xff) {
+      head_seq = 0;
+    }
+    hal_eeprom_write(page_addr(head_page), &head_seq, 1);
+    head_off = 1;
+    next_erased = false;
+    return;
+  }
+
+  uint8_t n = EEPROM_PAGE_BYTES - head_off;
+  if (n > stage_len) {
+    n = stage_len;
+  }
+  hal_eeprom_write(page_addr(head_page) + head_off, stage, n);
+  head_off += n;
+  stage_len -= n;
+  for (uint8_t i = 0; i < stage_len; i++) {
+    stage[i] = stage[i + n];
+  }
+}
+
+static uint8_t hex_digit(uint8_t v) {
+  return (v < 10) ? ('0' + v) : ('a' + v - 10);
+}
+
+static void dump_next(void) {
+  // Each page is dumped as 64 hex digits followed by a newline.
+  uint8_t pos = dump_pos - 1;
+  uint8_t page = pos / (2 * EEPROM_PAGE_BYTES + 1);
+  uint8_t col = pos % (2 * EEPROM_PAGE_BYTES + 1);
+  uint8_t c = '\n';
+  if (col < 2 * EEPROM_PAGE_BYTES) {
+    uint8_t b = hal_eeprom_read(page_addr(page) + col / 2);
+    c = hex_digit((col & 1) ? (b & 0x0f) : (b >> 4));
+  }
+  if (!uart_put(c)) {
+    // Try again next tick.
+    return;
+  }
+  dump_pos++;
+  if (dump_pos > NUM_PAGES * (2 * EEPROM_PAGE_BYTES + 1)) {
+    dump_pos = 0;
+  }
+}
+
+void journal_dump(void) {
+  dump_pos = 1;
+}
+
+bool journal_dumping(void) {
+  return dump_pos != 0;
+}
+
+void journal_tick(bool second) {
+  if (second && (++idle_seconds >= 60)) {
+    idle_seconds = 0;
+    if (idle_minutes < 0xff) {
+      idle_minutes++;
+    }
+    // Don't leave passes sitting in RAM while idle.
+    stage_passes();
+  }
+
+  write_stage();
+
+  if (dump_pos) {
+    dump_next();
+  }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+// This library keeps a compact log of practice sessions in the
+// EEPROM, so we can review later how a student got on.
+//
+// Pages after the persist page form a circular log. The first byte
+// of each page is a sequence number (never 0xff) used to find the
+// newest page, followed by events:
+//
+//   0rrccccc  r (0-3) passed attempts, followed by a failed attempt
+//             that first went wrong at letter c (0 for A), or one
+//             of the JOURNAL_MISS_* codes.
+//   10nnnnnn  n (1-63) passed attempts.
+//   110cgggg  minutes spent idle before the next event, 4 bits at a
+//             time starting with the least significant bits. c is set
+//             if more bits follow.
+//   111lllll  a new session, where l is either the practice level,
+//             JOURNAL_RECEIVE or JOURNAL_STRAIGHT_KEY.
+//
+// No event byte is ever 0xff, which marks the unwritten end of a
+// page. Difficulty changes aren't logged, as they follow from the
+// pass/fail sequence and the starting level.
+//
+// Events are staged in RAM, and written out from journal_tick() one
+// EEPROM write at a time, so logging never stalls a tick.
+//
+// journal_dump() starts writing out the raw log pages as hex, one
+// line per page, over the uart.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define JOURNAL_MISS_OTHER 29
+#define JOURNAL_MISS_EXTRA 30
+#define JOURNAL_MISS_EMPTY 31
+
+#define JOURNAL_RECEIVE 29
+#define JOURNAL_STRAIGHT_KEY 30
+
+void journal_init(void);
+void journal_session(uint8_t level);
+void journal_pass(void);
+void journal_fail(uint8_t missed_char);
+// Called on each tick, with whether it starts a new second by
+// counters_second().
+void journal_tick(bool second);
+void journal_dump(void);
+bool journal_dumping(void);
@@ -1,12 +1,42 @@
+#ifndef PADDLE
+
 #include <stdint.h>
 
+#include "counters.h"
 #include "hal_key.h"
 #include "key.h"
+#include "trace.h"
+
+// Edges are reported as soon as they're seen, and the key is then
+// left alone until it's been still for a window of ticks. Any bounces
+// in that time restart the window, and the longest gap between them
+// is remembered, so the window grows to suit the key. It shrinks back
+// a tick after a run of clean edges.
+//
+// The key is read a few times each tick and goes by the majority, so
+// a single glitched read doesn't count. When the key looks noisy, with
+// reads that disagree or edges that undo themselves before the window
+// is up, edges wait out the window before they're reported instead.
+#define WINDOW_MIN_TICKS 1
+#define WINDOW_MAX_TICKS 8
+#define WINDOW_START_TICKS 2
+#define CLEAN_EDGES_TO_SHRINK 32
+
+#define NOISE_GLITCH 4
+#define NOISE_DISAGREE 1
+#define NOISE_LEVEL 8
+#define NOISE_MAX 16
 
-#define DEBOUNCE_WAIT_TICKS 2
 #define LONG_PRESS_TICKS 1000
 
-static uint8_t debounce_ticks = 0;
+// Ticks left before the key is taken to have settled, or 0 if it has.
+static uint8_t lockout_ticks = 0;
+static uint8_t window_ticks = WINDOW_START_TICKS;
+
+// Ticks since the key last changed, while it's settling.
+static uint8_t since_change = 0;
+static uint8_t clean_edges = 0;
+static uint8_t noise = 0;
 
 // raw state of the key.
 static bool raw_pressed = false;
@@ -14,6 +44,9 @@ static bool raw_pressed = false;
 // debounced state of the key.
 static bool debounced_pressed = false;
 
+// whether the current edge has been reported yet.
+static bool reported = false;
+
 // counter for a long press.
 static uint16_t pressed_ticks = 0;
 
@@ -21,42 +54,98 @@ void key_init(void) {
   hal_key_init();
 }
 
+static void add_noise(uint8_t amount) {
+  noise = (noise + amount > NOISE_MAX) ? NOISE_MAX : noise + amount;
+}
+
+static key_state_t report(bool pressed) {
+  debounced_pressed = pressed;
+  if (debounced_pressed) {
+    pressed_ticks = 0;
+    TRACE_EVENT(TRACE_KEY, KEY_DOWN);
+    return KEY_DOWN;
+  } else if (pressed_ticks >= LONG_PRESS_TICKS) {
+    TRACE_EVENT(TRACE_KEY, KEY_UP_LONG);
+    return KEY_UP_LONG;
+  } else {
+    TRACE_EVENT(TRACE_KEY, KEY_UP);
+    return KEY_UP;
+  }
+}
+
+static void clean_edge(void) {
+  if (noise) {
+    noise--;
+  }
+  if (++clean_edges >= CLEAN_EDGES_TO_SHRINK) {
+    clean_edges = 0;
+    if (window_ticks > WINDOW_MIN_TICKS) {
+      window_ticks--;
+    }
+  }
+}
+
+// The key has been still for the whole window.
+static key_state_t settled(void) {
+  bool changed = raw_pressed != debounced_pressed;
+  if (reported == changed) {
+    // Either the edge was reported and then undid itself, or it undid
+    // itself before it could be reported.
+    add_noise(NOISE_GLITCH);
+  } else {
+    clean_edge();
+  }
+  return changed ? report(raw_pressed) : KEY_NO_CHANGE;
+}
+
 key_state_t key_tick(void) {
   // Update pressed_ticks if key is currently pressed.
   if (debounced_pressed && (pressed_ticks < LONG_PRESS_TICKS)) {
     pressed_ticks++;
   }
 
-  // Read the current state of our key.
-  bool is_pressed = hal_key_pressed();
-
-  if (is_pressed != raw_pressed) {
-    // Change in raw key state - start up the debounce counter.
-    raw_pressed = is_pressed;
-    debounce_ticks = DEBOUNCE_WAIT_TICKS;
-    return KEY_NO_CHANGE;
-  }
+  // Read the current state of our key, by majority.
+  uint8_t votes = hal_key_pressed() + hal_key_pressed() + hal_key_pressed();
+  bool is_pressed = votes >= 2;
 
-  if (debounce_ticks) {
-    // We're debouncing. Decrement countdown until we're at 0.
-    debounce_ticks--;
-    if (debounce_ticks) {
-      // not yet done.
+  if (lockout_ticks) {
+    since_change++;
+    if (is_pressed != raw_pressed) {
+      // The key changed again before it settled. Make sure the window
+      // covers gaps like this one from now on.
+      counters_inc(COUNTER_KEY_BOUNCES);
+      raw_pressed = is_pressed;
+      if (since_change >= window_ticks) {
+        window_ticks = (since_change < WINDOW_MAX_TICKS) ?
+          since_change + 1 : WINDOW_MAX_TICKS;
+      }
+      since_change = 0;
+      clean_edges = 0;
+      lockout_ticks = window_ticks;
       return KEY_NO_CHANGE;
     }
-    // countdown completed.
-    debounced_pressed = raw_pressed;
-    if (debounced_pressed) {
-      pressed_ticks = 0;
-      return KEY_DOWN;
-    } else {
-      if (pressed_ticks >= LONG_PRESS_TICKS) {
-        return KEY_UP_LONG;
-      } else {
-        return KEY_UP;
-      }
+    if (--lockout_ticks) {
+      return KEY_NO_CHANGE;
     }
+    return settled();
   }
 
+  if (is_pressed == raw_pressed) {
+    if ((votes == 1) || (votes == 2)) {
+      // Reads that disagree while the key is meant to be still.
+      add_noise(NOISE_DISAGREE);
+    }
+    return KEY_NO_CHANGE;
+  }
+
+  raw_pressed = is_pressed;
+  since_change = 0;
+  lockout_ticks = window_ticks;
+  reported = noise < NOISE_LEVEL;
+  if (reported) {
+    return report(raw_pressed);
+  }
   return KEY_NO_CHANGE;
 }
+
+#endif
@@ -0,0 +1,134 @@
+#ifdef PADDLE
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "calib.h"
+#include "hal_key.h"
+#include "keyer.h"
+#include "morse.h"
+#include "trace.h"
+
+#define LONG_RUN_TICKS 2000
+
+typedef enum _keyer_phase_t {
+  KEYER_IDLE,
+  KEYER_MARK,
+  KEYER_SPACE,
+} keyer_phase_t;
+
+// A keyer_mode_t and a keyer_phase_t, kept in a byte each.
+static uint8_t keyer_mode = KEYER_IAMBIC_B;
+static uint8_t phase = KEYER_IDLE;
+
+// Ticks left in the current mark or space. A dah is 180 ticks, and
+// calibration stretches that by at most 5/4, so it fits in a byte.
+static uint8_t countdown = 0;
+
+// The element being sent, or last sent.
+#define SENDING_DAH_bm 0x01
+// Paddles pressed while an element was going.
+#define DIT_MEMORY_bm 0x02
+#define DAH_MEMORY_bm 0x04
+// Whether both paddles were down at once during the element.
+#define SQUEEZED_bm 0x08
+
+static uint8_t flags = 0;
+
+// Ticks since the keyer last went idle.
+static uint16_t run_ticks = 0;
+
+void keyer_init(keyer_mode_t mode) {
+  hal_key_init();
+  keyer_mode = mode;
+  phase = KEYER_IDLE;
+  countdown = 0;
+  flags = 0;
+  run_ticks = 0;
+}
+
+static key_state_t start_element(bool dah, bool dit_down, bool dah_down) {
+  // This element satisfies any memory for it, but the other paddle
+  // may already be down.
+  if (dah) {
+    flags = SENDING_DAH_bm | (dit_down ? DIT_MEMORY_bm : 0);
+  } else {
+    flags = dah_down ? DAH_MEMORY_bm : 0;
+  }
+  if (dit_down && dah_down) {
+    flags |= SQUEEZED_bm;
+  }
+  phase = KEYER_MARK;
+  countdown = calib_ticks(dah ? 3 * DIT_TICKS : DIT_TICKS);
+  TRACE_EVENT(TRACE_KEY, KEY_DOWN);
+  return KEY_DOWN;
+}
+
+key_state_t keyer_tick(void) {
+  bool dit = hal_key_pressed();
+  bool dah = hal_key_dah_pressed();
+
+  if (phase != KEYER_IDLE) {
+    if (run_ticks < 0xffff) {
+      run_ticks++;
+    }
+    if (dit && dah) {
+      flags |= SQUEEZED_bm;
+    }
+    // Remember the other paddle.
+    if (flags & SENDING_DAH_bm) {
+      if (dit) {
+        flags |= DIT_MEMORY_bm;
+      }
+    } else if (dah) {
+      flags |= DAH_MEMORY_bm;
+    }
+  }
+  bool sending_dah = flags & SENDING_DAH_bm;
+
+  if (countdown) {
+    countdown--;
+    if (countdown) {
+      return KEY_NO_CHANGE;
+    }
+  }
+
+  if (phase == KEYER_MARK) {
+    phase = KEYER_SPACE;
+    countdown = calib_ticks(DIT_TICKS);
+    TRACE_EVENT(TRACE_KEY, KEY_UP);
+    return KEY_UP;
+  }
+
+  if (phase == KEYER_SPACE) {
+    if ((keyer_mode == KEYER_IAMBIC_A) && (flags & SQUEEZED_bm) && !dit &&
+        !dah) {
+      // Let go of a squeeze, so stop here.
+      flags &= ~(DIT_MEMORY_bm | DAH_MEMORY_bm);
+    }
+    // Alternate if asked to, otherwise repeat while held.
+    if (sending_dah ? ((flags & DIT_MEMORY_bm) || dit)
+                    : ((flags & DAH_MEMORY_bm) || dah)) {
+      return start_element(!sending_dah, dit, dah);
+    }
+    if (sending_dah ? dah : dit) {
+      return start_element(sending_dah, dit, dah);
+    }
+    phase = KEYER_IDLE;
+  }
+
+  // Idle.
+  if (dit || dah) {
+    // Dit first, if both went down together.
+    return start_element(!dit, dit, dah);
+  }
+  if (run_ticks >= LONG_RUN_TICKS) {
+    run_ticks = 0;
+    TRACE_EVENT(TRACE_KEY, KEY_UP_LONG);
+    return KEY_UP_LONG;
+  }
+  run_ticks = 0;
+  return KEY_NO_CHANGE;
+}
+
+#endif
@@ -0,0 +1,39 @@
+#pragma once
+
+// This library is an iambic keyer for paddles, the dit paddle on PA6
+// (where the straight key goes) and the dah paddle on PA7. Build with
+// -DPADDLE to use it in place of the straight key, which leaves key.c
+// out.
+//
+// keyer_tick() is called once a tick instead of key_tick(), and
+// reports the elements it sends as KEY_DOWN and KEY_UP, so the rest of
+// the firmware can't tell it from a very precise straight key. Like
+// morse_tick(), it counts elements out in ticks, so each dit and the
+// space after it are exactly DIT_TICKS and each dah 3 * DIT_TICKS.
+//
+// Pressing the other paddle during an element is remembered, and
+// sends the other element next. Squeezing both alternates dits and
+// dahs. The two modes differ on letting go of a squeeze: mode B sends
+// one more alternate element, and mode A stops right away.
+//
+// Keeping the paddles busy for a couple of seconds without a break
+// reports a KEY_UP_LONG once they're released, to switch modes. That
+// is longer than any single character takes.
+
+#include "key.h"
+
+#if defined(PADDLE) && defined(RECEIVE)
+#error "The dah paddle and the receive audio input both use PA7"
+#endif
+
+typedef enum _keyer_mode_t {
+  KEYER_IAMBIC_A,
+  KEYER_IAMBIC_B,
+} keyer_mode_t;
+
+#ifndef KEYER_MODE
+#define KEYER_MODE KEYER_IAMBIC_B
+#endif
+
+void keyer_init(keyer_mode_t mode);
+key_state_t keyer_tick(void);
@@ -1,35 +1,108 @@
 #include <avr/interrupt.h>
 #include <avr/sleep.h>
+#include <stdbool.h>
 
+#include "calib.h"
+#include "counters.h"
+#include "hal_key.h"
+#include "journal.h"
 #include "key.h"
+#include "keyer.h"
+#include "rx.h"
 #include "state.h"
 #include "ticks.h"
 #include "tone.h"
+#include "trace.h"
+#include "uart.h"
 
 // (1) Vdd
-// (2) PA6 - KEY
-// (3) PA7 - NC
-// (4) PA1 - NC
-// (5) PA2 - NC
+// (2) PA6 - KEY (the dit paddle with -DPADDLE)
+// (3) PA7 - AUDIO IN (with -DRECEIVE), or the dah paddle (with -DPADDLE)
+// (4) PA1 - TXD
+// (5) PA2 - RXD
 // (6) PA0 - UPDI
 // (7) PA3 - SPKR
 // (8) GND
 
+// Stops everything, the PIT and the ULP oscillator included, and
+// powers down until the key goes down. The press is then picked up by
+// the first tick after the PIT restarts, about a millisecond later.
+//
+// This should draw no more than the datasheet's power-down figure,
+// with the watchdog and BOD left off by the fuses. The 's' shell
+// command gets here once it's the user's turn, to measure it.
+static void power_down(void) {
+  ticks_stop();
+  hal_key_wake(true);
+  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+  cli();
+  // A press after this check still sets its interrupt flag, which
+  // wakes us straight away.
+#ifdef PADDLE
+  bool pressed = hal_key_pressed() || hal_key_dah_pressed();
+#else
+  bool pressed = hal_key_pressed();
+#endif
+  if (!pressed) {
+    sleep_enable();
+    sei();
+    sleep_cpu();
+    sleep_disable();
+  }
+  sei();
+  hal_key_wake(false);
+  ticks_start();
+}
+
 void setup(void) {
   ticks_init();
+  // The fuses run the main clock at 16MHz, and we expect about 3V.
+  calib_init(SIGROW.OSC16ERR3V);
   tone_init();
+#ifdef PADDLE
+  keyer_init(KEYER_MODE);
+#else
   key_init();
+#endif
+  uart_init();
+  journal_init();
+#if !defined(PADDLE) && !defined(RECEIVE)
+  // PA7 is left floating, so turn off its input buffer.
+  PORTA.PIN7CTRL = PORT_ISC_INPUT_DISABLE_gc;
+#endif
 }
 
 int main(void) {
   setup();
-  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
-  state_reset();
+  state_resume();
   sei();
 
   while (1) {
+    // Standby rather than power down, so an incoming byte can wake us
+    // up. Stay in idle while sending, as the uart needs the main
+    // clock, and likewise for the sidetone, for the ADC while
+    // receiving and for TCB0 while the PIT is being measured.
+    //
+    // Once nobody's used the key for a while, power down until they
+    // do, and then wait for the next tick as usual.
+    bool need_clock = uart_busy() || tone_active() || calib_active();
+#ifdef RECEIVE
+    need_clock = need_clock || rx_active();
+#endif
+    if (!need_clock && state_sleepy()) {
+      power_down();
+      // It may be a while later, and warmer or colder.
+      calib_begin();
+    }
+    set_sleep_mode(need_clock ? SLEEP_MODE_IDLE : SLEEP_MODE_STANDBY);
     sleep_mode();
-    // Woken up by the PIT
+    counters_wakeup();
+    if (!ticks_elapsed()) {
+      // Woken up by something other than the PIT.
+      continue;
+    }
+    calib_tick(ticks_stamp(), ticks_now());
     state_tick();
+    TRACE_TICK();
   }
 }
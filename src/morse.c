@@ -1,9 +1,11 @@
 #include <stdbool.h>
 #include <stdint.h>
-#include <stdlib.h>
 #include <stdio.h>
 
+#include "calib.h"
+#include "encoding.h"
 #include "morse.h"
+#include "trace.h"
 
 // For space efficiency, we represent dits as 0s and dahs as 1s in an
 // 8-bit value. In order to know when the encoding begins, we prefix
@@ -13,44 +15,7 @@
 // T = 00000011
 // Z = 00011100
 
-static const uint8_t ENCODING[] = {
-  0b00000101, // A
-  0b00011000, // B
-  0b00011010, // C
-  0b00001100, // D
-  0b00000010, // E
-  0b00010010, // F
-  0b00001110, // G
-  0b00010000, // H
-  0b00000100, // I
-  0b00010111, // J
-  0b00001101, // K
-  0b00010100, // L
-  0b00000111, // M
-  0b00000110, // N
-  0b00001111, // O
-  0b00010110, // P
-  0b00011101, // Q
-  0b00001010, // R
-  0b00001000, // S
-  0b00000011, // T
-  0b00001001, // U
-  0b00010001, // V
-  0b00001011, // W
-  0b00011001, // X
-  0b00011011, // Y
-  0b00011100, // Z
-  0b00111111, // 0
-  0b00101111, // 1
-  0b00100111, // 2
-  0b00100011, // 3
-  0b00100001, // 4
-  0b00100000, // 5
-  0b00110000, // 6
-  0b00111000, // 7
-  0b00111100, // 8
-  0b00111110, // 9
-};
+static const uint8_t ENCODING[] = {MORSE_ENCODING};
 
 // Holds encoded morse values that we want to send.
 uint8_t morse_buf[5] = {0, 0, 0, 0, 0};
@@ -79,8 +44,27 @@ static bool in_mark = false;
 // Additional dit delays for character spacing.
 static uint8_t extra_dit_spacing = 0;
 
+// How many letters morse_random_step() is filling the buffer to.
+static uint8_t random_nchars = 0;
+
+// The generator's state, in place of avr-libc's own for rand().
+static uint32_t random_state = 1;
+
+uint8_t morse_char_idx(uint8_t encoded) {
+  uint8_t idx = 0;
+  while ((idx < sizeof(ENCODING)) && (ENCODING[idx] != encoded)) {
+    idx++;
+  }
+  return idx;
+}
+
+uint8_t morse_encoding(uint8_t char_idx) {
+  return ENCODING[char_idx];
+}
+
 void morse_reset(void) {
   morse_buf_len = 0;
+  random_nchars = 0;
   morse_buf_sent = 0;
   morse_letter = 0;
   morse_letter_len = 0;
@@ -100,7 +84,7 @@ void morse_rewind(void) {
   // Set up an initial 5 dit wait when rewinding. When advance()
   // starts working on the buffer, another 3 dit wait is added,
   // forming a word-level wait at this point.
-  tick_countdown = 5 * DIT_TICKS;
+  tick_countdown = calib_ticks(5 * DIT_TICKS);
 }
 
 
@@ -122,9 +106,9 @@ static void advance_element(void) {
   // Set up the dit/dah duration and send the next element in our
   // letter.
   if (morse_is_dah(morse_letter, morse_letter_len - 1 - morse_letter_sent)) {
-    tick_countdown = 3 * DIT_TICKS;
+    tick_countdown = calib_ticks(3 * DIT_TICKS);
   } else {
-    tick_countdown = DIT_TICKS;
+    tick_countdown = calib_ticks(DIT_TICKS);
   }
   morse_letter_sent++;
 }
@@ -135,6 +119,7 @@ static morse_action_t advance(void) {
     // Check if we have more characters to send.
     if (morse_buf_sent >= morse_buf_len) {
       // All done.
+      TRACE_EVENT(TRACE_MORSE, MORSE_NONE);
       return MORSE_NONE;
     }
     // Advance our buffer, and set up the current character to send.
@@ -142,11 +127,12 @@ static morse_action_t advance(void) {
     morse_letter_len = morse_num_elements(morse_letter);
     morse_letter_sent = 0;
     // Add extra letter spacing for (3 + farnsworth) * DIT ticks
-    tick_countdown = DIT_TICKS * (3  + extra_dit_spacing);
+    tick_countdown = calib_ticks(DIT_TICKS * (3  + extra_dit_spacing));
     return MORSE_HOLD;
   }
   advance_element();
   in_mark = true;
+  TRACE_EVENT(TRACE_MORSE, MORSE_START_MARK);
   return MORSE_START_MARK;
 }
 
@@ -164,24 +150,62 @@ void morse_set(uint8_t char_idx) {
   }
   morse_buf[0] = ENCODING[char_idx];
   morse_buf_len = 1;
-  tick_countdown = 5 * DIT_TICKS;
+  tick_countdown = calib_ticks(5 * DIT_TICKS);
 }
 
-void morse_random_generate(uint8_t nchars, uint8_t extra) {
+// avr-libc's rand_r(), written out so host builds draw the same
+// letters: Park and Miller's minimal standard generator, by Schrage's
+// method so nothing overflows 32 bits.
+uint16_t morse_random(void) {
+  int32_t x = random_state ? random_state : 123459876L;
+  int32_t hi = x / 127773L;
+  int32_t lo = x % 127773L;
+  x = 16807L * lo - 2836L * hi;
+  if (x < 0) {
+    x += 0x7fffffffL;
+  }
+  random_state = x;
+  return x % 0x8000U;
+}
+
+uint32_t morse_random_state(void) {
+  return random_state;
+}
+
+void morse_random_seed(uint32_t state) {
+  random_state = state;
+}
+
+void morse_random_begin(uint8_t nchars, uint8_t extra) {
   morse_reset();
   extra_dit_spacing = extra;
   if (nchars > sizeof(morse_buf)) {
     nchars = sizeof(morse_buf);
   }
-  for (uint8_t i = 0; i < nchars; i++) {
-    morse_buf[i] = ENCODING[rand() % 26];
-  }
-  morse_buf_len = nchars;
+  random_nchars = nchars;
 
   // Start off with a word space. Note that letters begin with
   // 3 extra dit ticks, so we add 5 more here to make an 8
   // dit word space.
-  tick_countdown = 5 * DIT_TICKS;
+  tick_countdown = calib_ticks(5 * DIT_TICKS);
+}
+
+bool morse_random_step(void) {
+  if (morse_buf_len < random_nchars) {
+    morse_buf[morse_buf_len++] = ENCODING[morse_random() % 26];
+  }
+  return morse_buf_len >= random_nchars;
+}
+
+void morse_random_clear(void) {
+  morse_buf_len = 0;
+  random_nchars = 0;
+}
+
+void morse_random_generate(uint8_t nchars, uint8_t extra) {
+  morse_random_begin(nchars, extra);
+  while (!morse_random_step()) {
+  }
 }
 
 morse_action_t morse_tick(void) {
@@ -200,8 +224,9 @@ morse_action_t morse_tick(void) {
   // Handle a common case - when we get out of a mark
   // mode, we always pause for a dit duration.
   if (in_mark) {
-    tick_countdown = DIT_TICKS;
+    tick_countdown = calib_ticks(DIT_TICKS);
     in_mark = false;
+    TRACE_EVENT(TRACE_MORSE, MORSE_START_SPACE);
     return MORSE_START_SPACE;
   }
 
@@ -39,12 +39,42 @@ void morse_rewind(void);
 
 void morse_random_generate(uint8_t nchars, uint8_t farnsworth_dit_spacing);
 
+// The generator random letters are drawn from, for text.c and dict.c
+// too. Its whole state is 32 bits, which morse_random_state() returns
+// so it can be checkpointed, and morse_random_seed() puts back.
+uint16_t morse_random(void);
+uint32_t morse_random_state(void);
+void morse_random_seed(uint32_t state);
+
+// The same, a letter at a time. morse_random_begin() empties the
+// buffer and starts the word space, and each morse_random_step() adds
+// a letter, returning true once there are nchars. The letters need to
+// be in before the word space runs out.
+void morse_random_begin(uint8_t nchars, uint8_t farnsworth_dit_spacing);
+bool morse_random_step(void);
+
+// Empties the buffer for a caller that fills it in its own way, during
+// the word space morse_random_begin() started. Unlike
+// morse_random_generate(), it leaves that word space and the spacing
+// alone.
+void morse_random_clear(void);
+
 morse_action_t morse_tick(void);
 
 bool morse_is_dah(uint8_t encoded, uint8_t pos);
 
 uint8_t morse_num_elements(uint8_t encoded);
 
+// Encoding of the letter at char_idx, which must be below
+// MORSE_NUM_CHARS.
+uint8_t morse_encoding(uint8_t char_idx);
+
+// Index of an encoded letter (0 for A), or MORSE_NUM_CHARS if the
+// encoding isn't known.
+uint8_t morse_char_idx(uint8_t encoded);
+
+#define MORSE_NUM_CHARS 36
+
 extern uint8_t morse_buf[];
 extern uint8_t morse_buf_len;
 
@@ -55,5 +85,6 @@ extern uint8_t morse_buf_len;
 // => 60 * 1000 / (50 * WPM) msec
 // => 1200 / WPM msec.
 // each tick is also 1ms, so this should be the same
-// as the number of ticks.
+// as the number of ticks. These are nominal ticks, which
+// calib_ticks() turns into however many the PIT needs.
 #define DIT_TICKS ((1200 / WPM))
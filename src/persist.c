@@ -0,0 +1,95 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hal_eeprom.h"
+#include "persist.h"
+
+// Each record is laid out as
+// [sequence] [settings] [seed, 4 bytes low first] [crc]
+#define RECORD_BYTES 7
+#define RECORD_SEED 2
+#define RECORD_CRC (RECORD_BYTES - 1)
+
+// Four records fit within the first EEPROM page, so a record never
+// straddles a page and is written by a single page write.
+#define NUM_SLOTS (PERSIST_EEPROM_BYTES / RECORD_BYTES)
+
+// Slot holding the newest good record, and its sequence number.
+static uint8_t newest_slot = NUM_SLOTS - 1;
+static uint8_t newest_seq = 0;
+
+// A record waiting for the EEPROM to be ready.
+static uint8_t pending[RECORD_BYTES];
+static bool has_pending = false;
+
+static uint8_t crc8(const uint8_t* buf, uint8_t len) {
+  // CRC-8, polynomial x^8 + x^2 + x + 1, with a non-zero initial
+  // value so neither a blank (0xff) nor a zeroed slot is valid.
+  uint8_t crc = 0x5a;
+  for (uint8_t i = 0; i < len; i++) {
+    crc ^= buf[i];
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) : (crc << 1);
+    }
+  }
+  return crc;
+}
+
+bool persist_load(uint8_t* settings, uint32_t* seed) {
+  bool found = false;
+  uint8_t record[RECORD_BYTES];
+
+  newest_slot = NUM_SLOTS - 1;
+  newest_seq = 0;
+
+  for (uint8_t slot = 0; slot < NUM_SLOTS; slot++) {
+    for (uint8_t i = 0; i < RECORD_BYTES; i++) {
+      record[i] = hal_eeprom_read(slot * RECORD_BYTES + i);
+    }
+    if (crc8(record, RECORD_CRC) != record[RECORD_CRC]) {
+      // Blank, or a torn write.
+      continue;
+    }
+    // Sequence numbers wrap, so compare them by their difference.
+    if (found && ((int8_t)(record[0] - newest_seq) <= 0)) {
+      continue;
+    }
+    found = true;
+    newest_slot = slot;
+    newest_seq = record[0];
+    *settings = record[1];
+    *seed = 0;
+    for (uint8_t i = 4; i > 0; i--) {
+      *seed = (*seed << 8) | record[RECORD_SEED + i - 1];
+    }
+  }
+  return found;
+}
+
+void persist_save(uint8_t settings, uint32_t seed) {
+  // Overwrites any record that hasn't made it out yet, as only the
+  // latest one matters.
+  pending[0] = newest_seq + 1;
+  pending[1] = settings;
+  for (uint8_t i = 0; i < 4; i++) {
+    pending[RECORD_SEED + i] = seed;
+    seed >>= 8;
+  }
+  pending[RECORD_CRC] = crc8(pending, RECORD_CRC);
+  has_pending = true;
+}
+
+void persist_tick(void) {
+  if (!has_pending || !hal_eeprom_ready()) {
+    return;
+  }
+  // Never write over the newest good record, so a torn write
+  // leaves it intact.
+  newest_slot++;
+  if (newest_slot >= NUM_SLOTS) {
+    newest_slot = 0;
+  }
+  newest_seq = pending[0];
+  hal_eeprom_write(newest_slot * RECORD_BYTES, pending, RECORD_BYTES);
+  has_pending = false;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+// This library checkpoints a small amount of session state (an
+// opaque settings byte and the PRNG's 32-bit state) into the EEPROM so the device
+// can resume where it left off after a power cycle.
+//
+// Records are written round-robin over a handful of slots to spread
+// EEPROM wear. Each record carries a sequence number to find the
+// newest one, and a CRC so a write torn by power loss is ignored in
+// favor of the previous good record.
+//
+// persist_save() only queues a record, the actual EEPROM write is
+// started from persist_tick() once the EEPROM is idle, so it never
+// stalls a tick.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// EEPROM bytes [0, PERSIST_EEPROM_BYTES) belong to this library.
+#define PERSIST_EEPROM_BYTES 32
+
+bool persist_load(uint8_t* settings, uint32_t* seed);
+void persist_save(uint8_t settings, uint32_t seed);
+void persist_tick(void);
@@ -0,0 +1,161 @@
+#ifdef RECEIVE
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "decode.h"
+#include "hal_adc.h"
+#include "morse.h"
+#include "rx.h"
+
+// 2 * cos(2 * pi * RX_PITCH_HZ / RX_SAMPLE_HZ) in Q14.
+#define GOERTZEL_COEFF 29197
+
+// Require the peak to be at least this far above the floor (in units
+// of 1/8 of an octave of power, so about 12dB) before calling anything
+// a mark. Noise alone swings the level around quite a bit.
+#define MIN_SNR 32
+
+// Stop timing marks and spaces at this length, which is plenty to
+// end a word. Runs only change at the end of a block, so they're
+// counted in blocks, which keeps them in a byte.
+#define RUN_BLOCKS_MAX (10 * DIT_TICKS / RX_BLOCK_TICKS)
+
+// Goertzel state, only touched by the ADC interrupt.
+static int16_t s1 = 0;
+static int16_t s2 = 0;
+static uint8_t nsamples = 0;
+
+// log_level() never gets this high, so it marks a level that hasn't
+// been seen yet.
+#define LEVEL_UNKNOWN 0xff
+
+// Level of the last completed block, handed over to rx_tick(), which
+// sets it back to LEVEL_UNKNOWN once it's been picked up.
+static volatile uint8_t block_level = LEVEL_UNKNOWN;
+
+static bool active = false;
+
+// Tracked levels of silence and tone.
+static uint8_t floor_level = LEVEL_UNKNOWN;
+static uint8_t peak_level = 0;
+static uint8_t peak_decay = 0;
+
+// Whether we're in a mark, and how long it's been going on.
+static bool in_mark = false;
+static uint8_t run_blocks = 0;
+
+static uint8_t log_level(uint32_t power) {
+  // Roughly 8 * log2(power), so each octave is 8 steps with a linear
+  // approximation in between. Tracking levels on a log scale keeps
+  // the threshold sensible over a wide range of input volumes.
+  uint8_t level = 0;
+  while (power > 15) {
+    power >>= 1;
+    level += 8;
+  }
+  return level + power;
+}
+
+void rx_sample(uint8_t sample) {
+  int16_t x = (int16_t)sample - 128;
+  int16_t s0 = x + (int16_t)(((int32_t)GOERTZEL_COEFF * s1) >> 14) - s2;
+  s2 = s1;
+  s1 = s0;
+
+  if (++nsamples < RX_BLOCK_SAMPLES) {
+    return;
+  }
+
+  // Squared magnitude of the pitch over this block.
+  int32_t power = (int32_t)s1 * s1 + (int32_t)s2 * s2 -
+      (((int32_t)GOERTZEL_COEFF * s1) >> 14) * s2;
+  block_level = log_level((power > 0) ? power : 0);
+  s1 = 0;
+  s2 = 0;
+  nsamples = 0;
+}
+
+void rx_start(void) {
+  decode_reset();
+  s1 = 0;
+  s2 = 0;
+  nsamples = 0;
+  block_level = LEVEL_UNKNOWN;
+  floor_level = LEVEL_UNKNOWN;
+  peak_level = 0;
+  peak_decay = 0;
+  in_mark = false;
+  run_blocks = 0;
+  active = true;
+  hal_adc_start();
+}
+
+void rx_stop(void) {
+  hal_adc_stop();
+  active = false;
+}
+
+bool rx_active(void) {
+  return active;
+}
+
+static bool detect(uint8_t level) {
+  if (floor_level == LEVEL_UNKNOWN) {
+    // First block, start tracking from here.
+    floor_level = level;
+    peak_level = level;
+    return false;
+  }
+
+  uint8_t threshold = floor_level + (peak_level - floor_level) / 2;
+  bool is_mark = (peak_level >= floor_level + MIN_SNR) && (level > threshold);
+
+  // The peak follows rising levels quickly, and otherwise falls
+  // slowly so a fading signal is still followed. The floor averages
+  // the levels during silence.
+  if (level > peak_level) {
+    peak_level += (level - peak_level + 1) / 2;
+  } else if (((++peak_decay & 0x07) == 0) && (peak_level > floor_level)) {
+    peak_level--;
+  }
+  if (!is_mark) {
+    floor_level += ((int16_t)level - floor_level) / 8;
+  }
+  return is_mark;
+}
+
+bool rx_tick(void) {
+  uint8_t level = block_level;
+  if (level == LEVEL_UNKNOWN) {
+    return false;
+  }
+  block_level = LEVEL_UNKNOWN;
+
+  bool done = false;
+  if (run_blocks < RUN_BLOCKS_MAX) {
+    run_blocks++;
+    if (!in_mark && (run_blocks == RUN_BLOCKS_MAX)) {
+      // Long enough to end a word, so don't wait for the next mark.
+      done = decode_push(-RUN_BLOCKS_MAX * RX_BLOCK_TICKS);
+    }
+  }
+
+  bool is_mark = detect(level);
+  if (is_mark == in_mark) {
+    return done;
+  }
+
+  // The level changed, so hand over the run that just ended.
+  int16_t run_ticks = run_blocks * RX_BLOCK_TICKS;
+  if (in_mark) {
+    done = decode_push(run_ticks);
+  } else if (run_blocks < RUN_BLOCKS_MAX) {
+    done = decode_push(-run_ticks);
+  }
+  in_mark = is_mark;
+  run_blocks = 0;
+  return done;
+}
+
+#endif
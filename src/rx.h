@@ -0,0 +1,32 @@
+#pragma once
+
+// This library listens for CW on the audio input and decodes it.
+//
+// Samples arrive from the ADC interrupt via rx_sample(), which runs a
+// fixed-point Goertzel filter tuned to RX_PITCH_HZ over blocks of
+// RX_BLOCK_SAMPLES. Only a handful of multiplies happen per sample,
+// which leaves most of the ~2000 cycles between samples to the rest
+// of the firmware.
+//
+// rx_tick() picks up each completed block and compares its level
+// against a threshold that sits halfway between the tracked noise
+// floor and signal peak. Runs of tone and silence are turned into
+// mark/space timings in ticks, and handed to the decoder. It returns
+// true once a whole word has been decoded into morse_buf[].
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define RX_SAMPLE_HZ 8000
+#define RX_PITCH_HZ 600
+
+// 64 samples at 8kHz is 8ms, which still gives a few blocks per dit
+// at 20 WPM.
+#define RX_BLOCK_SAMPLES 64
+#define RX_BLOCK_TICKS 8
+
+void rx_start(void);
+void rx_stop(void);
+bool rx_active(void);
+void rx_sample(uint8_t sample);
+bool rx_tick(void);
@@ -0,0 +1,126 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "counters.h"
+#include "hal_stack.h"
+#include "idle.h"
+#include "journal.h"
+#include "shell.h"
+#include "uart.h"
+
+static const char* const COUNTER_NAMES[NUM_COUNTERS] = {
+  "wakeups",
+  "tick_max",
+  "missed",
+  "bounces",
+  "attempts",
+  "passes",
+  "latency",
+  "tone_isr",
+  "stack_free",
+};
+
+#define NOT_PRINTING 0xff
+
+// The counter we're printing, and the next character position on its
+// line.
+static uint8_t print_counter = NOT_PRINTING;
+static uint8_t print_pos = 0;
+
+// Snapshot of the counter being printed, so its digits stay
+// consistent.
+static uint16_t print_value = 0;
+
+// Returns the character at pos on the current line, or 0 past the end.
+static char line_char(uint8_t pos) {
+  const char* name = COUNTER_NAMES[print_counter];
+  uint8_t name_len = 0;
+  while (name[name_len]) {
+    name_len++;
+  }
+  if (pos < name_len) {
+    return name[pos];
+  }
+  if (pos == name_len) {
+    return ' ';
+  }
+  pos -= name_len + 1;
+
+  uint8_t ndigits = 1;
+  for (uint16_t v = print_value; v >= 10; v /= 10) {
+    ndigits++;
+  }
+  if (pos < ndigits) {
+    uint16_t v = print_value;
+    for (uint8_t i = ndigits - 1 - pos; i > 0; i--) {
+      v /= 10;
+    }
+    return '0' + (v % 10);
+  }
+  if (pos == ndigits) {
+    return '\n';
+  }
+  return 0;
+}
+
+static void print_next(void) {
+  char c = line_char(print_pos);
+  if (!c) {
+    // On to the next counter.
+    print_counter++;
+    if (print_counter >= NUM_COUNTERS) {
+      print_counter = NOT_PRINTING;
+      return;
+    }
+    print_pos = 0;
+    print_value = counters[print_counter];
+    c = line_char(0);
+  }
+  if (uart_put(c)) {
+    print_pos++;
+  }
+}
+
+void shell_tick(void) {
+  if (print_counter != NOT_PRINTING) {
+    print_next();
+    return;
+  }
+  if (journal_dumping()) {
+    // Let the dump finish before taking more commands.
+    return;
+  }
+
+  int16_t c = uart_get();
+  switch (c) {
+    case 'c':
+      counters[COUNTER_STACK_FREE] = hal_stack_free();
+      print_counter = 0;
+      print_pos = 0;
+      print_value = counters[0];
+      break;
+
+    case 'z':
+      counters_reset();
+      break;
+
+    case 'd':
+      journal_dump();
+      break;
+
+    case 's':
+      idle_expire();
+      break;
+
+    case -1:
+    case ' ':
+    case '\t':
+    case '\r':
+    case '\n':
+      break;
+
+    default:
+      uart_put('?');
+      break;
+  }
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+// A tiny diagnostics shell over the uart. Commands are single
+// characters, and whitespace is ignored:
+//
+//   c  print each counter as "<name> <value>" on its own line
+//   z  zero the counters
+//   d  dump the session log
+//   s  power down at the next chance, until the key is pressed
+//
+// shell_tick() handles at most one byte, in or out, per call. It's
+// only called on ticks with nothing else going on, so it never gets
+// in the way of keying.
+
+void shell_tick(void);
@@ -1,14 +1,26 @@
-#include <stdlib.h>
-
 #include "capture.h"
+#include "counters.h"
+#include "dict.h"
+#include "idle.h"
+#include "jobs.h"
+#include "journal.h"
 #include "key.h"
+#include "keyer.h"
 #include "morse.h"
+#include "persist.h"
+#include "rx.h"
+#include "shell.h"
+#include "text.h"
 #include "state.h"
 #include "tone.h"
+#include "trace.h"
 
 typedef enum _state_mode_t {
   STRAIGHT_KEY,
   PRACTICE,
+#ifdef RECEIVE
+  RECEIVING,
+#endif
 } state_mode_t;
 
 typedef enum _straight_key_state_t {
@@ -22,6 +34,21 @@ typedef enum _practice_state_t {
   PRACTICE_WAITING,
 } practice_state_t;
 
+#ifdef RECEIVE
+typedef enum _receive_state_t {
+  RECEIVE_ANNOUNCING,
+  RECEIVE_LISTENING,
+  RECEIVE_WAITING,
+  RECEIVE_REPLAYING,
+} receive_state_t;
+
+// Receive states are traced as practice states after these.
+#define TRACE_RECEIVE_BASE 4
+
+// A receive_state_t, kept in a byte.
+static uint8_t receive_state = RECEIVE_ANNOUNCING;
+#endif
+
 static state_mode_t mode = STRAIGHT_KEY;
 practice_state_t practice_state = PRACTICE_ANNOUNCING;
 static straight_key_state_t straight_key_state = STRAIGHT_KEY_ANNOUNCING;
@@ -30,9 +57,75 @@ static uint8_t practice_farnsworth_dits = MAX_FARNSWORTH_DITS;
 #define MAX_ATTEMPTS 3
 static uint8_t practice_attempts = 0;
 
-static uint16_t tick_counter = 0;
+// Whether the last key event left the key down.
+static bool key_held = false;
+
+// Settings are checkpointed as a single byte. The receiving bit was
+// the top bit of the Farnsworth dits, which never needed it, so bytes
+// saved before there was one still read the same.
+#define SETTINGS_PRACTICE_bm 0x80
+#define SETTINGS_NCHARS_bp 4
+#define SETTINGS_RECEIVING_bm 0x08
+#define SETTINGS_FARNSWORTH_gm 0x07
+
+static void checkpoint(void) {
+  // The generator's whole state goes along, so a device that resumes
+  // from this checkpoint carries on with the same sequence.
+  uint8_t settings =
+      (practice_nchars << SETTINGS_NCHARS_bp) | practice_farnsworth_dits;
+  if (mode == PRACTICE) {
+    settings |= SETTINGS_PRACTICE_bm;
+  }
+#ifdef RECEIVE
+  if (mode == RECEIVING) {
+    settings |= SETTINGS_RECEIVING_bm;
+  }
+#endif
+  persist_save(settings, morse_random_state());
+}
+
+// Works out the mode a settings byte was saved in. Returns false if
+// it's not one this build has.
+static bool settings_mode(uint8_t settings, state_mode_t* saved_mode) {
+  switch (settings & (SETTINGS_PRACTICE_bm | SETTINGS_RECEIVING_bm)) {
+    case 0:
+      *saved_mode = STRAIGHT_KEY;
+      return true;
+    case SETTINGS_PRACTICE_bm:
+      *saved_mode = PRACTICE;
+      return true;
+#ifdef RECEIVE
+    case SETTINGS_RECEIVING_bm:
+      *saved_mode = RECEIVING;
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+static void journal_mode(void) {
+  if (mode == STRAIGHT_KEY) {
+    journal_session(JOURNAL_STRAIGHT_KEY);
+    return;
+  }
+#ifdef RECEIVE
+  if (mode == RECEIVING) {
+    journal_session(JOURNAL_RECEIVE);
+    return;
+  }
+#endif
+  // Number the practice levels from easiest to hardest.
+  journal_session(
+      (practice_nchars - 2) * (MAX_FARNSWORTH_DITS + 1) +
+      (MAX_FARNSWORTH_DITS - practice_farnsworth_dits));
+}
 
 static void mode_reset(state_mode_t new_mode) {
+  jobs_reset();
+#ifdef RECEIVE
+  rx_stop();
+#endif
   tone_enable(false);
   morse_reset();
   capture_reset();
@@ -40,15 +133,24 @@ static void mode_reset(state_mode_t new_mode) {
   practice_nchars = 2;
   practice_farnsworth_dits = MAX_FARNSWORTH_DITS;
   mode = new_mode;
+  TRACE_EVENT(TRACE_MODE, mode);
   if (new_mode == STRAIGHT_KEY) {
     morse_set('S' - 'A');
     straight_key_state = STRAIGHT_KEY_ANNOUNCING;
+    TRACE_EVENT(TRACE_STRAIGHT_KEY, straight_key_state);
+#ifdef RECEIVE
+  } else if (new_mode == RECEIVING) {
+    morse_set('R' - 'A');
+    receive_state = RECEIVE_ANNOUNCING;
+    TRACE_EVENT(TRACE_PRACTICE, TRACE_RECEIVE_BASE + receive_state);
+#endif
   } else {
-    // randomize based on when mode is switched.
-    srandom(tick_counter);
     morse_set('P' - 'A');
     practice_state = PRACTICE_ANNOUNCING;
-  }    
+    TRACE_EVENT(TRACE_PRACTICE, practice_state);
+  }
+  checkpoint();
+  journal_mode();
 }
 
 static void straight_key_handle_ready(key_state_t key_state) {
@@ -72,15 +174,37 @@ static void straight_key_handle_ready(key_state_t key_state) {
   }
 }
 
+// Fills in the drill that practice_start() made room for, while its
+// word space plays.
+static bool generate_job(void) {
+#if defined(WORDS)
+  text_generate(practice_nchars);
+  return true;
+#elif defined(DICTIONARY)
+  dict_generate(practice_nchars);
+  return true;
+#else
+  return morse_random_step();
+#endif
+}
+
 static void practice_start(bool is_new) {
   tone_enable(false);
   capture_reset();
   if (is_new) {
-    morse_random_generate(practice_nchars, practice_farnsworth_dits);
+    // Start the word space now, and pick the letters on quiet ticks
+    // during it.
+#if defined(WORDS) || defined(DICTIONARY)
+    morse_random_begin(0, practice_farnsworth_dits);
+#else
+    morse_random_begin(practice_nchars, practice_farnsworth_dits);
+#endif
+    jobs_add(generate_job);
   } else {
     morse_rewind();
   }
   practice_state = PRACTICE_SENDING;
+  TRACE_EVENT(TRACE_PRACTICE, practice_state);
 }
 
 static bool morse_send_finished(morse_action_t morse_action) {
@@ -119,12 +243,14 @@ static void straight_key_handle(key_state_t key_state, morse_action_t morse_acti
         // Reset the morse machine and skip to ready.
         morse_reset();
         straight_key_state = STRAIGHT_KEY_READY;
+        TRACE_EVENT(TRACE_STRAIGHT_KEY, straight_key_state);
         straight_key_handle_ready(key_state);
         return;
       }
 
       if (morse_send_finished(morse_action)) {
         straight_key_state = STRAIGHT_KEY_READY;
+        TRACE_EVENT(TRACE_STRAIGHT_KEY, straight_key_state);
         return;
       }
   }
@@ -166,7 +292,15 @@ static void make_easier(void) {
 
 static void practice_grade(void) {
   tone_enable(false);
-  if (capture_match() || (practice_attempts >= MAX_ATTEMPTS)) {
+  bool passed = capture_match();
+  TRACE_EVENT(TRACE_GRADE, (practice_attempts << 1) | passed);
+  counters_attempt_graded(passed);
+  if (passed) {
+    journal_pass();
+  } else {
+    journal_fail(capture_missed_char());
+  }
+  if (passed || (practice_attempts >= MAX_ATTEMPTS)) {
     if (practice_attempts < MAX_ATTEMPTS) {
       // Yay, passed the test
       make_more_difficult();
@@ -181,13 +315,46 @@ static void practice_grade(void) {
     practice_attempts++;
     practice_start(/* is_new */ false);
   }
+  checkpoint();
+}
+
+#ifdef RECEIVE
+static void receive_listen(void) {
+  tone_enable(false);
+  rx_start();
+  receive_state = RECEIVE_LISTENING;
+  TRACE_EVENT(TRACE_PRACTICE, TRACE_RECEIVE_BASE + receive_state);
 }
 
+static void receive_grade(void) {
+  tone_enable(false);
+  bool passed = capture_match();
+  TRACE_EVENT(TRACE_GRADE, passed);
+  counters_attempt_graded(passed);
+  if (passed) {
+    journal_pass();
+    receive_listen();
+    return;
+  }
+  journal_fail(capture_missed_char());
+
+  // Play back what we heard before listening again.
+  morse_rewind();
+  receive_state = RECEIVE_REPLAYING;
+  TRACE_EVENT(TRACE_PRACTICE, TRACE_RECEIVE_BASE + receive_state);
+}
+#endif
+
 static void practice_handle_waiting(key_state_t key_state) {
-  capture_increment();
   switch (key_state) {
     case KEY_NO_CHANGE:
       if (capture_timeout()) {
+#ifdef RECEIVE
+        if (mode == RECEIVING) {
+          receive_grade();
+          break;
+        }
+#endif
         practice_grade();
       }
       break;
@@ -195,11 +362,14 @@ static void practice_handle_waiting(key_state_t key_state) {
     case KEY_UP:
       tone_enable(false);
       capture_push_mark();
+      jobs_add(capture_match_step);
       break;
 
     case KEY_DOWN:
       tone_enable(true);
       capture_push_space();
+      jobs_add(capture_match_step);
+      counters_attempt_keyed();
       break;
 
     case KEY_UP_LONG:
@@ -214,18 +384,29 @@ static void practice_handle_sending(key_state_t key_state, morse_action_t morse_
   if (key_state != KEY_NO_CHANGE) {
     // Our user has keyed something in SENDING mode. Flush the
     // morse machine, switch to WAITING and handle this tick in
-    // WAITING mode.
+    // WAITING mode. The drill has to be all there to be graded.
+    jobs_finish();
     morse_flush();
     capture_reset();
     practice_state = PRACTICE_WAITING;
+    TRACE_EVENT(TRACE_PRACTICE, practice_state);
+    counters_attempt_begin();
     practice_handle_waiting(key_state);
     return;
   }
 
   if (morse_send_finished(morse_action)) {
     // Morse has finished sending, switch to waiting mode.
+    jobs_finish();
     capture_reset();
     practice_state = PRACTICE_WAITING;
+    TRACE_EVENT(TRACE_PRACTICE, practice_state);
+    counters_attempt_begin();
+    if (key_held) {
+      // The key went down to skip the announce and is still down, so
+      // take it as the start of the first mark.
+      practice_handle_waiting(KEY_DOWN);
+    }
   }
 }
 
@@ -257,19 +438,118 @@ static void practice_handle(key_state_t key_state, morse_action_t morse_action)
   }
 }
 
+#ifdef RECEIVE
+static void receive_handle(key_state_t key_state, morse_action_t morse_action) {
+  switch (receive_state) {
+    case RECEIVE_ANNOUNCING:
+    case RECEIVE_REPLAYING:
+      if ((key_state != KEY_NO_CHANGE) || morse_send_finished(morse_action)) {
+        // Finished, or the user cut us short.
+        morse_reset();
+        receive_listen();
+      }
+      return;
+
+    case RECEIVE_LISTENING:
+      if (key_state != KEY_NO_CHANGE) {
+        // The user is echoing what they've heard so far.
+        rx_stop();
+        capture_reset();
+        receive_state = RECEIVE_WAITING;
+        TRACE_EVENT(TRACE_PRACTICE, TRACE_RECEIVE_BASE + receive_state);
+        counters_attempt_begin();
+        practice_handle_waiting(key_state);
+        return;
+      }
+      if (rx_tick()) {
+        // Heard a whole word, now wait for the echo.
+        rx_stop();
+        capture_reset();
+        receive_state = RECEIVE_WAITING;
+        TRACE_EVENT(TRACE_PRACTICE, TRACE_RECEIVE_BASE + receive_state);
+        counters_attempt_begin();
+        if (key_held) {
+          // The key is still down from cutting the announce or replay
+          // short, so take it as the start of the first mark.
+          practice_handle_waiting(KEY_DOWN);
+        }
+      }
+      return;
+
+    case RECEIVE_WAITING:
+      practice_handle_waiting(key_state);
+      return;
+  }
+}
+#endif
+
 void state_reset(void) {
   mode_reset(STRAIGHT_KEY);
 }
 
-void state_tick(void) {
-  tick_counter++;
-  tone_tick();
-  key_state_t key_state = key_tick();
-  morse_action_t morse_action = morse_tick();
+void state_resume(void) {
+  uint8_t settings;
+  uint32_t seed;
+  if (!persist_load(&settings, &seed)) {
+    state_reset();
+    return;
+  }
+
+  uint8_t nchars = (settings >> SETTINGS_NCHARS_bp) & 0x07;
+  uint8_t farnsworth_dits = settings & SETTINGS_FARNSWORTH_gm;
+  state_mode_t saved_mode;
+  if ((nchars < 2) || (nchars > 5) ||
+      (farnsworth_dits > MAX_FARNSWORTH_DITS) ||
+      !settings_mode(settings, &saved_mode)) {
+    state_reset();
+    return;
+  }
+
+  // Pick up exactly where we left off, without announcing the mode.
+  jobs_reset();
+  tone_enable(false);
+  morse_reset();
+  capture_reset();
+  practice_attempts = 0;
+  practice_nchars = nchars;
+  practice_farnsworth_dits = farnsworth_dits;
+  morse_random_seed(seed);
+  mode = saved_mode;
+  TRACE_EVENT(TRACE_MODE, mode);
+  if (mode == PRACTICE) {
+    practice_start(/* is_new */ true);
+#ifdef RECEIVE
+  } else if (mode == RECEIVING) {
+    receive_listen();
+#endif
+  } else {
+    straight_key_state = STRAIGHT_KEY_READY;
+    TRACE_EVENT(TRACE_STRAIGHT_KEY, straight_key_state);
+  }
+  journal_mode();
+}
+
+static state_mode_t next_mode(void) {
+  switch (mode) {
+    case STRAIGHT_KEY:
+      return PRACTICE;
+#ifdef RECEIVE
+    case PRACTICE:
+      return RECEIVING;
+#endif
+    default:
+      return STRAIGHT_KEY;
+  }
+}
+
+static void state_handle(key_state_t key_state, morse_action_t morse_action) {
+  if (key_state != KEY_NO_CHANGE) {
+    key_held = (key_state == KEY_DOWN);
+  }
 
   // Handle a mode switch early.
   if (key_state == KEY_UP_LONG) {
-    mode_reset((mode == PRACTICE) ? STRAIGHT_KEY: PRACTICE);
+    mode_reset(next_mode());
     return;
   }
 
@@ -281,5 +561,54 @@ void state_tick(void) {
     case PRACTICE:
       practice_handle(key_state, morse_action);
       break;
+
+#ifdef RECEIVE
+    case RECEIVING:
+      receive_handle(key_state, morse_action);
+      break;
+#endif
+  }
+}
+
+void state_tick(void) {
+  counters_tick_begin();
+  bool second = counters_second();
+  tone_tick();
+  persist_tick();
+  journal_tick(second);
+#ifdef PADDLE
+  key_state_t key_state = keyer_tick();
+#else
+  key_state_t key_state = key_tick();
+#endif
+  morse_action_t morse_action = morse_tick();
+
+  if ((key_state == KEY_NO_CHANGE) && (morse_action <= MORSE_HOLD)) {
+    // Nothing much happening this tick, so there's time for the
+    // shell, and a slice of any background work.
+    shell_tick();
+    jobs_tick();
+  }
+
+  idle_tick(key_state != KEY_NO_CHANGE, second);
+  state_handle(key_state, morse_action);
+  counters_tick_end();
+}
+
+bool state_sleepy(void) {
+  if (!idle_expired()) {
+    return false;
+  }
+  // Only while it's the user's turn, where the next thing to happen
+  // is the key going down.
+  switch (mode) {
+    case STRAIGHT_KEY:
+      return straight_key_state == STRAIGHT_KEY_READY;
+
+    case PRACTICE:
+      return practice_state == PRACTICE_WAITING;
+
+    default:
+      return false;
   }
 }
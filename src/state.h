@@ -7,8 +7,21 @@
 // wakes up a main loop at 1ms intervals.
 //
 // This library is called on each timer tick.
+//
+// state_reset() starts afresh in straight key mode, while
+// state_resume() restores the last checkpointed mode and difficulty
+// (falling back to state_reset() if there's nothing to restore.)
+//
+// state_sleepy() is true once the key has gone unused for a while
+// (see idle.h) while it's the user's turn, so the main loop can power
+// down until the key goes down. Nothing is lost by that, as timeouts
+// are kept in RTC.CNT which stops too.
+
+#include <stdbool.h>
 
 void state_reset(void);
+void state_resume(void);
 void state_tick(void);
+bool state_sleepy(void);
 
 #define MAX_FARNSWORTH_DITS 5
@@ -0,0 +1,88 @@
+#ifdef WORDS
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "morse.h"
+#include "text.h"
+
+// Each template is a NUL-terminated word, one symbol per character.
+// Letters and digits stand for themselves, and these pick one at
+// random:
+#define ANY_LETTER '@'
+#define ANY_DIGIT '#'
+#define ANY_PREFIX '*'
+
+// These are kept as plain strings rather than packing symbols into
+// fewer bits, as that would save barely more than the code it would
+// take to unpack them.
+static const char TEMPLATES[] =
+  // Abbreviations, numbers.
+  "CQ\0DE\0TU\0ES\0FB\0GM\0GE\0OM\0UR\0HR\0OP\0" "73\0" "88\0##\0"
+  // Q-codes and more abbreviations, reports, callsigns like K1A.
+  "QRS\0QRT\0QRZ\0QRM\0QRN\0QSB\0QSL\0QSO\0QSY\0QTH\0QRP\0QRV\0"
+  "RST\0ANT\0RIG\0AGE\0PSE\0AGN\0TNX\0SRI\0WX\0" "5NN\0" "599\0"
+  "5#9\0*#@\0###\0"
+  // K1AB, KA1B.
+  "NAME\0RPRT\0CALL\0TEST\0*#@@\0*@#@\0####\0"
+  // K1ABC, KA1BC, contest exchanges.
+  "CONDX\0*#@@@\0*@#@@\0" "5NN##\0" "599##\0";
+
+// The first letter of a callsign.
+static const char PREFIXES[] = "KWNAGFDIV";
+
+static uint8_t random_char_idx(char symbol) {
+  switch (symbol) {
+    case ANY_LETTER:
+      return morse_random() % 26;
+    case ANY_DIGIT:
+      return 26 + morse_random() % 10;
+    case ANY_PREFIX:
+      symbol = PREFIXES[morse_random() % (sizeof(PREFIXES) - 1)];
+      break;
+  }
+  if (symbol >= 'A') {
+    return symbol - 'A';
+  }
+  return 26 + symbol - '0';
+}
+
+// Returns the next template with nchars symbols, starting the search
+// from t, or NULL if there are no more.
+static const char* next_template(const char* t, uint8_t nchars) {
+  while (t < TEMPLATES + sizeof(TEMPLATES) - 1) {
+    uint8_t len = 0;
+    while (t[len]) {
+      len++;
+    }
+    if (len == nchars) {
+      return t;
+    }
+    t += len + 1;
+  }
+  return NULL;
+}
+
+void text_generate(uint8_t nchars) {
+  morse_random_clear();
+
+  uint8_t count = 0;
+  for (const char* t = TEMPLATES; (t = next_template(t, nchars));
+       t += nchars + 1) {
+    count++;
+  }
+  if (!count) {
+    return;
+  }
+
+  uint8_t pick = morse_random() % count;
+  const char* t = next_template(TEMPLATES, nchars);
+  while (pick--) {
+    t = next_template(t + nchars + 1, nchars);
+  }
+  while (*t) {
+    morse_buf[morse_buf_len++] = morse_encoding(random_char_idx(*t++));
+  }
+}
+
+#endif
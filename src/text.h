@@ -0,0 +1,16 @@
+#pragma once
+
+// This library generates practice words that look like real on-air
+// copy: callsigns, Q-codes, common abbreviations, signal reports and
+// numbers. Build with -DWORDS to practice with these in place of
+// random letter groups.
+//
+// text_generate() fills the buffer in place of morse_random_step(),
+// during the word space morse_random_begin() started. It picks a word
+// of exactly nchars characters from a small grammar, and expands it
+// one character at a time into morse_buf[], so the difficulty ladder
+// still works by word length.
+
+#include <stdint.h>
+
+void text_generate(uint8_t nchars);
@@ -1,9 +1,16 @@
 #include <avr/interrupt.h>
+#include <stdbool.h>
 
 #include "ticks.h"
 
+// Set by the PIT, as other interrupts can wake us up too.
+static volatile bool tick_elapsed = false;
+
+// TCB0's count as of the last PIT interrupt.
+static volatile uint16_t tick_stamp = 0;
+
 void ticks_init(void) {
-  // The code gets into power-down mode in the main loop, which shuts
+  // The code gets into standby mode in the main loop, which shuts
   // down all clocks except for the internal low power 32Khz clock.
   //
   // The low power clock is used to drive the RTC PIT, which is
@@ -17,10 +24,6 @@ void ticks_init(void) {
   // main clock.
   _PROTECTED_WRITE(CLKCTRL.MCLKCTRLB, 0);
 
-  // Enable the internal ULP 32k oscillator. This will be used to feed
-  // the RTC PIT.
-  _PROTECTED_WRITE(CLKCTRL.OSC32KCTRLA, CLKCTRL_RUNSTDBY_bm);
-
   // Wait for all RTC registers to be synchronized
   while (RTC.STATUS > 0) {
   }
@@ -28,6 +31,20 @@ void ticks_init(void) {
   // Configure the RTC to use the ULP oscillator
   RTC.CLKSEL = RTC_CLKSEL_INT32K_gc;
 
+  ticks_start();
+
+  // Let TCB0 free-run at half the main clock, so we can measure how
+  // long things take. It stops while we sleep, which is fine as it's
+  // only used to time work within a tick.
+  TCB0.CCMP = 0xffff;
+  TCB0.CTRLA = TCB_CLKSEL_CLKDIV2_gc | TCB_ENABLE_bm;
+}
+
+void ticks_start(void) {
+  // Enable the internal ULP 32k oscillator. This will be used to feed
+  // the RTC PIT.
+  _PROTECTED_WRITE(CLKCTRL.OSC32KCTRLA, CLKCTRL_RUNSTDBY_bm);
+
   // Enable the PIT, running at 32 cycles. This will result in
   // interrupts occurring at a 1Khz rate (32k / 32) = 1024Hz
   RTC.PITCTRLA = RTC_PERIOD_CYC32_gc | RTC_PITEN_bm;
@@ -38,12 +55,55 @@ void ticks_init(void) {
   // wait for RTC.PITCTRLA synchronization to be achieved
   while (RTC.PITSTATUS > 0) {
   }
+
+  // Also count the same 1024Hz in RTC.CNT, which gives the time of
+  // day for things like key edges without any work on each tick.
+  RTC.CTRLA = RTC_PRESCALER_DIV32_gc | RTC_RTCEN_bm | RTC_RUNSTDBY_bm;
+  while (RTC.STATUS > 0) {
+  }
+}
+
+void ticks_stop(void) {
+  // Stop the PIT and RTC.CNT, which holds its count until
+  // ticks_start(). With nothing left using it, and no longer forced
+  // on, the ULP oscillator stops as well in power-down.
+  RTC.CTRLA = 0;
+  while (RTC.STATUS > 0) {
+  }
+  RTC.PITCTRLA = 0;
+  while (RTC.PITSTATUS > 0) {
+  }
+  _PROTECTED_WRITE(CLKCTRL.OSC32KCTRLA, 0);
+  tick_elapsed = false;
+}
+
+bool ticks_elapsed(void) {
+  if (!tick_elapsed) {
+    return false;
+  }
+  tick_elapsed = false;
+  return true;
+}
+
+uint16_t ticks_now(void) {
+  return RTC.CNT;
+}
+
+uint16_t ticks_cycles(void) {
+  return TCB0.CNT;
+}
+
+uint16_t ticks_stamp(void) {
+  return tick_stamp;
 }
 
 // The purpose of the PIT is simply to wake the device up. All the
 // work happens in the main loop, which waits to be woken up at 1ms
-// intervals.
+// intervals. It also notes the time on the main clock, for calib.c.
 ISR(RTC_PIT_vect) {
+  // Taken first, so it's always the same few cycles after the tick.
+  tick_stamp = TCB0.CNT;
   // clear the interrupt flag
   RTC.PITINTFLAGS = RTC_PI_bm;
+  tick_elapsed = true;
 }
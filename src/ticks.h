@@ -1,7 +1,31 @@
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
+
 // This is actually 1000/1024, but we'll keep things
 // simple for ease of integer manipulation everywhere
 #define TICK_MS 1000
 
 void ticks_init(void);
+
+// Stops and restarts the PIT and RTC.CNT, around a power-down.
+void ticks_stop(void);
+void ticks_start(void);
+
+// Returns true once per PIT interrupt.
+bool ticks_elapsed(void);
+
+// Free-running count of ticks, from RTC.CNT. It keeps counting while
+// we sleep in standby, though not while ticks are stopped, and wraps
+// around every 64s or so.
+uint16_t ticks_now(void);
+
+// Free-running count of main clock cycles / 2, for timing things
+// within a tick. Wraps around every 8ms or so.
+uint16_t ticks_cycles(void);
+
+// ticks_cycles() as of the last PIT interrupt. It only tells how long
+// a tick took if the main clock ran all the way through it, that is,
+// with the main loop sleeping in idle rather than standby.
+uint16_t ticks_stamp(void);
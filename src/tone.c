@@ -1,31 +1,134 @@
-#include <stdbool.h>
+#include <avr/interrupt.h>
 #include <avr/io.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <util/atomic.h>
 
+#include "counters.h"
 #include "tone.h"
 
-static bool tone_enabled = false;
+// The sidetone is synthesized rather than toggled. TCA0 runs an 8-bit
+// single slope PWM on PA3 (WO0) from CLK/2, so it overflows at
+// 16MHz / 2 / 256 = 31250Hz, well above what the speaker passes. Each
+// overflow interrupt steps a phase accumulator through a sine table,
+// scales it by a raised-cosine envelope, and loads the next duty
+// cycle.
+//
+// The envelope ramps over about 5ms at the start and end of each mark.
+// As the sine is offset to stay positive, the DC level rises and falls
+// along the same curve, so neither end makes a click.
+//
+// Cycle budget: an interrupt is due every 512 cycles. Counted by hand,
+// instruction by instruction, the handler's body is about 95 cycles,
+// and getting in and out of it (the jump, saving and restoring the
+// registers it uses, reti) about 50 more. That leaves over 70% of
+// each tick for state_tick() while a tone plays. The handler makes no
+// calls, so only the registers it uses get saved, which is why TCB0
+// is read directly rather than through ticks_cycles(). The longest
+// time between those two reads (in units of 2 cycles, like tick_max)
+// is kept in the tone_isr counter, so the real numbers can be read
+// from the shell, less the 50 or so cycles around them. The timer is
+// stopped entirely between marks.
+
+#define SAMPLE_HZ (F_CPU / 2 / 256)
+#define TONE_HZ 600
+
+// 16-bit phase, the top 5 bits index the sine table.
+#define PHASE_STEP ((uint16_t)(((uint32_t)TONE_HZ << 16) / SAMPLE_HZ))
+
+// 16-bit envelope position, the top 5 bits index the envelope. 160
+// samples is about 5.1ms.
+#define ENVELOPE_SAMPLES 160
+#define ENVELOPE_STEP (0xffff / ENVELOPE_SAMPLES)
+
+// 128 + 127 * sin(2 * pi * i / 32)
+static const uint8_t SINE[32] = {
+  128, 153, 177, 199, 218, 234, 245, 253,
+  255, 253, 245, 234, 218, 199, 177, 153,
+  128, 103, 79, 57, 38, 22, 11, 3,
+  1, 3, 11, 22, 38, 57, 79, 103,
+};
+
+// 255 * (1 - cos(pi * i / 31)) / 2
+static const uint8_t ENVELOPE[32] = {
+  0, 1, 3, 6, 10, 16, 23, 31,
+  40, 49, 60, 71, 83, 96, 108, 121,
+  134, 147, 159, 172, 184, 195, 206, 215,
+  224, 232, 239, 245, 249, 252, 254, 255,
+};
+
+static volatile uint16_t phase = 0;
+static volatile uint16_t envelope = 0;
+
+// Whether the envelope is heading up or down.
+static volatile bool tone_enabled = false;
 
 void tone_init(void) {
-  // Set up PA3 as an output, we'll be using this to directly create a
-  // square wave.
+  // PA3 is driven low by the port whenever the timer lets go of it.
   PORTA.DIRSET = PIN3_bm;
   PORTA.OUTCLR = PIN3_bm;
+
+  TCA0.SINGLE.PER = 0xff;
+  TCA0.SINGLE.INTCTRL = TCA_SINGLE_OVF_bm;
+}
+
+static void start(void) {
+  phase = 0;
+  TCA0.SINGLE.CNT = 0;
+  TCA0.SINGLE.CMP0 = 0;
+  TCA0.SINGLE.CTRLB = TCA_SINGLE_CMP0EN_bm | TCA_SINGLE_WGMODE_SINGLESLOPE_gc;
+  TCA0.SINGLE.CTRLA = TCA_SINGLE_CLKSEL_DIV2_gc | TCA_SINGLE_ENABLE_bm;
+}
+
+static void stop(void) {
+  TCA0.SINGLE.CTRLA = 0;
+  TCA0.SINGLE.CTRLB = 0;
 }
 
 void tone_enable(bool enable) {
-  if (enable == tone_enabled) {
-    return;
-  }
   tone_enabled = enable;
-  if (!enable) {
-    PORTA.OUTCLR = PIN3_bm;
+  if (enable && !tone_active()) {
+    start();
   }
 }
 
+// Whether the timer is running.
+bool tone_active(void) {
+  return TCA0.SINGLE.CTRLA & TCA_SINGLE_ENABLE_bm;
+}
+
 void tone_tick(void) {
+  // Let go of the timer once the release has faded out. The ISR
+  // writes envelope a byte at a time, so it's read with it held off.
+  uint16_t env;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    env = envelope;
+  }
+  if (tone_active() && !tone_enabled && !env) {
+    stop();
+  }
+}
+
+ISR(TCA0_OVF_vect) {
+  uint16_t start_cycles = TCB0.CNT;
+  TCA0.SINGLE.INTFLAGS = TCA_SINGLE_OVF_bm;
+
+  uint16_t env = envelope;
   if (tone_enabled) {
-    // At 1ms, we'll have a frequency of 50% or around
-    // 500Hz
-    PORTA.OUTTGL = PIN3_bm;
+    env = (env < 0xffff - ENVELOPE_STEP) ? env + ENVELOPE_STEP : 0xffff;
+  } else {
+    env = (env > ENVELOPE_STEP) ? env - ENVELOPE_STEP : 0;
+  }
+  envelope = env;
+
+  uint16_t p = phase + PHASE_STEP;
+  phase = p;
+
+  uint8_t level = ENVELOPE[env >> 11];
+  TCA0.SINGLE.CMP0BUF = ((uint16_t)SINE[p >> 11] * level) >> 8;
+
+  uint16_t cycles = TCB0.CNT - start_cycles;
+  if (cycles > counters[COUNTER_TONE_ISR]) {
+    counters[COUNTER_TONE_ISR] = cycles;
   }
 }
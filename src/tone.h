@@ -1,7 +1,16 @@
 #pragma once
 
+// Sidetone on PA3.
+//
+// tone_enable() starts or ends a mark. The tone fades in and out
+// rather than switching abruptly, so it keeps playing for a few ms
+// after being disabled. tone_active() is true until then, and while
+// it is the main loop must not sleep deeper than idle, as the tone is
+// generated from the main clock.
+
 #include <stdbool.h>
 
 void tone_init(void);
 void tone_enable(bool enable);
+bool tone_active(void);
 void tone_tick(void);
@@ -0,0 +1,76 @@
+#ifdef TRACE
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "trace.h"
+#include "uart.h"
+
+// Must be a power of two. Eight records: at a byte per quiet tick
+// that drains in 16ms, well before a hand on a key makes another.
+#define TRACE_BUF_BYTES 16
+
+#define DELTA_MAX 127
+#define VALUE_MAX 15
+
+static uint8_t trace_buf[TRACE_BUF_BYTES];
+
+// Free-running indices, masked on use.
+static uint8_t trace_head = 0;
+static uint8_t trace_tail = 0;
+
+// Ticks since the last recorded event.
+static uint8_t delta = 0;
+
+// Events dropped since the buffer filled up.
+static uint8_t dropped = 0;
+
+// Set if something was recorded during this tick.
+static bool busy_tick = false;
+
+static bool put_record(uint8_t type, uint8_t value) {
+  if ((uint8_t)(trace_head - trace_tail) > TRACE_BUF_BYTES - 2) {
+    return false;
+  }
+  trace_buf[trace_head++ & (TRACE_BUF_BYTES - 1)] = 0x80 | (type << 4) | value;
+  trace_buf[trace_head++ & (TRACE_BUF_BYTES - 1)] = delta;
+  delta = 0;
+  busy_tick = true;
+  return true;
+}
+
+void trace_record(uint8_t type, uint8_t value) {
+  if (dropped) {
+    // Let the reader know about lost events first.
+    if (!put_record(TRACE_OVERFLOW, dropped)) {
+      if (dropped < VALUE_MAX) {
+        dropped++;
+      }
+      return;
+    }
+    dropped = 0;
+  }
+  if (!put_record(type, value & VALUE_MAX)) {
+    dropped = 1;
+  }
+}
+
+void trace_tick(void) {
+  if (delta < DELTA_MAX) {
+    delta++;
+  } else {
+    trace_record(TRACE_TIME, 0);
+  }
+
+  if (busy_tick) {
+    busy_tick = false;
+    return;
+  }
+
+  if ((trace_head != trace_tail) &&
+      uart_put(trace_buf[trace_tail & (TRACE_BUF_BYTES - 1)])) {
+    trace_tail++;
+  }
+}
+
+#endif
@@ -0,0 +1,50 @@
+#pragma once
+
+// Compile-time trace points, for finding out which path the state
+// machines took on a unit in the field.
+//
+// Build with -DTRACE to enable them. Otherwise TRACE_EVENT() and
+// TRACE_TICK() expand to nothing, and cost neither code nor RAM.
+//
+// Each event is recorded as two bytes in a small RAM ring buffer:
+//
+//   1tttvvvv  event type t and value v
+//   0ddddddd  ticks since the previous event (saturating at 127)
+//
+// Receive mode states (in builds with -DRECEIVE) are recorded as
+// TRACE_PRACTICE values from 4 up.
+//
+// The set top bit lets a reader synchronize on the start of a
+// record. A TRACE_TIME event is recorded if nothing else has happened
+// for 127 ticks, so a reader can always recover the elapsed time.
+//
+// TRACE_TICK() is called at the end of every tick, after the tone
+// has been updated. It sends out at most one byte over the uart,
+// and only on ticks where no events were recorded, so tracing never
+// delays tone or key handling.
+
+#define TRACE_MODE 0
+#define TRACE_STRAIGHT_KEY 1
+#define TRACE_PRACTICE 2
+#define TRACE_MORSE 3
+#define TRACE_KEY 4
+#define TRACE_GRADE 5
+#define TRACE_OVERFLOW 6
+#define TRACE_TIME 7
+
+#ifdef TRACE
+
+#include <stdint.h>
+
+void trace_record(uint8_t type, uint8_t value);
+void trace_tick(void);
+
+#define TRACE_EVENT(type, value) trace_record((type), (value))
+#define TRACE_TICK() trace_tick()
+
+#else
+
+#define TRACE_EVENT(type, value) do {} while (0)
+#define TRACE_TICK() do {} while (0)
+
+#endif
@@ -0,0 +1,57 @@
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "uart.h"
+
+// Last received byte, or -1 if it's been picked up already.
+static volatile int16_t rx_byte = -1;
+
+// Set when a byte is queued, and cleared once it has been sent.
+static bool tx_active = false;
+
+void uart_init(void) {
+  // Move the USART to its alternate pins, as PA6 is our key.
+  PORTMUX.CTRLB |= PORTMUX_USART0_bm;
+  PORTA.OUTSET = PIN1_bm;
+  PORTA.DIRSET = PIN1_bm;
+  PORTA.DIRCLR = PIN2_bm;
+
+  USART0.BAUD = (uint16_t)((4UL * F_CPU) / UART_BAUD);
+  USART0.CTRLA = USART_RXCIE_bm;
+  // Start of frame detection lets an incoming byte wake us from
+  // standby.
+  USART0.CTRLB = USART_TXEN_bm | USART_RXEN_bm | USART_SFDEN_bm;
+}
+
+bool uart_put(uint8_t c) {
+  if (!(USART0.STATUS & USART_DREIF_bm)) {
+    return false;
+  }
+  // Clear the transmit complete flag so uart_busy() tracks this byte.
+  USART0.STATUS = USART_TXCIF_bm;
+  USART0.TXDATAL = c;
+  tx_active = true;
+  return true;
+}
+
+int16_t uart_get(void) {
+  cli();
+  int16_t c = rx_byte;
+  rx_byte = -1;
+  sei();
+  return c;
+}
+
+bool uart_busy(void) {
+  // TXCIF is only set once the last queued byte has been shifted out.
+  if (tx_active && (USART0.STATUS & USART_TXCIF_bm)) {
+    tx_active = false;
+  }
+  return tx_active;
+}
+
+ISR(USART0_RXC_vect) {
+  rx_byte = USART0.RXDATAL;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+// Minimal non-blocking serial port on PA1 (TXD) and PA2 (RXD).
+//
+// Nothing here ever waits for the hardware. uart_put() hands over a
+// byte only if the transmitter can take it, and received bytes are
+// picked up by an interrupt and held till uart_get() is called.
+//
+// While uart_busy(), the transmitter needs the main clock, so the main
+// loop must not enter a sleep mode deeper than idle.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define UART_BAUD 38400
+
+void uart_init(void);
+bool uart_put(uint8_t c);
+int16_t uart_get(void);
+bool uart_busy(void);
@@ -0,0 +1,71 @@
+#pragma once
+
+// Generated by host/wordpack, see there for the format. 268 words
+// in 585 bytes.
+
+#include <stdint.h>
+
+#define WORDLIST_RESTART 16
+#define WORDLIST_PREFIX_BITS 3
+#define WORDLIST_LETTER_BITS 5
+
+static const uint8_t WORDLIST_BITS[535] = {
+  0x00, 0x2c, 0x2d, 0x32, 0x13, 0x81, 0x04, 0x43, 0x58, 0x0c, 0x97, 0x0b,
+  0x22, 0x51, 0x18, 0x8c, 0xc3, 0x21, 0x89, 0x40, 0x25, 0x0d, 0x48, 0x66,
+  0x82, 0x91, 0x60, 0x34, 0x07, 0x57, 0xc2, 0xd2, 0xf2, 0x12, 0x21, 0x1d,
+  0xa6, 0x03, 0x7d, 0x89, 0x91, 0xb0, 0x04, 0xf6, 0x02, 0x2f, 0x00, 0xd3,
+  0xb2, 0x56, 0xd8, 0x4b, 0x1b, 0xc2, 0x89, 0x24, 0x52, 0x21, 0x20, 0x13,
+  0x87, 0x43, 0x27, 0x04, 0x68, 0xa1, 0x0b, 0x03, 0x1c, 0xe1, 0xa0, 0xa1,
+  0x09, 0xd2, 0x06, 0x0a, 0x89, 0x71, 0x11, 0x86, 0xcc, 0xd0, 0x81, 0x03,
+  0x86, 0x98, 0x64, 0x48, 0x0c, 0x62, 0x92, 0x71, 0x53, 0x16, 0x68, 0x4a,
+  0x28, 0x82, 0xb1, 0x9c, 0x01, 0x03, 0x4d, 0x38, 0xa4, 0xa1, 0x91, 0x29,
+  0x1b, 0x37, 0x65, 0xe1, 0xd0, 0xca, 0x1a, 0x69, 0x24, 0x34, 0x6a, 0xc6,
+  0x36, 0x3c, 0x49, 0x42, 0x27, 0x60, 0x5c, 0x80, 0x91, 0xa9, 0xc9, 0xe9,
+  0x09, 0x4a, 0x6a, 0xaa, 0x2a, 0x47, 0x06, 0x2d, 0x39, 0xe1, 0xcc, 0x83,
+  0x88, 0x4c, 0xe4, 0x84, 0x04, 0x38, 0x84, 0x68, 0xe6, 0x90, 0xc8, 0x10,
+  0xda, 0x30, 0x0f, 0x49, 0xbb, 0x71, 0x2e, 0x11, 0xc7, 0x3a, 0x50, 0x49,
+  0x60, 0x81, 0x14, 0xce, 0x71, 0xc2, 0xb8, 0x78, 0x01, 0x3b, 0x0a, 0xb0,
+  0xa4, 0x43, 0x00, 0x42, 0xa9, 0x8d, 0x10, 0xc0, 0x44, 0x9a, 0xe4, 0x84,
+  0x00, 0x6b, 0x89, 0x11, 0xc5, 0x91, 0x45, 0x43, 0x1c, 0xb8, 0x1a, 0x44,
+  0x6b, 0x88, 0x11, 0x3d, 0x8c, 0x01, 0x26, 0xc0, 0x70, 0x44, 0xca, 0x36,
+  0x10, 0x20, 0x4e, 0x2a, 0x69, 0x28, 0x60, 0x90, 0xa0, 0x36, 0x46, 0x24,
+  0x67, 0x5c, 0x23, 0x8a, 0x2c, 0x91, 0x40, 0x39, 0x06, 0x83, 0x2a, 0x89,
+  0x73, 0x03, 0x07, 0xb4, 0xa1, 0x4a, 0x70, 0x08, 0x18, 0x8b, 0x5a, 0x4f,
+  0x91, 0xc4, 0x31, 0xa2, 0x47, 0x80, 0xda, 0x74, 0x48, 0x54, 0x4e, 0x28,
+  0xd4, 0x46, 0x9a, 0xb3, 0x58, 0xa0, 0x8d, 0x20, 0x45, 0x54, 0x49, 0x5c,
+  0x33, 0x72, 0x0a, 0x0c, 0x0c, 0x02, 0x06, 0x14, 0x51, 0xc3, 0x21, 0xa0,
+  0x05, 0x29, 0x12, 0x37, 0x88, 0x22, 0x91, 0x9c, 0xaa, 0x24, 0x54, 0x1c,
+  0xc9, 0x89, 0x06, 0x18, 0x09, 0x01, 0x51, 0x64, 0x04, 0x09, 0x02, 0xd7,
+  0x16, 0x4e, 0x25, 0x11, 0x0f, 0x18, 0xa2, 0x38, 0x11, 0x01, 0x6a, 0x21,
+  0x60, 0x64, 0x4e, 0x0c, 0x09, 0xd0, 0x10, 0x23, 0x21, 0xab, 0xa8, 0x8d,
+  0xcd, 0x1c, 0x67, 0xa3, 0xc8, 0x48, 0x73, 0x36, 0x8e, 0x91, 0x50, 0x71,
+  0x30, 0x81, 0x22, 0x98, 0x64, 0x2d, 0xc9, 0x99, 0x03, 0xda, 0xa6, 0x08,
+  0x5b, 0x1b, 0x16, 0x92, 0x41, 0x8c, 0xc4, 0x35, 0x12, 0x1a, 0x88, 0x62,
+  0x43, 0x25, 0x11, 0xc3, 0x82, 0x36, 0x15, 0x99, 0x2a, 0x81, 0x25, 0x6b,
+  0xa9, 0x4d, 0x45, 0x92, 0x03, 0xa6, 0x48, 0x0b, 0x5a, 0x4b, 0x91, 0x68,
+  0x9e, 0xb8, 0x38, 0xa6, 0x80, 0x09, 0x88, 0x71, 0x34, 0x02, 0x04, 0x47,
+  0xe7, 0x2a, 0x49, 0x99, 0x24, 0xc6, 0x00, 0xd4, 0x10, 0x28, 0x5a, 0x03,
+  0xc2, 0xd1, 0x35, 0x40, 0x40, 0x9c, 0x07, 0x05, 0x91, 0x35, 0x14, 0xe5,
+  0x84, 0x89, 0x04, 0x4c, 0x1c, 0x02, 0xe2, 0x88, 0xa3, 0x92, 0x60, 0x81,
+  0x68, 0x48, 0x90, 0x39, 0x13, 0xcc, 0x45, 0x49, 0xd0, 0x1c, 0x92, 0x04,
+  0x6e, 0x1e, 0x12, 0xf1, 0xd0, 0x14, 0x27, 0x0b, 0x08, 0x12, 0x87, 0xda,
+  0x94, 0x25, 0x11, 0x11, 0x0c, 0xe4, 0x20, 0x0f, 0x10, 0x4a, 0x2e, 0xce,
+  0x30, 0xb0, 0x56, 0x1c, 0x6d, 0x23, 0x8f, 0x90, 0x91, 0x09, 0xda, 0xc0,
+  0x3c, 0x04, 0xc5, 0x45, 0x32, 0x49, 0x84, 0x9a, 0xc1, 0x3c, 0xa8, 0x29,
+  0x45, 0x42, 0xe2, 0x2c, 0x89, 0xa8, 0x6e, 0x4d, 0x09, 0x0b, 0x26, 0x89,
+  0x9b, 0x32, 0x87, 0x44, 0x22, 0x24, 0x4e, 0x50, 0x1b, 0x38, 0x2e, 0xae,
+  0x21, 0xba, 0x46, 0x22, 0x9a, 0x04, 0x00,
+};
+
+// Words of each length, from 2 letters up.
+static const uint16_t WORDLIST_COUNT[4] = {34, 82, 108, 44};
+
+// Where each length's restarts begin in WORDLIST_INDEX.
+static const uint8_t WORDLIST_FIRST[4] = {0, 3, 9, 16};
+
+// Bit offset of every WORDLIST_RESTART'th word.
+static const uint16_t WORDLIST_INDEX[19] = {
+  0, 173, 341, 367, 580, 803, 1016, 1179,
+  1392, 1428, 1691, 1969, 2252, 2525, 2808, 3051,
+  3242, 3645, 4003,
+};
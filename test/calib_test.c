@@ -0,0 +1,134 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "calib.h"
+#include "morse.h"
+
+// TCB0 counts per nominal tick.
+#define NOMINAL_CYCLES 7812.5
+
+static double stamp = 0;
+
+// RTC.CNT.
+static uint16_t now = 1;
+
+// Runs ticks that each take period counts of TCB0.
+static void run_ticks(long count, double period) {
+  for (long i = 0; i < count; i++) {
+    stamp += period;
+    now++;
+    calib_tick((uint16_t)(uint32_t)stamp, now);
+  }
+}
+
+// A tick that goes by without the main loop seeing it.
+static void miss_tick(double period) {
+  stamp += period;
+  now++;
+}
+
+static void measure(double period) {
+  calib_begin();
+  while (calib_active()) {
+    run_ticks(1, period);
+  }
+}
+
+static bool within(double actual, double expected, double pct) {
+  double err = (actual - expected) / expected * 100;
+  return (err <= pct) && (err >= -pct);
+}
+
+void test_uncalibrated(void) {
+  printf("Test: calib_uncalibrated\n");
+  assert(calib_ticks(DIT_TICKS) == DIT_TICKS);
+  assert(calib_nominal(DIT_TICKS) == DIT_TICKS);
+}
+
+void test_ulp_error(void) {
+  printf("Test: calib_ulp_error\n");
+  calib_init(0);
+
+  // A PIT that's 15% fast or slow still gets elements within 1%, and
+  // timings read back the same.
+  double rates[] = {0.85, 0.9, 1.0, 1.1, 1.15};
+  for (int i = 0; i < 5; i++) {
+    double period = NOMINAL_CYCLES / rates[i];
+    measure(period);
+    for (int dits = 1; dits <= 8; dits++) {
+      uint16_t nominal = dits * DIT_TICKS;
+      uint16_t ticks = calib_ticks(nominal);
+      assert(within(ticks * period, nominal * NOMINAL_CYCLES, 1));
+      assert(within(calib_nominal(ticks), nominal, 1));
+    }
+  }
+}
+
+void test_osc_error(void) {
+  printf("Test: calib_osc_error\n");
+
+  // A main clock that's 2% fast counts 2% more per tick, which isn't
+  // the PIT's doing.
+  calib_init(20);
+  while (calib_active()) {
+    run_ticks(1, NOMINAL_CYCLES * 1044 / 1024);
+  }
+  assert(within(calib_ticks(1000), 1000, 0.1));
+}
+
+void test_missed_tick(void) {
+  printf("Test: calib_missed_tick\n");
+  double period = NOMINAL_CYCLES / 1.1;
+
+  // A tick that went by unseen part way through is still counted.
+  calib_init(0);
+  run_ticks(2, period);
+  miss_tick(period);
+  run_ticks(2, period);
+  assert(!calib_active());
+  assert(within(calib_ticks(1000), 1100, 0.1));
+
+  // And if it was the last one, the measurement starts over.
+  calib_init(0);
+  run_ticks(4, period * 1.1);
+  miss_tick(period * 1.1);
+  run_ticks(1, period * 1.1);
+  assert(calib_active());
+  run_ticks(4, period * 1.1);
+  assert(!calib_active());
+  assert(within(calib_ticks(1000), 1000, 0.1));
+}
+
+void test_periodic(void) {
+  printf("Test: calib_periodic\n");
+  calib_init(0);
+  measure(NOMINAL_CYCLES);
+  assert(calib_ticks(1000) == 1000);
+
+  // Measures again when RTC.CNT wraps around, and picks up the
+  // change.
+  run_ticks((uint16_t)(0xffff - now), NOMINAL_CYCLES / 1.1);
+  assert(!calib_active());
+  run_ticks(1, NOMINAL_CYCLES / 1.1);
+  assert(calib_active());
+  while (calib_active()) {
+    run_ticks(1, NOMINAL_CYCLES / 1.1);
+  }
+  assert(within(calib_ticks(1000), 1100, 0.1));
+
+  // But not to a wild measurement.
+  measure(NOMINAL_CYCLES / 2);
+  assert(within(calib_ticks(1000), 1100, 0.1));
+  measure(NOMINAL_CYCLES);
+}
+
+int main(void) {
+  test_uncalibrated();
+  test_ulp_error();
+  test_osc_error();
+  test_missed_tick();
+  test_periodic();
+  return 0;
+}
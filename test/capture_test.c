@@ -6,18 +6,20 @@
 
 #define TIMEOUT_TICKS 2000
 
+extern uint16_t fake_ticks;
+
 void test_timeout(void) {
   printf("Test: capture_timeout\n");
   capture_reset();
 
-  // Just keep incrementing the ticks till we expect
+  // Just keep advancing the ticks till we expect
   // to see it timeout.
   for (int i = 0; i < TIMEOUT_TICKS - 1; i++) {
-    capture_increment();
+    fake_ticks++;
     assert(capture_timeout() == false);
   }
   // This tick should push us into timeout.
-  capture_increment();
+  fake_ticks++;
   assert(capture_timeout());
 }
 
@@ -32,7 +34,7 @@ void test_single(void) {
   // This should represent a perfect echo.
   bool finished = false;
   while (!finished) {
-    capture_increment();
+    fake_ticks++;
     switch (morse_tick()) {
       case MORSE_START_MARK:
         // The ticks till now have been space ticks.
@@ -54,7 +56,52 @@ void test_single(void) {
   assert(capture_match());
 }        
 
+void test_long(void) {
+  printf("Test: capture_long\n");
+  // Five zeros, so 49 timings go by with nothing graded in between.
+  morse_random_generate(5, 0);
+  for (int i = 0; i < 5; i++) {
+    morse_buf[i] = morse_encoding(26);
+  }
+  capture_reset();
+  for (int pass = 0; pass < 2; pass++) {
+    morse_action_t action;
+    while ((action = morse_tick()) != MORSE_NONE) {
+      fake_ticks++;
+      if (action == MORSE_START_MARK) {
+        capture_push_space();
+      } else if (action == MORSE_START_SPACE) {
+        capture_push_mark();
+      }
+    }
+    if (pass == 0) {
+      assert(capture_match());
+      // Once more with an extra dit on the end.
+      capture_reset();
+      morse_rewind();
+    } else {
+      fake_ticks += 3 * DIT_TICKS;
+      capture_push_space();
+      fake_ticks += DIT_TICKS;
+      capture_push_mark();
+      assert(!capture_match());
+      assert(capture_missed_char() == 5);
+    }
+  }
+}
+
+void test_wrap(void) {
+  printf("Test: capture_wrap\n");
+  // Timings carry on across the tick counter wrapping around.
+  fake_ticks = 0xffff - 100;
+  test_timeout();
+  fake_ticks = 0xffff - 100;
+  test_single();
+}
+
 int main(void) {
   test_timeout();
   test_single();
+  test_long();
+  test_wrap();
 }
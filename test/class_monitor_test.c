@@ -0,0 +1,257 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+// Runs ../host/class_monitor against pseudo-terminals, with the test
+// writing what each device would send to the other end.
+
+#define MONITOR "../host/class_monitor"
+#define NDEVICES 100
+
+// Past what a pseudo-terminal holds, so the writes have to wait for
+// the monitor to read.
+#define BURST_GRADES 20000
+
+typedef struct {
+  int master;
+  // Kept open so the monitor can't see a hangup before the test is
+  // done, and to see how much the monitor has left to read.
+  int slave;
+  char path[64];
+} pty_t;
+
+static pty_t ptys[NDEVICES];
+
+static void open_pty(pty_t* p) {
+  p->master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+  assert(p->master >= 0);
+  assert(grantpt(p->master) == 0);
+  assert(unlockpt(p->master) == 0);
+  assert(ptsname_r(p->master, p->path, sizeof(p->path)) == 0);
+  p->slave = open(p->path, O_RDWR | O_NOCTTY | O_CLOEXEC);
+  assert(p->slave >= 0);
+
+  // Raw before anything's written, so nothing is echoed or changed
+  // however soon the monitor opens it.
+  struct termios t;
+  assert(tcgetattr(p->slave, &t) == 0);
+  cfmakeraw(&t);
+  assert(tcsetattr(p->slave, TCSANOW, &t) == 0);
+}
+
+static void close_pty(pty_t* p) {
+  close(p->master);
+  close(p->slave);
+}
+
+// Starts the monitor on the first n ptys, with its stdout on a pipe.
+static pid_t start(int n, int* out) {
+  int fds[2];
+  assert(pipe(fds) == 0);
+  pid_t pid = fork();
+  assert(pid >= 0);
+  if (pid == 0) {
+    dup2(fds[1], STDOUT_FILENO);
+    close(fds[0]);
+    close(fds[1]);
+    char* argv[NDEVICES + 4];
+    int argc = 0;
+    argv[argc++] = MONITOR;
+    argv[argc++] = "-r";
+    argv[argc++] = "0";
+    for (int i = 0; i < n; i++) {
+      argv[argc++] = ptys[i].path;
+    }
+    argv[argc] = NULL;
+    execv(MONITOR, argv);
+    perror(MONITOR);
+    _exit(1);
+  }
+  close(fds[1]);
+  *out = fds[0];
+  return pid;
+}
+
+static void send_bytes(pty_t* p, const uint8_t* buf, size_t len) {
+  while (len) {
+    ssize_t n = write(p->master, buf, len);
+    assert(n > 0);
+    buf += n;
+    len -= n;
+  }
+}
+
+static void send_record(pty_t* p, uint8_t type, uint8_t value) {
+  uint8_t r[] = {0x80 | (type << 4) | value, 1};
+  send_bytes(p, r, sizeof(r));
+}
+
+// Waits for the monitor to read everything sent so far.
+static void drain(int n) {
+  for (int i = 0; i < n; i++) {
+    int queued;
+    do {
+      usleep(1000);
+      assert(ioctl(ptys[i].slave, TIOCINQ, &queued) == 0);
+    } while (queued);
+  }
+}
+
+// Reads the monitor's output to the end, and checks it exited cleanly.
+static char* finish(pid_t pid, int out) {
+  static char buf[NDEVICES * 128 + 256];
+  size_t len = 0;
+  ssize_t n;
+  while ((n = read(out, buf + len, sizeof(buf) - 1 - len)) > 0) {
+    len += n;
+  }
+  buf[len] = 0;
+  close(out);
+  int status;
+  assert(waitpid(pid, &status, 0) == pid);
+  assert(WIFEXITED(status) && (WEXITSTATUS(status) == 0));
+  return buf;
+}
+
+typedef struct {
+  unsigned attempts, passed, first, recent, recent_len, lost;
+  double retries;
+  char state[32];
+} row_t;
+
+static void find_row(const char* table, const char* path, row_t* r) {
+  char prefix[80];
+  snprintf(prefix, sizeof(prefix), "\n%s\t", path);
+  const char* line = strstr(table, prefix);
+  assert(line);
+  line += strlen(prefix);
+  int n = sscanf(line, "%u\t%u\t%u\t%u/%u\t%lf\t%u\t%31[^\n]", &r->attempts,
+                 &r->passed, &r->first, &r->recent, &r->recent_len,
+                 &r->retries, &r->lost, r->state);
+  assert(n == 8);
+}
+
+// Device i grades i + 1 attempts: attempt k passes unless k % 3 is 2,
+// after k % 4 retries.
+static uint8_t grade_value(int k) {
+  return ((k % 4) << 1) | ((k % 3) != 2);
+}
+
+void test_classroom(void) {
+  printf("Test: class_monitor_classroom\n");
+  for (int i = 0; i < NDEVICES; i++) {
+    open_pty(&ptys[i]);
+  }
+  int out;
+  pid_t pid = start(NDEVICES, &out);
+
+  // Device 0 starts part way through a record, and then sends a byte
+  // at a time, so records are split between reads.
+  uint8_t stray[] = {0x05, 0x06};
+  send_bytes(&ptys[0], stray, sizeof(stray));
+  uint8_t grade[] = {0x80 | (TRACE_GRADE << 4) | 1, 3};
+  for (int k = 0; k < 3; k++) {
+    for (int b = 0; b < sizeof(grade); b++) {
+      send_bytes(&ptys[0], &grade[b], 1);
+      usleep(2000);
+    }
+  }
+
+  // Device 1 sends more than its pseudo-terminal can hold.
+  static uint8_t burst[BURST_GRADES * 2];
+  for (int k = 0; k < BURST_GRADES; k++) {
+    burst[2 * k] = 0x80 | (TRACE_GRADE << 4) | grade_value(k);
+    burst[2 * k + 1] = 0;
+  }
+  send_bytes(&ptys[1], burst, sizeof(burst));
+
+  for (int i = 2; i < NDEVICES; i++) {
+    send_record(&ptys[i], TRACE_MODE, 1);
+    send_record(&ptys[i], TRACE_OVERFLOW, 3);
+    for (int k = 0; k <= i; k++) {
+      send_record(&ptys[i], TRACE_GRADE, grade_value(k));
+    }
+    send_record(&ptys[i], TRACE_TIME, 0);
+    send_record(&ptys[i], TRACE_PRACTICE, 2);
+  }
+
+  drain(NDEVICES);
+  for (int i = 0; i < NDEVICES; i++) {
+    close_pty(&ptys[i]);
+  }
+  const char* table = finish(pid, out);
+
+  row_t r;
+  find_row(table, ptys[0].path, &r);
+  assert((r.attempts == 3) && (r.passed == 3) && (r.first == 3));
+  assert((r.recent == 3) && (r.recent_len == 3));
+  assert(!strcmp(r.state, "gone"));
+
+  find_row(table, ptys[1].path, &r);
+  assert(r.attempts == BURST_GRADES);
+  assert(r.passed == BURST_GRADES - BURST_GRADES / 3);
+
+  for (int i = 2; i < NDEVICES; i++) {
+    unsigned passed = 0, first = 0, retries = 0, recent = 0;
+    for (int k = 0; k <= i; k++) {
+      uint8_t v = grade_value(k);
+      if (v & 1) {
+        passed++;
+        retries += v >> 1;
+        first += !(v >> 1);
+        recent += (k > i - 20);
+      }
+    }
+    find_row(table, ptys[i].path, &r);
+    assert((r.attempts == i + 1) && (r.passed == passed));
+    assert(r.first == first);
+    assert((r.recent == recent) && (r.recent_len == ((i < 20) ? i + 1 : 20)));
+    assert((r.retries > (double)retries / passed - 0.01) &&
+           (r.retries < (double)retries / passed + 0.01));
+    assert(r.lost == 3);
+  }
+  assert(strstr(table, "\nslowest read: "));
+}
+
+void test_interrupted(void) {
+  printf("Test: class_monitor_interrupted\n");
+  open_pty(&ptys[0]);
+  open_pty(&ptys[1]);
+  int out;
+  pid_t pid = start(2, &out);
+  send_record(&ptys[0], TRACE_PRACTICE, 2);
+  send_record(&ptys[0], TRACE_GRADE, 0);
+  // Device 1 is a -DRECEIVE build, switched to receiving.
+  send_record(&ptys[1], TRACE_MODE, 2);
+  drain(2);
+
+  // The table still comes out, with the devices as they were.
+  kill(pid, SIGTERM);
+  const char* table = finish(pid, out);
+  row_t r;
+  find_row(table, ptys[0].path, &r);
+  assert((r.attempts == 1) && (r.passed == 0));
+  assert(!strcmp(r.state, "waiting"));
+  find_row(table, ptys[1].path, &r);
+  assert((r.attempts == 0) && !strcmp(r.state, "receiving"));
+  close_pty(&ptys[0]);
+  close_pty(&ptys[1]);
+}
+
+int main(void) {
+  test_classroom();
+  test_interrupted();
+  return 0;
+}
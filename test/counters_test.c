@@ -0,0 +1,95 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "counters.h"
+
+extern uint16_t fake_cycles;
+extern uint16_t fake_stamp;
+
+static void run_tick(uint16_t cycles) {
+  fake_stamp = fake_cycles;
+  counters_tick_begin();
+  fake_cycles += cycles;
+  counters_tick_end();
+}
+
+void test_saturate(void) {
+  printf("Test: counters_saturate\n");
+  counters_reset();
+  for (long i = 0; i < 70000; i++) {
+    counters_inc(COUNTER_KEY_BOUNCES);
+  }
+  assert(counters[COUNTER_KEY_BOUNCES] == 0xffff);
+  counters_reset();
+  assert(counters[COUNTER_KEY_BOUNCES] == 0);
+}
+
+void test_ticks(void) {
+  printf("Test: counters_ticks\n");
+  counters_reset();
+
+  // Wakeups are reported once a second.
+  for (int i = 0; i < 1023; i++) {
+    counters_wakeup();
+    counters_wakeup();
+    run_tick(100);
+  }
+  assert(counters[COUNTER_WAKEUPS] == 0);
+  assert(!counters_second());
+  run_tick(100);
+  assert(counters[COUNTER_WAKEUPS] == 2046);
+  assert(counters_second());
+
+  // Longest tick, and any overruns.
+  assert(counters[COUNTER_TICK_MAX] == 100);
+  assert(counters[COUNTER_MISSED_TICKS] == 0);
+  run_tick(COUNTER_TICK_CYCLES * 2 + 10);
+  assert(counters[COUNTER_TICK_MAX] == COUNTER_TICK_CYCLES * 2 + 10);
+  assert(counters[COUNTER_MISSED_TICKS] == 2);
+
+  // Should cope with the cycle counter wrapping.
+  fake_cycles = 0xfff0;
+  run_tick(0x20);
+  assert(counters[COUNTER_TICK_MAX] == COUNTER_TICK_CYCLES * 2 + 10);
+}
+
+void test_attempts(void) {
+  printf("Test: counters_attempts\n");
+  counters_reset();
+
+  // First key down 100 ticks after playback, and a pass.
+  counters_attempt_begin();
+  for (int i = 0; i < 100; i++) {
+    run_tick(10);
+  }
+  counters_attempt_keyed();
+  counters_attempt_keyed();
+  counters_attempt_graded(true);
+  assert(counters[COUNTER_LATENCY] == 100);
+
+  // Next one at 500 ticks, and a fail.
+  counters_attempt_begin();
+  for (int i = 0; i < 500; i++) {
+    run_tick(10);
+  }
+  counters_attempt_keyed();
+  counters_attempt_graded(false);
+  assert(counters[COUNTER_LATENCY] == 150);
+
+  // Never keyed, which doesn't change the latency.
+  counters_attempt_begin();
+  counters_attempt_graded(false);
+  assert(counters[COUNTER_LATENCY] == 150);
+
+  assert(counters[COUNTER_ATTEMPTS] == 3);
+  assert(counters[COUNTER_PASSES] == 1);
+}
+
+int main(void) {
+  test_saturate();
+  test_ticks();
+  test_attempts();
+  return 0;
+}
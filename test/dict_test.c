@@ -0,0 +1,86 @@
+#include <assert.h>
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dict.h"
+#include "morse.h"
+
+#define MAX_WORDS 1024
+
+// The words list the firmware's tables were packed from.
+static char words[MAX_WORDS][8];
+static bool seen[MAX_WORDS];
+static int nwords = 0;
+
+static void load_words(void) {
+  FILE* f = fopen("../host/words.txt", "r");
+  assert(f);
+  char line[64];
+  while (fgets(line, sizeof(line), f)) {
+    if ((line[0] == '#') || (strlen(line) > 6)) {
+      continue;
+    }
+    int len = 0;
+    while (isalpha((unsigned char)line[len])) {
+      line[len] = toupper((unsigned char)line[len]);
+      len++;
+    }
+    line[len] = 0;
+    if (len < 2) {
+      continue;
+    }
+    // Duplicates are fine, only one of them gets seen.
+    assert(nwords < MAX_WORDS);
+    strcpy(words[nwords++], line);
+  }
+  fclose(f);
+}
+
+static int find_word(const char* word) {
+  for (int i = 0; i < nwords; i++) {
+    if (!strcmp(words[i], word)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void test_words(void) {
+  printf("Test: dict_words\n");
+  load_words();
+  morse_random_seed(1);
+  for (uint8_t nchars = 2; nchars <= 5; nchars++) {
+    for (int i = 0; i < 20000; i++) {
+      dict_generate(nchars);
+      assert(morse_buf_len == nchars);
+      char word[6];
+      for (uint8_t c = 0; c < nchars; c++) {
+        uint8_t idx = morse_char_idx(morse_buf[c]);
+        assert(idx < 26);
+        word[c] = 'A' + idx;
+      }
+      word[nchars] = 0;
+      int found = find_word(word);
+      assert(found >= 0);
+      seen[found] = true;
+    }
+  }
+
+  // Every word should have come up.
+  for (int i = 0; i < nwords; i++) {
+    if (!seen[i]) {
+      assert(find_word(words[i]) != i);
+    }
+  }
+
+  dict_generate(6);
+  assert(morse_buf_len == 0);
+}
+
+int main(void) {
+  test_words();
+  return 0;
+}
@@ -0,0 +1,12 @@
+#include <stdbool.h>
+#include "hal_adc.h"
+
+bool adc_running = false;
+
+void hal_adc_start(void) {
+  adc_running = true;
+}
+
+void hal_adc_stop(void) {
+  adc_running = false;
+}
@@ -0,0 +1,26 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "hal_eeprom.h"
+
+uint8_t fake_eeprom[EEPROM_BYTES];
+
+void fake_hal_eeprom_erase(void) {
+  memset(fake_eeprom, 0xff, sizeof(fake_eeprom));
+}
+
+uint8_t hal_eeprom_read(uint8_t addr) {
+  return fake_eeprom[addr];
+}
+
+bool hal_eeprom_ready(void) {
+  return true;
+}
+
+void hal_eeprom_write(uint8_t addr, const uint8_t* buf, uint8_t len) {
+  memcpy(fake_eeprom + addr, buf, len);
+}
+
+void hal_eeprom_erase(uint8_t addr, uint8_t len) {
+  memset(fake_eeprom + addr, 0xff, len);
+}
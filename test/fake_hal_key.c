@@ -2,15 +2,36 @@
 #include "hal_key.h"
 
 static bool pressed_state = false;
+static bool dah_pressed_state = false;
+
+// When set, every third read comes back wrong.
+static bool glitch = false;
+static int reads = 0;
 
 void hal_key_init(void) {
 
 }
 
 bool hal_key_pressed(void) {
+  if (glitch && (++reads % 3 == 0)) {
+    return !pressed_state;
+  }
   return pressed_state;
 }
 
+void set_hal_key_glitch(bool v) {
+  glitch = v;
+  reads = 0;
+}
+
 void set_hal_key_pressed(bool v) {
   pressed_state = v;
 }
+
+bool hal_key_dah_pressed(void) {
+  return dah_pressed_state;
+}
+
+void set_hal_key_dah_pressed(bool v) {
+  dah_pressed_state = v;
+}
@@ -0,0 +1,9 @@
+#include <stdint.h>
+
+#include "hal_stack.h"
+
+uint8_t fake_stack_free = 0;
+
+uint8_t hal_stack_free(void) {
+  return fake_stack_free;
+}
@@ -0,0 +1,30 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include "ticks.h"
+
+uint16_t fake_cycles = 0;
+
+// ticks_cycles() as of the start of the tick.
+uint16_t fake_stamp = 0;
+
+// Advanced by tests, a tick at a time.
+uint16_t fake_ticks = 0;
+
+void ticks_init(void) {
+}
+
+bool ticks_elapsed(void) {
+  return true;
+}
+
+uint16_t ticks_now(void) {
+  return fake_ticks;
+}
+
+uint16_t ticks_cycles(void) {
+  return fake_cycles;
+}
+
+uint16_t ticks_stamp(void) {
+  return fake_stamp;
+}
@@ -10,5 +10,9 @@ void tone_enable(bool enable) {
   tone_enabled = enable;
 }
 
+bool tone_active(void) {
+  return tone_enabled;
+}
+
 void tone_tick(void) {
 }
@@ -0,0 +1,31 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include "uart.h"
+
+char fake_uart_out[1024];
+int fake_uart_out_len = 0;
+static int16_t rx_byte = -1;
+
+void fake_uart_receive(uint8_t c) {
+  rx_byte = c;
+}
+
+void uart_init(void) {
+}
+
+bool uart_put(uint8_t c) {
+  if (fake_uart_out_len < sizeof(fake_uart_out)) {
+    fake_uart_out[fake_uart_out_len++] = c;
+  }
+  return true;
+}
+
+int16_t uart_get(void) {
+  int16_t c = rx_byte;
+  rx_byte = -1;
+  return c;
+}
+
+bool uart_busy(void) {
+  return false;
+}
@@ -0,0 +1,63 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "idle.h"
+
+#define TICKS_PER_SECOND 1024
+
+// Ticks from the start of the second, as counters.c would have it.
+static int second_ticks = 0;
+
+static void tick(bool active) {
+  idle_tick(active, second_ticks == 0);
+  second_ticks = (second_ticks + 1) % TICKS_PER_SECOND;
+}
+
+static void run_ticks(long count, bool active) {
+  for (long i = 0; i < count; i++) {
+    tick(active);
+  }
+}
+
+void test_expiry(void) {
+  printf("Test: idle_expiry\n");
+  // Activity in the last tick of a second.
+  second_ticks = TICKS_PER_SECOND - 1;
+  tick(true);
+
+  // Expires as the SLEEP_AFTER_SECONDS-th second after it begins.
+  run_ticks((long)(SLEEP_AFTER_SECONDS - 1) * TICKS_PER_SECOND, false);
+  assert(!idle_expired());
+  tick(false);
+  assert(idle_expired());
+
+  // And stays expired till the key does something.
+  run_ticks(10 * TICKS_PER_SECOND, false);
+  assert(idle_expired());
+  tick(true);
+  assert(!idle_expired());
+
+  // Activity along the way starts it over.
+  run_ticks((long)SLEEP_AFTER_SECONDS * TICKS_PER_SECOND - 1, false);
+  tick(true);
+  run_ticks(TICKS_PER_SECOND, false);
+  assert(!idle_expired());
+}
+
+void test_expire(void) {
+  printf("Test: idle_expire\n");
+  tick(true);
+  idle_expire();
+  assert(idle_expired());
+  tick(false);
+  assert(idle_expired());
+  tick(true);
+  assert(!idle_expired());
+}
+
+int main(void) {
+  test_expiry();
+  test_expire();
+  return 0;
+}
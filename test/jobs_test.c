@@ -0,0 +1,99 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "jobs.h"
+
+// Each job takes a few slices, and records the order they ran in.
+static int slices_a = 0;
+static int slices_b = 0;
+static char order[16];
+static int order_len = 0;
+
+static bool job_a(void) {
+  order[order_len++] = 'a';
+  return ++slices_a >= 3;
+}
+
+static bool job_b(void) {
+  order[order_len++] = 'b';
+  return ++slices_b >= 2;
+}
+
+static bool job_c(void) {
+  order[order_len++] = 'c';
+  return true;
+}
+
+static void clear(void) {
+  jobs_reset();
+  slices_a = 0;
+  slices_b = 0;
+  order_len = 0;
+}
+
+void test_slices(void) {
+  printf("Test: jobs_slices\n");
+  clear();
+  jobs_add(job_a);
+  jobs_add(job_b);
+  // Already queued, so not added again.
+  jobs_add(job_a);
+
+  // One slice per tick, oldest job first.
+  for (int i = 0; i < 10; i++) {
+    jobs_tick();
+  }
+  order[order_len] = 0;
+  assert(!strcmp(order, "aaabb"));
+}
+
+void test_finish(void) {
+  printf("Test: jobs_finish\n");
+  clear();
+  jobs_add(job_a);
+  jobs_add(job_b);
+  jobs_tick();
+  jobs_finish();
+  order[order_len] = 0;
+  assert(!strcmp(order, "aaabb"));
+
+  // Nothing left to do.
+  jobs_tick();
+  assert(order_len == 5);
+}
+
+void test_full(void) {
+  printf("Test: jobs_full\n");
+  clear();
+  jobs_add(job_a);
+  jobs_add(job_b);
+  assert(order_len == 0);
+
+  // No room for another, so the oldest is finished to make some.
+  jobs_add(job_c);
+  order[order_len] = 0;
+  assert(!strcmp(order, "aaa"));
+
+  jobs_finish();
+  order[order_len] = 0;
+  assert(!strcmp(order, "aaabbc"));
+}
+
+void test_reset(void) {
+  printf("Test: jobs_reset\n");
+  clear();
+  jobs_add(job_a);
+  jobs_reset();
+  jobs_tick();
+  assert(order_len == 0);
+}
+
+int main(void) {
+  test_slices();
+  test_finish();
+  test_full();
+  test_reset();
+  return 0;
+}
@@ -0,0 +1,155 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "capture.h"
+#include "journal.h"
+#include "morse.h"
+
+extern uint8_t fake_eeprom[];
+extern void fake_hal_eeprom_erase(void);
+extern char fake_uart_out[];
+extern int fake_uart_out_len;
+
+// The log starts after the persist page.
+#define PAGE(n) (fake_eeprom + 32 * (n + 1))
+
+// Ticks from the start of the second, as counters.c would have it.
+static int second_ticks = 0;
+
+static void run_ticks(int count) {
+  for (int i = 0; i < count; i++) {
+    journal_tick(second_ticks == 0);
+    second_ticks = (second_ticks + 1) % 1024;
+  }
+}
+
+void test_events(void) {
+  printf("Test: journal_events\n");
+  fake_hal_eeprom_erase();
+  journal_init();
+
+  // Expecting E T
+  morse_buf[0] = 0b00000010;
+  morse_buf[1] = 0b00000011;
+  morse_buf_len = 2;
+
+  journal_session(3);
+  journal_pass();
+  journal_pass();
+  journal_fail(1);
+  journal_fail(CAPTURE_MISS_EMPTY);
+  for (int i = 0; i < 5; i++) {
+    journal_pass();
+  }
+  journal_fail(2);
+
+  // One write to erase the first page, one for the header, and
+  // then enough to flush out everything staged.
+  run_ticks(10);
+
+  uint8_t expected[] = {
+    0x00,                    // page sequence
+    0xe0 | 3,                // session at level 3
+    (2 << 5) | ('T' - 'A'),  // 2 passes, then missed the T
+    JOURNAL_MISS_EMPTY,      // nothing sent
+    0x80 | 5,                // 5 passes
+    JOURNAL_MISS_EXTRA,      // too many elements
+    0xff,
+  };
+  assert(memcmp(PAGE(0), expected, sizeof(expected)) == 0);
+}
+
+void test_idle(void) {
+  printf("Test: journal_idle\n");
+  fake_hal_eeprom_erase();
+  journal_init();
+
+  // A pass in the first tick of a second.
+  second_ticks = 1;
+  journal_pass();
+
+  // Sitting idle should flush out the pass a minute later, with a
+  // couple more ticks to set up the page and write it.
+  run_ticks(61440 - 1);
+  assert(PAGE(0)[1] == 0xff);
+  run_ticks(1 + 2);
+  assert(PAGE(0)[1] == (0x80 | 1));
+
+  // Idle for a total of 20 minutes, and then start a session.
+  run_ticks(19 * 61440 - 2);
+  journal_session(JOURNAL_STRAIGHT_KEY);
+  run_ticks(10);
+  uint8_t expected[] = {
+    0x00,
+    0x80 | 1,
+    0xc0 | 0x10 | 4,         // 20 minutes, low bits
+    0xc0 | 1,                // high bits
+    0xe0 | JOURNAL_STRAIGHT_KEY,
+    0xff,
+  };
+  assert(memcmp(PAGE(0), expected, sizeof(expected)) == 0);
+}
+
+void test_wrap(void) {
+  printf("Test: journal_wrap\n");
+  fake_hal_eeprom_erase();
+  journal_init();
+
+  // Fill up the first three pages, and then some.
+  for (int i = 0; i < 31 * 4; i++) {
+    journal_session(i % 24);
+    run_ticks(3);
+  }
+  assert(PAGE(0)[0] == 3);
+  assert(PAGE(1)[0] == 1);
+  assert(PAGE(2)[0] == 2);
+  assert(PAGE(0)[31] == (0xe0 | ((31 * 4 - 1) % 24)));
+
+  // Nothing should be written past the end of the EEPROM, or into
+  // the persist page.
+  for (int i = 0; i < 32; i++) {
+    assert(fake_eeprom[i] == 0xff);
+  }
+
+  // Restarting should pick up at the end of the newest page, and move
+  // on to the next one.
+  journal_init();
+  journal_session(5);
+  run_ticks(3);
+  assert(PAGE(1)[0] == 4);
+  assert(PAGE(1)[1] == (0xe0 | 5));
+  assert(PAGE(1)[2] == 0xff);
+
+  // And once more part way through a page.
+  journal_init();
+  journal_session(6);
+  run_ticks(1);
+  assert(PAGE(1)[2] == (0xe0 | 6));
+}
+
+void test_dump(void) {
+  printf("Test: journal_dump\n");
+  fake_hal_eeprom_erase();
+  journal_init();
+  journal_session(1);
+  run_ticks(3);
+
+  fake_uart_out_len = 0;
+  journal_dump();
+  run_ticks(3 * 65 + 10);
+  assert(fake_uart_out_len == 3 * 65);
+  assert(memcmp(fake_uart_out, "00e1ffff", 8) == 0);
+  assert(fake_uart_out[64] == '\n');
+  assert(memcmp(fake_uart_out + 65, "ffff", 4) == 0);
+}
+
+int main(void) {
+  test_events();
+  test_idle();
+  test_wrap();
+  test_dump();
+  return 0;
+}
@@ -4,7 +4,11 @@
 
 #include "key.h"
 
+// Longest the key can take to settle.
+#define WINDOW_MAX_TICKS 8
+
 extern void set_hal_key_pressed(bool v);
+extern void set_hal_key_glitch(bool v);
 
 static void verify_state(int count, key_state_t state) {
   for (int i = 0; i < count; i++) {
@@ -12,6 +16,23 @@ static void verify_state(int count, key_state_t state) {
   }
 }
 
+// Returns how many ticks it took to see the state.
+static int wait_for(key_state_t state) {
+  for (int i = 0; i <= WINDOW_MAX_TICKS; i++) {
+    key_state_t actual = key_tick();
+    if (actual == state) {
+      return i;
+    }
+    assert(actual == KEY_NO_CHANGE);
+  }
+  assert(false);
+  return -1;
+}
+
+static void settle(void) {
+  verify_state(WINDOW_MAX_TICKS + 1, KEY_NO_CHANGE);
+}
+
 void test_debounce(int nbounce) {
   printf("Test: key_debounce: %d bounces\n", nbounce);
 
@@ -20,47 +41,111 @@ void test_debounce(int nbounce) {
   // see no change.
   verify_state(10, KEY_NO_CHANGE);
 
+  // The first edge is reported straight away.
+  set_hal_key_pressed(true);
+  assert(key_tick() == KEY_DOWN);
+
   // Bounce the key as many times as requested.
+  for (int i = 0; i < nbounce; i++) {
+    set_hal_key_pressed(false);
+    assert(key_tick() == KEY_NO_CHANGE);
+    set_hal_key_pressed(true);
+    assert(key_tick() == KEY_NO_CHANGE);
+  }
+
+  // Once it settles at high, there's nothing more to report.
+  verify_state(10, KEY_NO_CHANGE);
+
+  // Same for the key up.
+  set_hal_key_pressed(false);
+  assert(key_tick() == KEY_UP);
   for (int i = 0; i < nbounce; i++) {
     set_hal_key_pressed(true);
-    // We shouldn't see a key change yet.
     assert(key_tick() == KEY_NO_CHANGE);
     set_hal_key_pressed(false);
     assert(key_tick() == KEY_NO_CHANGE);
   }
 
-  // Now let the key settle at high.
-  set_hal_key_pressed(true);
+  // 10 more updates with the key up, should have no change.
+  verify_state(10, KEY_NO_CHANGE);
+}
 
-  // Wait two ticks to settle.
-  verify_state(2, KEY_NO_CHANGE);
+void test_tap(void) {
+  printf("Test: key_tap\n");
 
-  // Next update should be a keydown.
+  // A press that's gone before the key settles still comes out as a
+  // press and a release.
+  set_hal_key_pressed(true);
   assert(key_tick() == KEY_DOWN);
+  set_hal_key_pressed(false);
+  assert(wait_for(KEY_UP) > 0);
+  settle();
+}
 
-  // 10 more updates with the key down, should have no change.
-  verify_state(10, KEY_NO_CHANGE);
+void test_learn_window(void) {
+  printf("Test: key_learn_window\n");
 
-  // Bounce for the key down
-  for (int i = 0; i < nbounce; i++) {
+  // Bounces further apart than the window stretch it.
+  for (int gap = 2; gap < 5; gap++) {
+    set_hal_key_pressed(true);
+    assert(key_tick() == KEY_DOWN);
+    verify_state(gap - 1, KEY_NO_CHANGE);
     set_hal_key_pressed(false);
-    // We shouldn't see a key change yet.
     assert(key_tick() == KEY_NO_CHANGE);
     set_hal_key_pressed(true);
-    assert(key_tick() == KEY_NO_CHANGE);
+    settle();
+
+    set_hal_key_pressed(false);
+    assert(key_tick() == KEY_UP);
+    settle();
   }
 
-  // Now let the key settle at low.
+  // Which then covers a key that bounces that slowly on the way up.
+  set_hal_key_pressed(true);
+  assert(key_tick() == KEY_DOWN);
+  settle();
   set_hal_key_pressed(false);
+  assert(key_tick() == KEY_UP);
+  verify_state(3, KEY_NO_CHANGE);
+  set_hal_key_pressed(true);
+  assert(key_tick() == KEY_NO_CHANGE);
+  set_hal_key_pressed(false);
+  settle();
+}
 
-  // Wait two ticks to settle.
-  verify_state(2, KEY_NO_CHANGE);
+void test_noise(void) {
+  printf("Test: key_noise\n");
 
-  // Next update should be a keyup.
-  assert(key_tick() == KEY_UP);
+  // Reads that disagree are outvoted.
+  set_hal_key_glitch(true);
+  verify_state(20, KEY_NO_CHANGE);
+  set_hal_key_glitch(false);
 
-  // 10 more updates with the key up, should have no change.
-  verify_state(10, KEY_NO_CHANGE);
+  // But leave the key waiting for edges to settle before reporting
+  // them.
+  settle();
+  set_hal_key_pressed(true);
+  assert(wait_for(KEY_DOWN) > 0);
+  settle();
+  set_hal_key_pressed(false);
+  assert(wait_for(KEY_UP) > 0);
+  settle();
+
+  // Until enough clean edges go by.
+  for (int i = 0; i < 10; i++) {
+    set_hal_key_pressed(true);
+    wait_for(KEY_DOWN);
+    settle();
+    set_hal_key_pressed(false);
+    wait_for(KEY_UP);
+    settle();
+  }
+  set_hal_key_pressed(true);
+  assert(key_tick() == KEY_DOWN);
+  settle();
+  set_hal_key_pressed(false);
+  assert(key_tick() == KEY_UP);
+  settle();
 }
 
 void test_long_press(int press_ticks) {
@@ -73,25 +158,18 @@ void test_long_press(int press_ticks) {
 
   // Now set the key settle at high.
   set_hal_key_pressed(true);
-
-  // Wait two ticks to settle.
-  verify_state(2, KEY_NO_CHANGE);
-
-  // Next update should be a keydown.
   assert(key_tick() == KEY_DOWN);
 
-  // Note that we count up 3 fewer ticks because
-  // of the debouncing on the key-up.
-  verify_state(press_ticks - 3, KEY_NO_CHANGE);
+  // The key up is counted as a tick of the press.
+  verify_state(press_ticks - 1, KEY_NO_CHANGE);
 
   // Now let the key settle to the released state.
   set_hal_key_pressed(false);
 
-  verify_state(2, KEY_NO_CHANGE);
-
   // Check for a keyup or key_up_long based on the amount of ticks
   // we kept everything pressed.
   assert(key_tick() == ((press_ticks >= 1000) ? KEY_UP_LONG: KEY_UP));
+  settle();
 }
 
 
@@ -100,6 +178,9 @@ int main(void) {
 
   test_debounce(0);
   test_debounce(10);
+  test_tap();
+  test_learn_window();
+  test_noise();
 
   test_long_press(999);
   test_long_press(1000);
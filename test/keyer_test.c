@@ -0,0 +1,121 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "keyer.h"
+#include "morse.h"
+
+extern void set_hal_key_pressed(bool v);
+extern void set_hal_key_dah_pressed(bool v);
+
+static void set_paddles(bool dit, bool dah) {
+  set_hal_key_pressed(dit);
+  set_hal_key_dah_pressed(dah);
+}
+
+static void verify_state(int count, key_state_t state) {
+  for (int i = 0; i < count; i++) {
+    assert(keyer_tick() == state);
+  }
+}
+
+// Checks for an element of the given length in dits, and the space
+// after it, starting with the key down on this tick.
+static void verify_element(int dits) {
+  assert(keyer_tick() == KEY_DOWN);
+  verify_state(dits * DIT_TICKS - 1, KEY_NO_CHANGE);
+  assert(keyer_tick() == KEY_UP);
+  verify_state(DIT_TICKS - 1, KEY_NO_CHANGE);
+}
+
+void test_single(void) {
+  printf("Test: keyer_single\n");
+  keyer_init(KEYER_IAMBIC_B);
+  set_paddles(false, false);
+  verify_state(10, KEY_NO_CHANGE);
+
+  // A tap sends one whole dit, however short it is.
+  set_paddles(true, false);
+  assert(keyer_tick() == KEY_DOWN);
+  set_paddles(false, false);
+  verify_state(DIT_TICKS - 1, KEY_NO_CHANGE);
+  assert(keyer_tick() == KEY_UP);
+  verify_state(DIT_TICKS + 10, KEY_NO_CHANGE);
+
+  // Holding the dah paddle repeats dahs.
+  set_paddles(false, true);
+  verify_element(3);
+  verify_element(3);
+  set_paddles(false, false);
+  verify_state(10, KEY_NO_CHANGE);
+}
+
+void test_memory(void) {
+  printf("Test: keyer_memory\n");
+  keyer_init(KEYER_IAMBIC_A);
+  set_paddles(false, false);
+
+  // Tap the dah paddle during a dit, and a dah follows it.
+  set_paddles(true, false);
+  assert(keyer_tick() == KEY_DOWN);
+  set_paddles(false, true);
+  keyer_tick();
+  set_paddles(false, false);
+  verify_state(DIT_TICKS - 2, KEY_NO_CHANGE);
+  assert(keyer_tick() == KEY_UP);
+  verify_state(DIT_TICKS - 1, KEY_NO_CHANGE);
+  verify_element(3);
+  verify_state(10, KEY_NO_CHANGE);
+}
+
+static void test_squeeze(keyer_mode_t mode) {
+  printf("Test: keyer_squeeze: mode %c\n",
+         (mode == KEYER_IAMBIC_A) ? 'A' : 'B');
+  keyer_init(mode);
+
+  // Squeeze for a dit and the start of a dah.
+  set_paddles(true, true);
+  verify_element(1);
+  assert(keyer_tick() == KEY_DOWN);
+  set_paddles(false, false);
+  verify_state(3 * DIT_TICKS - 1, KEY_NO_CHANGE);
+  assert(keyer_tick() == KEY_UP);
+  verify_state(DIT_TICKS - 1, KEY_NO_CHANGE);
+
+  if (mode == KEYER_IAMBIC_B) {
+    // One more dit after letting go.
+    verify_element(1);
+  }
+  verify_state(10, KEY_NO_CHANGE);
+}
+
+void test_long_run(void) {
+  printf("Test: keyer_long_run\n");
+  keyer_init(KEYER_IAMBIC_B);
+
+  // Dahs for long enough to switch modes.
+  set_paddles(false, true);
+  for (int i = 0; i < 10; i++) {
+    verify_element(3);
+  }
+  set_paddles(false, false);
+  assert(keyer_tick() == KEY_UP_LONG);
+  verify_state(10, KEY_NO_CHANGE);
+
+  // But the longest character doesn't.
+  set_paddles(false, true);
+  for (int i = 0; i < 5; i++) {
+    verify_element(3);
+  }
+  set_paddles(false, false);
+  verify_state(10, KEY_NO_CHANGE);
+}
+
+int main(void) {
+  test_single();
+  test_memory();
+  test_squeeze(KEYER_IAMBIC_A);
+  test_squeeze(KEYER_IAMBIC_B);
+  test_long_run();
+  return 0;
+}
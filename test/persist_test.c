@@ -0,0 +1,100 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "persist.h"
+
+extern uint8_t fake_eeprom[];
+extern void fake_hal_eeprom_erase(void);
+
+void test_blank(void) {
+  printf("Test: persist_blank\n");
+  fake_hal_eeprom_erase();
+
+  uint8_t settings;
+  uint32_t seed;
+  assert(!persist_load(&settings, &seed));
+}
+
+void test_round_trip(void) {
+  printf("Test: persist_round_trip\n");
+  fake_hal_eeprom_erase();
+
+  uint8_t settings;
+  uint32_t seed;
+  persist_load(&settings, &seed);
+
+  // Nothing is written till the next tick.
+  persist_save(0x35, 0x12345678);
+  assert(!persist_load(&settings, &seed));
+
+  persist_tick();
+  assert(persist_load(&settings, &seed));
+  assert(settings == 0x35);
+  assert(seed == 0x12345678);
+}
+
+void test_wear_leveling(void) {
+  printf("Test: persist_wear_leveling\n");
+  fake_hal_eeprom_erase();
+
+  uint8_t settings;
+  uint32_t seed;
+  persist_load(&settings, &seed);
+
+  // Write enough records to wrap the sequence numbers and slots
+  // several times over, and we should always get the latest one.
+  for (int i = 0; i < 1000; i++) {
+    persist_save(i & 0xff, i * 0x10001UL);
+    persist_tick();
+    assert(persist_load(&settings, &seed));
+    assert(settings == (i & 0xff));
+    assert(seed == i * 0x10001UL);
+  }
+
+  // Records should have been spread over every slot, four of seven
+  // bytes each.
+  for (int i = 0; i < 4 * 7; i++) {
+    assert(fake_eeprom[i] != 0xff);
+  }
+  // And nothing written past our region.
+  assert(fake_eeprom[PERSIST_EEPROM_BYTES] == 0xff);
+}
+
+void test_torn_write(void) {
+  printf("Test: persist_torn_write\n");
+  fake_hal_eeprom_erase();
+
+  uint8_t settings;
+  uint32_t seed;
+  persist_load(&settings, &seed);
+
+  persist_save(1, 100);
+  persist_tick();
+  persist_save(2, 200);
+  persist_tick();
+
+  // Corrupt the seed in the second record, as though power was lost
+  // part way through writing it. We should fall back to the first.
+  fake_eeprom[7 + 2] ^= 0x10;
+  assert(persist_load(&settings, &seed));
+  assert(settings == 1);
+  assert(seed == 100);
+
+  // The next save should not overwrite the good record.
+  persist_save(3, 300);
+  persist_tick();
+  assert(persist_load(&settings, &seed));
+  assert(settings == 3);
+  assert(seed == 300);
+  assert(fake_eeprom[1] == 1);
+}
+
+int main(void) {
+  test_blank();
+  test_round_trip();
+  test_wear_leveling();
+  test_torn_write();
+  return 0;
+}
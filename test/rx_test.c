@@ -0,0 +1,144 @@
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "decode.h"
+#include "morse.h"
+#include "rx.h"
+
+#define SAMPLES_PER_TICK (RX_SAMPLE_HZ / 1000)
+
+static double phase = 0;
+static unsigned noise = 1;
+
+// Feeds one tick worth of samples, with or without our tone and with
+// a little noise. Returns what rx_tick() did.
+static bool feed_tick(bool tone, double pitch, double amplitude) {
+  for (int i = 0; i < SAMPLES_PER_TICK; i++) {
+    noise = noise * 1103515245 + 12345;
+    double v = 128 + ((int)((noise >> 16) % 9) - 4);
+    if (tone) {
+      v += amplitude * sin(phase);
+    }
+    phase += 2 * M_PI * pitch / RX_SAMPLE_HZ;
+    rx_sample((uint8_t)v);
+  }
+  return rx_tick();
+}
+
+// Tone on/off for each tick of the word being sent.
+static bool schedule[20000];
+static int schedule_len = 0;
+
+// Runs the morse machine over a word, recording when the tone is on.
+static void schedule_word(const uint8_t* encoded, int len) {
+  morse_random_generate(len, 0);
+  for (int i = 0; i < len; i++) {
+    morse_buf[i] = encoded[i];
+  }
+
+  bool tone = false;
+  schedule_len = 0;
+  while (true) {
+    morse_action_t action = morse_tick();
+    if (action == MORSE_NONE) {
+      break;
+    }
+    if (action == MORSE_START_MARK) {
+      tone = true;
+    } else if (action == MORSE_START_SPACE) {
+      tone = false;
+    }
+    schedule[schedule_len++] = tone;
+  }
+}
+
+// Plays the schedule out as audio, and returns true if the receiver
+// decoded a word.
+static bool feed_schedule(double pitch, double amplitude) {
+  bool done = false;
+  for (int i = 0; i < schedule_len; i++) {
+    done |= feed_tick(schedule[i], pitch, amplitude);
+  }
+  // Trailing silence, for the word gap.
+  for (int i = 0; i < 12 * DIT_TICKS; i++) {
+    done |= feed_tick(false, pitch, amplitude);
+  }
+  return done;
+}
+
+// P A R I S
+static const uint8_t PARIS[] = {
+  0b00010110, 0b00000101, 0b00001010, 0b00000100, 0b00001000,
+};
+
+void test_decode(void) {
+  printf("Test: rx_decode\n");
+  decode_reset();
+
+  // Leading silence means nothing.
+  assert(!decode_push(-1000));
+
+  // "TE" with dit length 60.
+  assert(!decode_push(180));
+  assert(!decode_push(-180));
+  assert(!decode_push(60));
+  assert(decode_push(-420));
+  assert(morse_buf_len == 2);
+  assert(morse_buf[0] == 0b00000011);
+  assert(morse_buf[1] == 0b00000010);
+
+  // Slower sender, "M" with dits of 100 ticks. The dit estimate
+  // should follow along.
+  decode_reset();
+  for (int i = 0; i < 4; i++) {
+    decode_push(100);
+    decode_push(-100);
+  }
+  assert(decode_push(-700));
+  assert(morse_buf_len == 1);
+  assert(morse_buf[0] == 0b00010000);
+
+  // Garbage with too many elements is dropped.
+  decode_reset();
+  for (int i = 0; i < 9; i++) {
+    decode_push(60);
+    decode_push(-60);
+  }
+  assert(!decode_push(-700));
+}
+
+void test_receive(double pitch, double amplitude, bool expected) {
+  printf("Test: rx_receive: %.0fHz, amplitude %.0f\n", pitch, amplitude);
+  schedule_word(PARIS, 5);
+
+  // This clears out morse_buf[] for the decoder.
+  rx_start();
+
+  // Let the levels settle on a bit of silence first.
+  for (int i = 0; i < 200; i++) {
+    feed_tick(false, pitch, amplitude);
+  }
+
+  bool done = feed_schedule(pitch, amplitude);
+  assert(done == expected);
+  if (expected) {
+    assert(morse_buf_len == 5);
+    for (int i = 0; i < 5; i++) {
+      assert(morse_buf[i] == PARIS[i]);
+    }
+  }
+  rx_stop();
+}
+
+int main(void) {
+  test_decode();
+  test_receive(600, 100, true);
+  test_receive(600, 20, true);
+  test_receive(620, 60, true);
+  // Just noise, and we shouldn't hear anything.
+  test_receive(600, 0, false);
+  return 0;
+}
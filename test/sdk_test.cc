@@ -0,0 +1,236 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <vector>
+
+extern "C" {
+#include "capture.h"
+#include "morse.h"
+
+extern uint16_t fake_ticks;
+}
+
+#include "cw.hpp"
+
+// The C++ player and grader against the firmware's, on the same
+// inputs.
+
+static void test_player(void) {
+  printf("Test: sdk_player\n");
+  cw::Player<> player;
+  for (unsigned seed = 1; seed <= 200; seed++) {
+    uint8_t nchars = 1 + seed % 5;
+    morse_random_seed(seed);
+    morse_random_generate(nchars, 0);
+    player.seed(seed);
+    player.generate(nchars);
+    assert(player.buf_len == morse_buf_len);
+    for (uint8_t i = 0; i < nchars; i++) {
+      assert(player.buf[i] == morse_buf[i]);
+    }
+
+    // Play it through twice, the second time after a rewind.
+    for (int pass = 0; pass < 2; pass++) {
+      morse_action_t action;
+      do {
+        action = morse_tick();
+        assert((uint8_t)player.tick() == action);
+      } while (action != MORSE_NONE);
+      morse_rewind();
+      player.rewind();
+    }
+  }
+}
+
+// Farnsworth spacing is a template parameter in the SDK, but an
+// argument in the firmware.
+template <uint8_t Farnsworth>
+static void check_farnsworth(void) {
+  cw::Player<WPM, Farnsworth> player;
+  morse_random_seed(Farnsworth);
+  morse_random_generate(5, Farnsworth);
+  player.seed(Farnsworth);
+  player.generate(5);
+  morse_action_t action;
+  do {
+    action = morse_tick();
+    assert((uint8_t)player.tick() == action);
+  } while (action != MORSE_NONE);
+}
+
+static void test_farnsworth(void) {
+  printf("Test: sdk_farnsworth\n");
+  check_farnsworth<0>();
+  check_farnsworth<1>();
+  check_farnsworth<3>();
+  check_farnsworth<5>();
+}
+
+template <uint8_t Farnsworth>
+static void check_next(void) {
+  cw::Player<WPM, Farnsworth> ticked, skipped;
+  for (unsigned seed = 1; seed <= 50; seed++) {
+    ticked.seed(seed);
+    ticked.generate(1 + seed % 5);
+    skipped.seed(seed);
+    skipped.generate(1 + seed % 5);
+    uint32_t ticks = 0, at = 0;
+    cw::Action action;
+    do {
+      do {
+        action = ticked.tick();
+        ticks++;
+      } while (action == cw::Action::Hold);
+      assert(skipped.next(&at) == action);
+      assert(at == ticks);
+    } while (action != cw::Action::None);
+  }
+}
+
+static void test_next(void) {
+  printf("Test: sdk_next\n");
+  check_next<0>();
+  check_next<2>();
+  check_next<5>();
+}
+
+static void test_set(void) {
+  printf("Test: sdk_set\n");
+  cw::Player<> player;
+  for (uint8_t idx = 0; idx < 40; idx++) {
+    morse_set(idx);
+    player.set(idx);
+    morse_action_t action;
+    do {
+      action = morse_tick();
+      assert((uint8_t)player.tick() == action);
+    } while (action != MORSE_NONE);
+  }
+}
+
+// A random duration that often lands near the edges of what's
+// accepted.
+static int16_t random_ticks(void) {
+  static const int16_t EDGES[] = {
+    DIT_TICKS / 2, (DIT_TICKS * 3) / 2, 2 * DIT_TICKS, 4 * DIT_TICKS,
+    4 * DIT_TICKS - 50,
+  };
+  if (rand() % 2) {
+    return EDGES[rand() % 5] + rand() % 3 - 1;
+  }
+  return 1 + rand() % (5 * DIT_TICKS);
+}
+
+static void test_grader(void) {
+  printf("Test: sdk_grader\n");
+  cw::Grader<> grader;
+  // Given whole timings rather than ticks.
+  cw::Grader<> whole;
+  srand(1);
+  int passes = 0;
+
+  // Every trial again, as one batch.
+  std::vector<int16_t> timings;
+  std::vector<uint32_t> timing_offsets = {0};
+  std::vector<uint8_t> expected;
+  std::vector<uint32_t> expected_offsets = {0};
+  std::vector<uint8_t> passed_by_trial, missed_by_trial;
+
+  for (int trial = 0; trial < 20000; trial++) {
+    uint8_t nchars = rand() % 4;
+    morse_random_generate(nchars, 0);
+
+    // Mostly send the right elements, sometimes not.
+    capture_reset();
+    grader.reset();
+    whole.reset();
+    int elements = 0;
+    for (uint8_t i = 0; i < morse_buf_len; i++) {
+      elements += morse_num_elements(morse_buf[i]);
+    }
+    elements += rand() % 3 - 1;
+    for (int e = 0; e < elements; e++) {
+      capture_push_space();
+      grader.push_space();
+      int16_t mark = random_ticks();
+      for (int16_t t = mark; t > 0; t--) {
+        fake_ticks++;
+        grader.increment();
+      }
+      capture_push_mark();
+      grader.push_mark();
+      if (rand() % 2) {
+        // Grading along the way mustn't change the outcome.
+        capture_match_step();
+      }
+      whole.push(mark);
+      int16_t space = (rand() % 4) ? random_ticks() : 3 * DIT_TICKS;
+      if (rand() % 50 == 0) {
+        // Past the timeout.
+        space = 2100;
+      }
+      whole.push(-space);
+      for (int16_t t = space; t > 0; t--) {
+        fake_ticks++;
+        grader.increment();
+        assert(capture_timeout() == grader.timeout());
+      }
+    }
+
+    bool passed = capture_match();
+    assert(grader.match(morse_buf, morse_buf_len) == passed);
+    assert(grader.missed_char() == capture_missed_char());
+    assert(whole.match(morse_buf, morse_buf_len) == passed);
+    assert(whole.missed_char() == capture_missed_char());
+    assert(whole.timeout() == grader.timeout());
+    passes += passed;
+
+    timings.insert(timings.end(), whole.timings(),
+                   whole.timings() + whole.len());
+    timing_offsets.push_back(timings.size());
+    expected.insert(expected.end(), morse_buf, morse_buf + morse_buf_len);
+    expected_offsets.push_back(expected.size());
+    passed_by_trial.push_back(passed);
+    missed_by_trial.push_back(capture_missed_char());
+  }
+  // Make sure both outcomes were covered.
+  assert(passes > 0);
+
+  printf("Test: sdk_batch\n");
+  size_t count = passed_by_trial.size();
+  cw::Attempts attempts = {count, timings.data(), timing_offsets.data(),
+                           expected.data(), expected_offsets.data()};
+  std::vector<uint8_t> passed(count), missed(count);
+  std::vector<cw::Error> errors(timings.size());
+  cw::Verdicts verdicts = {passed.data(), missed.data(), errors.data()};
+  cw::BatchGrader<> batch;
+  batch.grade(attempts, &verdicts);
+  for (size_t i = 0; i < count; i++) {
+    assert(passed[i] == passed_by_trial[i]);
+    assert(missed[i] == missed_by_trial[i]);
+    if (passed[i]) {
+      for (uint32_t j = timing_offsets[i]; j < timing_offsets[i + 1]; j++) {
+        assert(errors[j] == cw::Error::Ok);
+      }
+    }
+  }
+
+  // A batch from the middle of the arrays.
+  cw::Attempts some = {10, timings.data(), timing_offsets.data() + 100,
+                       expected.data(), expected_offsets.data() + 100};
+  batch.grade(some, &verdicts);
+  for (size_t i = 0; i < 10; i++) {
+    assert(passed[i] == passed_by_trial[100 + i]);
+    assert(missed[i] == missed_by_trial[100 + i]);
+  }
+}
+
+int main(void) {
+  test_player();
+  test_farnsworth();
+  test_next();
+  test_set();
+  test_grader();
+  return 0;
+}
@@ -0,0 +1,95 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "counters.h"
+#include "idle.h"
+#include "journal.h"
+#include "shell.h"
+
+extern char fake_uart_out[];
+extern int fake_uart_out_len;
+extern void fake_uart_receive(uint8_t c);
+extern void fake_hal_eeprom_erase(void);
+extern uint8_t fake_stack_free;
+
+static void run_ticks(int count) {
+  for (int i = 0; i < count; i++) {
+    shell_tick();
+  }
+}
+
+void test_counters(void) {
+  printf("Test: shell_counters\n");
+  counters_reset();
+  counters[COUNTER_WAKEUPS] = 1024;
+  counters[COUNTER_TICK_MAX] = 65535;
+  counters[COUNTER_PASSES] = 7;
+  fake_stack_free = 42;
+
+  fake_uart_out_len = 0;
+  fake_uart_receive('c');
+  run_ticks(200);
+  fake_uart_out[fake_uart_out_len] = 0;
+
+  const char* expected =
+      "wakeups 1024\n"
+      "tick_max 65535\n"
+      "missed 0\n"
+      "bounces 0\n"
+      "attempts 0\n"
+      "passes 7\n"
+      "latency 0\n"
+      "tone_isr 0\n"
+      "stack_free 42\n";
+  assert(strcmp(fake_uart_out, expected) == 0);
+}
+
+void test_commands(void) {
+  printf("Test: shell_commands\n");
+
+  // Zero the counters.
+  counters[COUNTER_PASSES] = 7;
+  fake_uart_receive('z');
+  run_ticks(1);
+  assert(counters[COUNTER_PASSES] == 0);
+
+  // Whitespace is ignored, and anything else gets a '?'
+  fake_uart_out_len = 0;
+  fake_uart_receive('\n');
+  run_ticks(1);
+  fake_uart_receive('x');
+  run_ticks(1);
+  assert(fake_uart_out_len == 1);
+  assert(fake_uart_out[0] == '?');
+
+  // Power down as soon as it's the user's turn.
+  idle_tick(true, false);
+  fake_uart_receive('s');
+  run_ticks(1);
+  assert(idle_expired());
+
+  // Dump the log, which goes out from the journal's ticks.
+  fake_hal_eeprom_erase();
+  journal_init();
+  fake_uart_out_len = 0;
+  fake_uart_receive('d');
+  run_ticks(1);
+  assert(journal_dumping());
+  fake_uart_receive('c');
+  for (int i = 0; i < 3 * 65; i++) {
+    journal_tick(false);
+    shell_tick();
+  }
+  // The 'c' waits till the dump is done.
+  assert(fake_uart_out_len == 3 * 65);
+  run_ticks(200);
+  assert(fake_uart_out_len > 3 * 65);
+}
+
+int main(void) {
+  test_counters();
+  test_commands();
+  return 0;
+}
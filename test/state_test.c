@@ -3,11 +3,16 @@
 #include <assert.h>
 #include <stdio.h>
 
+#include "counters.h"
+#include "idle.h"
+#include "jobs.h"
 #include "morse.h"
 #include "state.h"
 
 extern bool tone_enabled;
 extern void set_hal_key_pressed(bool v);
+extern void fake_hal_eeprom_erase(void);
+extern uint16_t fake_ticks;
 
 #define ASSERT(cond, ...) \
   if (!(cond)) { \
@@ -16,9 +21,14 @@ extern void set_hal_key_pressed(bool v);
     assert(cond); \
   }
 
+static void tick(void) {
+  fake_ticks++;
+  state_tick();
+}
+
 static void verify_tone(int ticks, bool value) {
   for (int i = 0; i < ticks; i++) {
-    state_tick();
+    tick();
     ASSERT(
         tone_enabled == value,
         "verify_tone: count=%d: expected tone is %d, but is %d\n",
@@ -37,10 +47,7 @@ static void long_press_and_verify_in_practice(void) {
   // Interrupt by pressing our key.
   set_hal_key_pressed(true);
 
-  // Tone should remain silent for the couple of ticks needed
-  // to debounce.
-  verify_tone(2, false);
-
+  // The tone comes on as soon as the key goes down.
   // Tone should be enabled while we keep the key pressed.
   // Let's press it long enough so the key-up becomes a
   // long press.
@@ -49,10 +56,6 @@ static void long_press_and_verify_in_practice(void) {
   // lift our key.
   set_hal_key_pressed(false);
 
-  // Tone should continue to sound for a couple more ticks,
-  // waiting for the debounce to finish.
-  verify_tone(2, true);
-
   // We should now hear the practice announce (didadadit) after
   // a pause of 8 * dit_ticks
   verify_tone(8 * DIT_TICKS, false);
@@ -73,12 +76,8 @@ static void send_key_down_up(int* sequence, int count) {
     bool desired_key_state = (i % 2) == 0;
     set_hal_key_pressed(desired_key_state);
 
-    // Tone should remain at the previous state for the couple of
-    // ticks needed to debounce.
-    verify_tone(2, !desired_key_state);
-
-    // Continue for duration after account for the debounce ticks.
-    verify_tone(sequence[i] * DIT_TICKS - 2, desired_key_state);
+    // The tone follows the key straight away.
+    verify_tone(sequence[i] * DIT_TICKS, desired_key_state);
   }
 }
 
@@ -114,20 +113,13 @@ static void test_straight_key(void) {
   // Interrupt the announce by pressing our key.
   set_hal_key_pressed(true);
 
-  // Tone should remain silent for the couple of ticks needed
-  // to debounce.
-  verify_tone(2, false);
-
+  // The tone comes on as soon as the key goes down.
   // Tone should be enabled while we keep the key pressed.
   verify_tone(100, true);
 
   // lift our key.
   set_hal_key_pressed(false);
 
-  // Tone should continue to sound for a couple more ticks,
-  // waiting for the debounce to finish.
-  verify_tone(2, true);
-
   // Tone should be disabled from here on.
   verify_tone(1000, false);
 }
@@ -152,8 +144,10 @@ static void test_practice_sending(void) {
   // Get into practice mode.
   long_press_and_verify_in_practice();
 
-  // The next tick should initialize the morse generator.
-  state_tick();
+  // The next tick should initialize the morse generator, which then
+  // picks the letters on quiet ticks. Have it pick them all now.
+  tick();
+  jobs_finish();
 
   // We should have generated two characters in the morse machine.
   ASSERT(morse_buf_len == 2, "Morse buffer: expected 2, actually %d\n", morse_buf_len);
@@ -188,8 +182,10 @@ static void test_practice_sending_timeout(void) {
   // Get into practice mode.
   long_press_and_verify_in_practice();
 
-  // The next tick should initialize the morse generator.
-  state_tick();
+  // The next tick should initialize the morse generator, which then
+  // picks the letters on quiet ticks. Have it pick them all now.
+  tick();
+  jobs_finish();
 
   // We should have generated two characters in the morse machine.
   ASSERT(morse_buf_len == 2, "Morse buffer: expected 2, actually %d\n", morse_buf_len);
@@ -216,7 +212,7 @@ static void test_practice_sending_timeout(void) {
 
     // Morse machine should rewind back in this tick, with a word +
     // farnsworth amount of delay.
-    state_tick();
+    tick();
   }
 }
 
@@ -230,8 +226,10 @@ static void test_practice_sending_correct(void) {
   // Get into practice mode.
   long_press_and_verify_in_practice();
 
-  // The next tick should initialize the morse generator.
-  state_tick();
+  // The next tick should initialize the morse generator, which then
+  // picks the letters on quiet ticks. Have it pick them all now.
+  tick();
+  jobs_finish();
 
   // We should have generated two characters in the morse machine.
   ASSERT(morse_buf_len == 2, "Morse buffer: expected 2, actually %d\n", morse_buf_len);
@@ -263,8 +261,10 @@ static void test_practice_sending_correct(void) {
   // We should timeout in 2000 ticks.
   verify_tone(2000, false);
 
-  // We should get graded on this tick.
-  state_tick();
+  // We should get graded on this tick, with the next letters picked
+  // over the quiet ticks that follow.
+  tick();
+  jobs_finish();
 
   // We should see something other than E T in the buffer now.
   ASSERT((morse_buf[0] != 0b00000010) || (morse_buf[1] != 0b00000011),
@@ -281,8 +281,10 @@ static void test_practice_sending_incorrect(void) {
   // Get into practice mode.
   long_press_and_verify_in_practice();
 
-  // The next tick should initialize the morse generator.
-  state_tick();
+  // The next tick should initialize the morse generator, which then
+  // picks the letters on quiet ticks. Have it pick them all now.
+  tick();
+  jobs_finish();
 
   // We should have generated two characters in the morse machine.
   ASSERT(morse_buf_len == 2, "Morse buffer: expected 2, actually %d\n", morse_buf_len);
@@ -315,13 +317,176 @@ static void test_practice_sending_incorrect(void) {
   verify_tone(2000, false);
 
   // We should get graded on this tick.
-  state_tick();
+  tick();
 
   // We should still see E T in the buffer.
   ASSERT((morse_buf[0] == 0b00000010) && (morse_buf[1] == 0b00000011),
          "Morse buf actually: %d, %d\n", morse_buf[0], morse_buf[1]);
 }
 
+static void test_practice_key_held(void) {
+  printf("Test: state_practice_key_held\n");
+  state_reset();
+  verify_tone(100, false);
+
+  // Long press into practice.
+  set_hal_key_pressed(true);
+  verify_tone(1000, true);
+  set_hal_key_pressed(false);
+  verify_tone(8 * DIT_TICKS, false);
+
+  // Cut the announce short, but keep the key down while the drill
+  // plays. Make it a single E, so it's done before the key has been
+  // down long enough to be a long press.
+  set_hal_key_pressed(true);
+  verify_tone(10, false);
+  jobs_finish();
+  morse_buf[0] = 0b00000010;
+  morse_buf_len = 1;
+  verify_tone((8 + MAX_FARNSWORTH_DITS) * DIT_TICKS - 10, false);
+  int expected[] = {1, 1};
+  verify_mark_space_dits(expected, 1);
+
+  // Now it's our turn, the tone follows the key that's still down.
+  verify_tone(50, true);
+  uint16_t attempts = counters[COUNTER_ATTEMPTS];
+  set_hal_key_pressed(false);
+
+  // Still in practice, rather than off to the next mode as after a
+  // long press, so the mark is graded once the capture times out.
+  verify_tone(2000, false);
+  ASSERT(counters[COUNTER_ATTEMPTS] == attempts,
+         "Graded before the capture timed out\n");
+  tick();
+  ASSERT(counters[COUNTER_ATTEMPTS] == attempts + 1,
+         "Expected the held mark to be graded\n");
+}
+
+static void test_sleepy(void) {
+  printf("Test: state_sleepy\n");
+  state_reset();
+
+  // Never while announcing, however long the key's been unused.
+  verify_tone(100, false);
+  idle_expire();
+  ASSERT(!state_sleepy(), "Sleepy while announcing\n");
+
+  // But once it's the user's turn.
+  for (int i = 0; i < 2000; i++) {
+    tick();
+  }
+  ASSERT(state_sleepy(), "Not sleepy when ready\n");
+  set_hal_key_pressed(true);
+  verify_tone(100, true);
+  ASSERT(!state_sleepy(), "Sleepy with the key down\n");
+  set_hal_key_pressed(false);
+  verify_tone(100, false);
+
+  // In practice, not while the drill plays, but as soon as it's done.
+  long_press_and_verify_in_practice();
+  idle_expire();
+  int ticks = 0;
+  while (!state_sleepy()) {
+    ASSERT(ticks < 10000, "Never sleepy in practice\n");
+    tick();
+    ticks++;
+  }
+  ASSERT(ticks > 8 * DIT_TICKS, "Sleepy after %d ticks\n", ticks);
+  ASSERT(!tone_enabled, "Sleepy with the tone on\n");
+  set_hal_key_pressed(true);
+  verify_tone(100, true);
+  ASSERT(!state_sleepy(), "Sleepy with the key down\n");
+  set_hal_key_pressed(false);
+  verify_tone(100, false);
+}
+
+static void test_resume(void) {
+  printf("Test: state_resume\n");
+  fake_hal_eeprom_erase();
+
+  // Nothing saved, so we should start afresh with the S announce
+  // after a word pause.
+  state_resume();
+  verify_tone(8 * DIT_TICKS - 1, false);
+  verify_tone(DIT_TICKS, true);
+
+  // Get into practice mode, and make things a bit harder.
+  state_reset();
+  verify_tone(100, false);
+  long_press_and_verify_in_practice();
+  tick();
+  jobs_finish();
+  morse_buf[0] = 0b00000010;
+  morse_buf[1] = 0b00000011;
+  verify_tone((8 + MAX_FARNSWORTH_DITS) * DIT_TICKS - 1, false);
+  int expected[] = {
+    1, 4 + MAX_FARNSWORTH_DITS,
+    3, 1,
+  };
+  verify_mark_space_dits(expected, 2);
+  int key_sequence[] = {
+    1, 4, 3, 0
+  };
+  send_key_down_up(key_sequence, 4);
+  verify_tone(2000, false);
+  tick();
+
+  // Give the checkpoint a tick to get written.
+  tick();
+
+  // Power cycle, and we should go straight into practice without an
+  // announce, and with one less farnsworth dit.
+  state_resume();
+  jobs_finish();
+  ASSERT(morse_buf_len == 2, "Morse buffer: expected 2, actually %d\n", morse_buf_len);
+  verify_tone((8 + MAX_FARNSWORTH_DITS - 1) * DIT_TICKS - 1, false);
+  verify_tone(DIT_TICKS, true);
+
+  // Back to straight key mode, which should also resume directly
+  // into keying.
+  state_reset();
+  tick();
+  state_resume();
+  verify_tone(100, false);
+  set_hal_key_pressed(true);
+  verify_tone(100, true);
+  set_hal_key_pressed(false);
+  verify_tone(100, false);
+}
+
+#ifdef RECEIVE
+extern bool adc_running;
+
+static void test_resume_receiving(void) {
+  printf("Test: state_resume_receiving\n");
+  state_reset();
+  verify_tone(100, false);
+  long_press_and_verify_in_practice();
+
+  // Another long press goes on to receiving, which announces itself
+  // with an R (di-da-dit) and then listens.
+  verify_tone(100, false);
+  set_hal_key_pressed(true);
+  verify_tone(1000, true);
+  set_hal_key_pressed(false);
+  verify_tone(8 * DIT_TICKS, false);
+  int expected[] = {
+    1, 1,
+    3, 1,
+    1, 1,
+  };
+  verify_mark_space_dits(expected, 3);
+  tick();
+  ASSERT(adc_running, "Not listening after the announce\n");
+
+  // Power cycle, and we should go straight back to listening without
+  // an announce.
+  adc_running = false;
+  state_resume();
+  ASSERT(adc_running, "Not listening after resuming\n");
+  verify_tone(1000, false);
+}
+#endif
 
 int main(void) {
   test_reset();
@@ -331,5 +496,11 @@ int main(void) {
   test_practice_sending_timeout();
   test_practice_sending_correct();
   test_practice_sending_incorrect();
+  test_practice_key_held();
+  test_sleepy();
+  test_resume();
+#ifdef RECEIVE
+  test_resume_receiving();
+#endif
   return 0;
 }
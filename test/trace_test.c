@@ -0,0 +1,78 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "trace.h"
+
+extern char fake_uart_out[];
+extern int fake_uart_out_len;
+
+static void run_ticks(int count) {
+  for (int i = 0; i < count; i++) {
+    TRACE_TICK();
+  }
+}
+
+void test_records(void) {
+  printf("Test: trace_records\n");
+  fake_uart_out_len = 0;
+
+  run_ticks(5);
+  TRACE_EVENT(TRACE_KEY, 1);
+  TRACE_EVENT(TRACE_PRACTICE, 2);
+  // Nothing is sent on a tick that records something.
+  TRACE_TICK();
+  assert(fake_uart_out_len == 0);
+
+  run_ticks(3);
+  TRACE_EVENT(TRACE_MORSE, 3);
+  run_ticks(10);
+
+  uint8_t expected[] = {
+    0x80 | (TRACE_KEY << 4) | 1, 5,
+    0x80 | (TRACE_PRACTICE << 4) | 2, 0,
+    0x80 | (TRACE_MORSE << 4) | 3, 4,
+  };
+  assert(fake_uart_out_len == sizeof(expected));
+  for (int i = 0; i < sizeof(expected); i++) {
+    assert((uint8_t)fake_uart_out[i] == expected[i]);
+  }
+}
+
+void test_time(void) {
+  printf("Test: trace_time\n");
+  fake_uart_out_len = 0;
+
+  // Staying quiet should record the passage of time.
+  run_ticks(300);
+  assert(fake_uart_out_len == 4);
+  assert((uint8_t)fake_uart_out[0] == (0x80 | (TRACE_TIME << 4)));
+  assert(fake_uart_out[1] == 127);
+}
+
+void test_overflow(void) {
+  printf("Test: trace_overflow\n");
+  run_ticks(10);
+  fake_uart_out_len = 0;
+
+  // Overfill the buffer in a single tick.
+  for (int i = 0; i < 20; i++) {
+    TRACE_EVENT(TRACE_KEY, 1);
+  }
+  run_ticks(40);
+  TRACE_EVENT(TRACE_KEY, 2);
+  run_ticks(10);
+
+  // 8 records fit, and the next event is preceded by one telling us
+  // about the 12 we lost.
+  assert(fake_uart_out_len == 10 * 2);
+  assert((uint8_t)fake_uart_out[16] == (0x80 | (TRACE_OVERFLOW << 4) | 12));
+  assert((uint8_t)fake_uart_out[18] == (0x80 | (TRACE_KEY << 4) | 2));
+}
+
+int main(void) {
+  test_records();
+  test_time();
+  test_overflow();
+  return 0;
+}